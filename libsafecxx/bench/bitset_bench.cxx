@@ -0,0 +1,136 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Presence bitmaps: popcount, set-bit iteration, word-parallel and, and
+// rank/select queries against a one-byte-per-flag vector<bool>-style
+// baseline. Costs are per bit, or per query for rank and select.
+
+static std::size_t const n = std::size_t(1) << 26;
+static int const rounds = 10;
+static std::size_t const queries = std::size_t(1) << 22;
+
+// Roughly one bit in eight set.
+std2::bitvec make_bits(std::uint64_t seed) safe
+{
+  std2::bitvec b(n, false);
+  xorshift rng{ seed };
+  for (std::size_t i = 0; i < n; ++i) {
+    if (mut rng() % 8 == 0) mut b.set(i);
+  }
+  return b;
+}
+
+std2::vector<bool> make_bytes(std2::bitvec const^ b) safe
+{
+  std2::vector<bool> v = {};
+  mut v.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    mut v.push_back(b.test(i));
+  }
+  return v;
+}
+
+void count(std2::bitvec const^ b, std2::vector<bool> const^ bytes) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std::size_t c = 0;
+      for (bool x : bytes.iter()) c += x;
+      do_not_optimize(^c);
+    }
+    report("count: bytes", now_ns() - start, std::int64_t(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std::size_t c = b.count_ones();
+      do_not_optimize(^c);
+    }
+    report("count: bitvec::count_ones", now_ns() - start, std::int64_t(n) * rounds);
+  }
+}
+
+void iterate(std2::bitvec const^ b, std2::vector<bool> const^ bytes) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std::size_t s = 0;
+      for (std::size_t i = 0; i < n; ++i) {
+        if (bytes[i]) s += i;
+      }
+      do_not_optimize(^s);
+    }
+    report("iterate: bytes", now_ns() - start, std::int64_t(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std::size_t s = 0;
+      for (std::size_t i : b.iter_ones()) s += i;
+      do_not_optimize(^s);
+    }
+    report("iterate: bitvec::iter_ones", now_ns() - start, std::int64_t(n) * rounds);
+  }
+}
+
+void intersect(std2::bitvec const^ a, std2::bitvec const^ b) safe
+{
+  auto start = now_ns();
+  for (int r = 0; r < rounds; ++r) {
+    std2::bitvec c(n, false);
+    mut c |= a;
+    mut c &= b;
+    do_not_optimize(^c);
+  }
+  report("and: bitvec", now_ns() - start, std::int64_t(n) * rounds);
+}
+
+void rank_select(std2::bitvec b) safe
+{
+  std2::rank_select rs(rel b);
+  xorshift rng{ 0x2545f4914f6cdd1d };
+
+  {
+    auto start = now_ns();
+    std::size_t s = 0;
+    for (std::size_t q = 0; q < queries; ++q) {
+      s += rs.rank1(static_cast<std::size_t>(mut rng() % n));
+    }
+    do_not_optimize(^s);
+    report("rank1", now_ns() - start, std::int64_t(queries));
+  }
+
+  {
+    std::size_t const ones = rs.count_ones();
+    auto start = now_ns();
+    std::size_t s = 0;
+    for (std::size_t q = 0; q < queries; ++q) {
+      s += rs.select1(static_cast<std::size_t>(mut rng() % ones)).unwrap();
+    }
+    do_not_optimize(^s);
+    report("select1", now_ns() - start, std::int64_t(queries));
+  }
+}
+
+int main() safe
+{
+  std2::bitvec a = make_bits(0x9e3779b97f4a7c15);
+  std2::bitvec b = make_bits(0x853c49e6748fea9b);
+  std2::vector<bool> bytes = make_bytes(a);
+
+  count(a, bytes);
+  iterate(a, bytes);
+  intersect(a, b);
+  rank_select(rel a);
+}
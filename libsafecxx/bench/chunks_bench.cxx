@@ -0,0 +1,91 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Kernels written with checked slice indexing against the same kernels over
+// array_chunks and windows, where the bounds checks happen once per chunk.
+// Inspect the generated code alongside the timings: the chunked loops
+// should have no per-element compare-and-branch to the panic handler.
+
+static std::size_t const n = std::size_t(1) << 24;
+static int const rounds = 20;
+
+std2::vector<int> make_input() safe
+{
+  std2::vector<int> v = {};
+  mut v.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    mut v.push_back(static_cast<int>(i % 251));
+  }
+  return v;
+}
+
+int sum_indexed(const [int; dyn]^ s) safe
+{
+  int acc = 0;
+  for (std::size_t i = 0; i < (*s)~length; ++i) {
+    acc += (*s)[i];
+  }
+  return acc;
+}
+
+int sum_array_chunks(const [int; dyn]^ s) safe
+{
+  int acc[8] {};
+  auto it = std2::array_chunks<8>(s);
+  const [int; dyn]^ rest = it.remainder();
+  for (const [int; 8]^ c : rel it) {
+    for (std::size_t j = 0; j < 8; ++j) {
+      acc[j] += (*c)[j];
+    }
+  }
+
+  int total = 0;
+  for (std::size_t j = 0; j < 8; ++j) total += acc[j];
+  for (int x : std2::slice_iterator<const int>(rest)) total += x;
+  return total;
+}
+
+long long stencil_indexed(const [int; dyn]^ s) safe
+{
+  long long acc = 0;
+  for (std::size_t i = 0; i + 2 < (*s)~length; ++i) {
+    acc += (*s)[i] - 2 * (*s)[i + 1] + (*s)[i + 2];
+  }
+  return acc;
+}
+
+long long stencil_windows(const [int; dyn]^ s) safe
+{
+  long long acc = 0;
+  for (const [int; dyn]^ w : std2::windows(s, 3)) {
+    acc += (*w)[0] - 2 * (*w)[1] + (*w)[2];
+  }
+  return acc;
+}
+
+template<class R>
+void run(char const* name, R(*f)(const [int; dyn]^) safe, const [int; dyn]^ s) safe
+{
+  auto start = now_ns();
+  for (int r = 0; r < rounds; ++r) {
+    R x = f(s);
+    do_not_optimize(^x);
+  }
+  report(name, now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+}
+
+int main() safe
+{
+  std2::vector<int> v = make_input();
+  run("sum: checked indexing", sum_indexed, v.slice());
+  run("sum: array_chunks<8>", sum_array_chunks, v.slice());
+  run("stencil: checked indexing", stencil_indexed, v.slice());
+  run("stencil: windows(3)", stencil_windows, v.slice());
+}
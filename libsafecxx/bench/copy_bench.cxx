@@ -0,0 +1,72 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include <cstdlib>
+
+#include "helpers.h"
+
+// Copies a large file between two local paths with fs::copy, which stays in
+// the kernel, and through a buffered reader, which forces the user-space
+// loop. Costs are per MiB. STD2_COPY_BENCH_BYTES overrides the default
+// size of 10 GiB.
+
+using std2::u8;
+using std2::fs::file;
+
+static char const* const src_path = "/tmp/std2-copy-bench-src";
+static char const* const dst_path = "/tmp/std2-copy-bench-dst";
+
+std::uint64_t total_bytes() safe
+{
+  unsafe { char const* env = std::getenv("STD2_COPY_BENCH_BYTES"); }
+  if (env) unsafe { return std::strtoull(env, nullptr, 10); }
+  return std::uint64_t(10) << 30;
+}
+
+void make_source(std::uint64_t size) safe
+{
+  std2::vector<u8> chunk = {};
+  for (std::size_t i = 0; i < 1024 * 1024; ++i) {
+    mut chunk.push_back(static_cast<u8>(i * 31));
+  }
+
+  file f = file::create("/tmp/std2-copy-bench-src").unwrap();
+  std::uint64_t written = 0;
+  while (written < size) {
+    std::uint64_t n = size - written < chunk.size() ? size - written : chunk.size();
+    unsafe { auto part = std2::slice_from_raw_parts(chunk.data(), static_cast<std::size_t>(n)); }
+    std2::io::write_all(^f, part).unwrap();
+    written += n;
+  }
+  f.sync_all().unwrap();
+}
+
+int main() safe
+{
+  std::uint64_t const size = total_bytes();
+  make_source(size);
+
+  {
+    auto start = now_ns();
+    std::uint64_t n = std2::fs::copy("/tmp/std2-copy-bench-src", "/tmp/std2-copy-bench-dst").unwrap();
+    report("fs::copy (kernel)", now_ns() - start, static_cast<std::int64_t>(n >> 20));
+  }
+
+  {
+    auto start = now_ns();
+    std2::io::buf_reader<file> r(file::open("/tmp/std2-copy-bench-src").unwrap(), 1024 * 1024);
+    file dst = file::create("/tmp/std2-copy-bench-dst").unwrap();
+    std::uint64_t n = std2::io::copy(^r, ^dst).unwrap();
+    report("io::copy (buffered loop)", now_ns() - start, static_cast<std::int64_t>(n >> 20));
+  }
+
+  unsafe {
+    ::unlink(src_path);
+    ::unlink(dst_path);
+  }
+}
@@ -0,0 +1,160 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Loopback echo throughput. A client streams chunks to an echo server and
+// reads each one back, against a blocking server thread and against an
+// async server driven by local_executor and the epoll reactor.
+
+using namespace std2::net;
+
+static std::size_t const chunk_size = 64 * 1024;
+static std::size_t const total_bytes = std::size_t(1) << 30;
+
+void blocking_echo_server(tcp_listener listener) safe
+{
+  tcp_stream s = listener.accept().unwrap();
+  std2::vector<std2::u8> buf = {};
+  for (std::size_t i = 0; i < chunk_size; ++i) mut buf.push_back(0);
+
+  while (true) {
+    std::size_t n = mut s.read(mut buf.slice()).unwrap();
+    if (n == 0) break;
+    unsafe { auto chunk = std2::slice_from_raw_parts(buf.data(), n); }
+    mut s.write_all(chunk).unwrap();
+  }
+}
+
+// Echoes everything received on one connection until the peer shuts down.
+class async_echo
+{
+  tcp_listener listener_;
+  reactor r_;
+  std2::optional<tcp_stream> stream_;
+  std2::vector<std2::u8> buf_;
+  std::size_t filled_;
+  std::size_t written_;
+
+public:
+  async_echo(tcp_listener listener, reactor r) safe
+    : listener_(rel listener)
+    , r_(rel r)
+    , stream_(.none)
+    , buf_{}
+    , filled_(0)
+    , written_(0)
+  {
+    for (std::size_t i = 0; i < chunk_size; ++i) mut buf_.push_back(0);
+  }
+
+  std2::poll_result<int> poll(self^, std2::context^ cx) safe {
+    if (self->stream_.is_none()) {
+      auto a = self->listener_.poll_accept(cx, self->r_);
+      if (a.is_pending()) return .pending;
+
+      tcp_stream s = a rel.unwrap().unwrap();
+      s.set_nonblocking(true).unwrap();
+      self->stream_ = .some(rel s);
+    }
+
+    tcp_stream^ s = match(self->stream_) -> tcp_stream^ {
+      .some(^s) => s;
+      .none => std2::panic("unreachable");
+    };
+
+    while (true) {
+      if (self->written_ < self->filled_) {
+        unsafe {
+          auto rest = std2::slice_from_raw_parts(
+            self->buf_.data() + self->written_, self->filled_ - self->written_);
+        }
+        auto w = mut s.poll_write(cx, self->r_, rest);
+        if (w.is_pending()) return .pending;
+        self->written_ += w rel.unwrap().unwrap();
+        continue;
+      }
+
+      auto r = mut s.poll_read(cx, self->r_, mut self->buf_.slice());
+      if (r.is_pending()) return .pending;
+
+      std::size_t n = r rel.unwrap().unwrap();
+      if (n == 0) return .ready(0);
+      self->filled_ = n;
+      self->written_ = 0;
+    }
+  }
+};
+
+impl async_echo: std2::future
+{
+  using output_type = int;
+
+  std2::poll_result<output_type> poll(self^, std2::context^ cx) safe override {
+    return self.poll(cx);
+  }
+};
+
+void async_echo_server(tcp_listener listener) safe
+{
+  reactor r = reactor::create().unwrap();
+  std2::local_executor ex{};
+  listener.set_nonblocking(true).unwrap();
+  mut ex.block_on(async_echo(rel listener, cpy r), r);
+}
+
+void run_client(std::uint16_t port, char const* name) safe
+{
+  tcp_stream client = tcp_stream::connect(socket_address::loopback_v4(port)).unwrap();
+  client.set_nodelay(true).unwrap();
+
+  std2::vector<std2::u8> out = {};
+  std2::vector<std2::u8> in = {};
+  for (std::size_t i = 0; i < chunk_size; ++i) {
+    mut out.push_back(static_cast<std2::u8>(i));
+    mut in.push_back(0);
+  }
+
+  auto start = now_ns();
+  for (std::size_t sent = 0; sent < total_bytes; sent += chunk_size) {
+    mut client.write_all(out.slice()).unwrap();
+
+    std::size_t got = 0;
+    while (got < chunk_size) {
+      unsafe { auto rest = std2::slice_from_raw_parts(mut in.data() + got, chunk_size - got); }
+      got += mut client.read(rest).unwrap();
+    }
+  }
+  auto elapsed = now_ns() - start;
+  client.shutdown_write().unwrap();
+
+  report(name, elapsed, static_cast<std::int64_t>(total_bytes / chunk_size));
+  unsafe {
+    printf("%-48s %12.3f MB/s\n", name,
+      static_cast<double>(total_bytes) / (static_cast<double>(elapsed) / 1e9) / (1024.0 * 1024.0));
+  }
+}
+
+int main() safe
+{
+  {
+    tcp_listener listener = tcp_listener::bind(socket_address::loopback_v4(0)).unwrap();
+    std::uint16_t port = listener.local_addr().unwrap().port();
+    std2::thread t(blocking_echo_server, rel listener);
+    run_client(port, "echo, blocking server (64 KiB chunks)");
+    t rel.join();
+  }
+
+  {
+    tcp_listener listener = tcp_listener::bind(socket_address::loopback_v4(0)).unwrap();
+    std::uint16_t port = listener.local_addr().unwrap().port();
+    std2::thread t(async_echo_server, rel listener);
+    run_client(port, "echo, epoll reactor server (64 KiB chunks)");
+    t rel.join();
+  }
+}
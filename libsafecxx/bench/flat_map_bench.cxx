@@ -0,0 +1,77 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Lookups in small tables: flat_map's branchless search over the key
+// column against a linear scan of the unsorted entries. Costs are per
+// lookup, with keys drawn at random so half of them miss.
+
+static std::size_t const lookups = std::size_t(1) << 24;
+
+std2::vector<(int, int)> make_entries(int n) safe
+{
+  std2::vector<(int, int)> v = {};
+  for (int i = 0; i < n; ++i) {
+    // Even keys only, so odd lookups miss.
+    int const k = 2 * ((i * 7919) % n);
+    mut v.push_back((k, i));
+  }
+  return v;
+}
+
+long long scan(const [(int, int); dyn]^ s, int k) safe
+{
+  for (std::size_t i = 0; i < (*s)~length; ++i) {
+    if ((*s)[i].0 == k) return (*s)[i].1;
+  }
+  return -1;
+}
+
+void run(int n) safe
+{
+  std2::vector<(int, int)> entries = make_entries(n);
+  std2::flat_map<int, int> m(make_entries(n));
+
+  unsafe { char label[96]; }
+
+  {
+    xorshift rng{ 0x9e3779b9 };
+    auto start = now_ns();
+    long long s = 0;
+    for (std::size_t q = 0; q < lookups; ++q) {
+      s += scan(entries.slice(), static_cast<int>(mut rng() % static_cast<std::uint64_t>(2 * n)));
+    }
+    do_not_optimize(^s);
+    unsafe { snprintf(label, sizeof(label), "linear scan (n = %d)", n); }
+    report(label, now_ns() - start, std::int64_t(lookups));
+  }
+
+  {
+    xorshift rng{ 0x9e3779b9 };
+    auto start = now_ns();
+    long long s = 0;
+    for (std::size_t q = 0; q < lookups; ++q) {
+      int const k = static_cast<int>(mut rng() % static_cast<std::uint64_t>(2 * n));
+      s += match(m.get(k)) -> long long {
+        .some(v) => *v;
+        .none    => -1;
+      };
+    }
+    do_not_optimize(^s);
+    unsafe { snprintf(label, sizeof(label), "flat_map::get (n = %d)", n); }
+    report(label, now_ns() - start, std::int64_t(lookups));
+  }
+}
+
+int main() safe
+{
+  run(16);
+  run(128);
+  run(1024);
+}
@@ -0,0 +1,94 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Reductions over vector<float> driven by next() against the same
+// reductions through iter::fold, which runs slice_iterator's pointer loop.
+// Results are reported in GB/s of input. Without -ffast-math the compiler
+// must keep the float additions in order, so only min and max can
+// vectorize.
+
+namespace iter = std2::iter;
+
+static std::size_t const n = std::size_t(1) << 26;
+static int const rounds = 10;
+
+std2::vector<float> make_input() safe
+{
+  std2::vector<float> v = {};
+  mut v.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    mut v.push_back(static_cast<float>(i % 1024) * 0.5f);
+  }
+  return v;
+}
+
+void report_bandwidth(char const* name, std::int64_t ns) safe
+{
+  double const bytes = static_cast<double>(n) * sizeof(float) * rounds;
+  unsafe { printf("%-48s %12.3f ms %10.3f GB/s\n", name, static_cast<double>(ns) / 1e6, bytes / static_cast<double>(ns)); }
+}
+
+struct add
+{
+  float operator()(self^, float acc, float const^ x) safe {
+    return acc + *x;
+  }
+};
+
+struct minimum
+{
+  float operator()(self^, float acc, float const^ x) safe {
+    return *x < acc ? *x : acc;
+  }
+};
+
+struct maximum
+{
+  float operator()(self^, float acc, float const^ x) safe {
+    return acc < *x ? *x : acc;
+  }
+};
+
+template<class F>
+void bench(char const* next_name, char const* fold_name, std2::vector<float> const^ v, float init) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      float acc = init;
+      F f{};
+      auto it = v.iter();
+      while (true) {
+        auto x = mut it.std2::iterator::next();
+        if (x.is_none()) break;
+        acc = mut f(acc, x.unwrap());
+      }
+      do_not_optimize(^acc);
+    }
+    report_bandwidth(next_name, now_ns() - start);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      float acc = iter::fold(v.iter(), init, F{});
+      do_not_optimize(^acc);
+    }
+    report_bandwidth(fold_name, now_ns() - start);
+  }
+}
+
+int main() safe
+{
+  std2::vector<float> v = make_input();
+  bench<add>("sum: next()", "sum: iter::fold", v, 0.0f);
+  bench<minimum>("min: next()", "min: iter::fold", v, 1e30f);
+  bench<maximum>("max: next()", "max: iter::fold", v, -1e30f);
+}
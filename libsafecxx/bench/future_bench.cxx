@@ -0,0 +1,115 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Overhead of spawning and awaiting tasks on std2::local_executor, and of a
+// single poll/wake round trip.
+
+static int const num_tasks = 100'000;
+static int const num_yields = 1'000'000;
+
+class yield_n
+{
+  int remaining_;
+
+public:
+  explicit yield_n(int n) safe
+    : remaining_(n)
+  {
+  }
+
+  std2::poll_result<int> poll(self^, std2::context^ cx) safe {
+    if (self->remaining_ == 0) return .ready(0);
+
+    --self->remaining_;
+    cx.get_waker().wake();
+    return .pending;
+  }
+};
+
+impl yield_n: std2::future
+{
+  using output_type = int;
+
+  std2::poll_result<output_type> poll(self^, std2::context^ cx) safe override {
+    return self.poll(cx);
+  }
+};
+
+// Awaits every handle in order and sums their outputs.
+class join_all
+{
+  std2::vector<std2::join_handle<int>> handles_;
+  std::size_t next_;
+  int sum_;
+
+public:
+  explicit join_all(std2::vector<std2::join_handle<int>> handles) safe
+    : handles_(rel handles)
+    , next_(0)
+    , sum_(0)
+  {
+  }
+
+  std2::poll_result<int> poll(self^, std2::context^ cx) safe {
+    while (self->next_ < self->handles_.size()) {
+      std2::join_handle<int>^ h = (^self->handles_)[self->next_];
+      std2::poll_result<int> r = mut h.poll(cx);
+      if (r.is_pending()) return .pending;
+
+      self->sum_ += r rel.unwrap();
+      ++self->next_;
+    }
+    return .ready(self->sum_);
+  }
+};
+
+impl join_all: std2::future
+{
+  using output_type = int;
+
+  std2::poll_result<output_type> poll(self^, std2::context^ cx) safe override {
+    return self.poll(cx);
+  }
+};
+
+void spawn_await() safe
+{
+  std2::local_executor ex{};
+  std2::vector<std2::join_handle<int>> handles = {};
+  mut handles.reserve(static_cast<std::size_t>(num_tasks));
+
+  auto start = now_ns();
+  for (int i = 0; i < num_tasks; ++i) {
+    mut handles.push_back(ex.spawn(std2::ready_future<int>(1)));
+  }
+  int sum = mut ex.block_on(join_all(rel handles));
+  auto elapsed = now_ns() - start;
+
+  do_not_optimize(^sum);
+  report("spawn + await ready_future", elapsed, num_tasks);
+}
+
+void poll_wake() safe
+{
+  std2::local_executor ex{};
+
+  auto start = now_ns();
+  int r = mut ex.block_on(yield_n(num_yields));
+  auto elapsed = now_ns() - start;
+
+  do_not_optimize(^r);
+  report("poll + wake round trip", elapsed, num_yields);
+}
+
+int main() safe
+{
+  spawn_await();
+  poll_wake();
+}
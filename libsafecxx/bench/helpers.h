@@ -0,0 +1,52 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#feature on safety
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+using bench_clock = std::chrono::steady_clock;
+
+inline
+std::int64_t now_ns() safe
+{
+  unsafe {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      bench_clock::now().time_since_epoch()).count();
+  }
+}
+
+// Prints one row of results: total wall time and the cost per operation.
+inline
+void report(char const* name, std::int64_t ns, std::int64_t ops) safe
+{
+  double const per_op = ops ? static_cast<double>(ns) / static_cast<double>(ops) : 0.0;
+  unsafe {
+    printf("%-48s %12.3f ms %10.3f ns/op\n", name, static_cast<double>(ns) / 1e6, per_op);
+  }
+}
+
+// Marsaglia's xorshift64, for inputs that are random but the same on every
+// run. The seed must be non-zero.
+struct xorshift
+{
+  std::uint64_t s;
+
+  std::uint64_t operator()(self^) safe {
+    self->s ^= self->s << 13;
+    self->s ^= self->s >> 7;
+    self->s ^= self->s << 17;
+    return self->s;
+  }
+};
+
+// Keeps the optimizer from discarding a computed value.
+template<class T>
+void do_not_optimize(const T^ t) safe
+{
+  unsafe { asm volatile("" : : "r"(addr *t) : "memory"); }
+}
@@ -0,0 +1,116 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Adaptor chains against the equivalent hand-written loops over
+// slice_iterator. After inlining each pair should cost the same.
+
+namespace iter = std2::iter;
+
+static int const n = 1 << 24;
+static int const rounds = 20;
+
+std2::vector<int> make_input() safe
+{
+  std2::vector<int> v = {};
+  mut v.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    mut v.push_back(i * 7 % 100);
+  }
+  return v;
+}
+
+void sum(std2::vector<int> const^ v) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      long long s = 0;
+      for (int x : v.iter()) s += x;
+      do_not_optimize(^s);
+    }
+    report("sum: loop", now_ns() - start, std::int64_t(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      int s = iter::sum(iter::copied(v.iter()));
+      do_not_optimize(^s);
+    }
+    report("sum: iter::sum(copied)", now_ns() - start, std::int64_t(n) * rounds);
+  }
+}
+
+void map_filter_sum(std2::vector<int> const^ v) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      long long s = 0;
+      for (int x : v.iter()) {
+        long long y = static_cast<long long>(x) * 3;
+        if (y % 2 == 0) s += y;
+      }
+      do_not_optimize(^s);
+    }
+    report("map/filter/sum: loop", now_ns() - start, std::int64_t(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      auto it = iter::filter(
+        iter::map(iter::copied(v.iter()), [](int x) safe { return static_cast<long long>(x) * 3; }),
+        [](long long const^ y) safe { return *y % 2 == 0; });
+      long long s = iter::sum(rel it);
+      do_not_optimize(^s);
+    }
+    report("map/filter/sum: adaptors", now_ns() - start, std::int64_t(n) * rounds);
+  }
+}
+
+void zip_dot(std2::vector<int> const^ v) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      long long s = 0;
+      auto a = v.iter();
+      auto b = v.iter();
+      while (true) {
+        auto x = mut a.std2::iterator::next();
+        auto y = mut b.std2::iterator::next();
+        if (x.is_none() || y.is_none()) break;
+        s += static_cast<long long>(*x.unwrap()) * *y.unwrap();
+      }
+      do_not_optimize(^s);
+    }
+    report("dot: loop", now_ns() - start, std::int64_t(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      long long s = iter::fold(
+        iter::zip(iter::copied(v.iter()), iter::copied(v.iter())), 0ll,
+        [](long long acc, (int, int) p) safe { return acc + static_cast<long long>(p.0) * p.1; });
+      do_not_optimize(^s);
+    }
+    report("dot: zip/fold", now_ns() - start, std::int64_t(n) * rounds);
+  }
+}
+
+int main() safe
+{
+  std2::vector<int> v = make_input();
+  sum(v);
+  map_filter_sum(v);
+  zip_dot(v);
+}
@@ -0,0 +1,65 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Strong scaling of par_sort and par_sort_unstable on random u64 keys at
+// 1 to 64 threads. Costs are per element; the speedup column is relative to
+// one thread.
+
+static std::size_t const n = std::size_t(1) << 26;
+static int const rounds = 3;
+
+std2::vector<std::uint64_t> make_input() safe
+{
+  std2::vector<std::uint64_t> v = {};
+  mut v.reserve(n);
+  xorshift rng{ 0x9e3779b97f4a7c15 };
+  for (std::size_t i = 0; i < n; ++i) {
+    mut v.push_back(mut rng());
+  }
+  return v;
+}
+
+std::int64_t run(bool stable, std::size_t threads, std2::vector<std::uint64_t> const^ input) safe
+{
+  std::int64_t elapsed = 0;
+  for (int r = 0; r < rounds; ++r) {
+    std2::vector<std::uint64_t> v = {};
+    mut v.extend_from_slice(input.slice());
+
+    auto start = now_ns();
+    if (stable) std2::par_sort_by(mut v.slice(), std2::default_less{}, threads);
+    else std2::par_sort_unstable_by(mut v.slice(), std2::default_less{}, threads);
+    elapsed += now_ns() - start;
+    do_not_optimize(^v);
+  }
+  return elapsed;
+}
+
+int main() safe
+{
+  std2::vector<std::uint64_t> input = make_input();
+  std::size_t const thread_counts[] { 1, 2, 4, 8, 16, 32, 64 };
+
+  for (int stable = 1; stable >= 0; --stable) {
+    std::int64_t base = 0;
+    for (std::size_t t : thread_counts) {
+      std::int64_t const ns = run(stable != 0, t, input);
+      if (t == 1) base = ns;
+
+      unsafe { char label[64]; }
+      unsafe {
+        snprintf(label, sizeof(label), "%s, %zu threads (%.2fx)",
+          stable ? "par_sort" : "par_sort_unstable", t,
+          static_cast<double>(base) / static_cast<double>(ns));
+      }
+      report(label, ns, static_cast<std::int64_t>(n) * rounds);
+    }
+  }
+}
@@ -0,0 +1,104 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// radix_sort and par_radix_sort against sort_unstable (pdqsort) on random
+// u64 keys, doubles and short strings. Costs are per element.
+
+static std::size_t const n = std::size_t(1) << 24;
+static int const rounds = 3;
+
+template<class T>
+void run(char const* name, int which, std2::vector<T> const^ input) safe
+{
+  std::int64_t elapsed = 0;
+  for (int r = 0; r < rounds; ++r) {
+    std2::vector<T> v = {};
+    mut v.extend_from_slice(input.slice());
+
+    auto start = now_ns();
+    if (which == 0) std2::sort_unstable(mut v.slice());
+    else if (which == 1) std2::radix_sort(mut v.slice());
+    else std2::par_radix_sort(mut v.slice());
+    elapsed += now_ns() - start;
+    do_not_optimize(^v);
+  }
+  report(name, elapsed, static_cast<std::int64_t>(input.size()) * rounds);
+}
+
+void strings() safe
+{
+  std::size_t const count = n / 8;
+  std2::str const words[] {
+    "ab", "cd", "ef", "gh", "ij", "kl", "mn", "op",
+    "qr", "st", "uv", "wx", "yz", "abc", "def", "ghi",
+  };
+
+  std2::vector<std2::string> input = {};
+  xorshift rng{ 11 };
+  for (std::size_t i = 0; i < count; ++i) {
+    std::uint64_t x = mut rng();
+    std2::string s = {};
+    std::size_t const parts = 2 + x % 4;
+    for (std::size_t j = 0; j < parts; ++j) {
+      mut s.append(words[(x >> (4 * j + 8)) % 16]);
+    }
+    mut input.push_back(rel s);
+  }
+
+  for (int which = 0; which < 2; ++which) {
+    std::int64_t elapsed = 0;
+    for (int r = 0; r < rounds; ++r) {
+      std2::vector<std2::string> v = {};
+      for (std2::string const^ s : input.iter()) mut v.push_back(std2::string(s->str()));
+
+      auto start = now_ns();
+      if (which == 0) {
+        std2::sort_unstable_by(mut v.slice(), [](std2::string const^ a, std2::string const^ b) safe {
+          std2::str x = a->str();
+          std2::str y = b->str();
+          std::size_t const m = x.size() < y.size() ? x.size() : y.size();
+          unsafe { int c = std::memcmp(x.data(), y.data(), m); }
+          return c < 0 || (c == 0 && x.size() < y.size());
+        });
+      } else {
+        std2::radix_sort(mut v.slice());
+      }
+      elapsed += now_ns() - start;
+      do_not_optimize(^v);
+    }
+    report(which == 0 ? "string: sort_unstable" : "string: radix_sort (MSD)",
+      elapsed, static_cast<std::int64_t>(count) * rounds);
+  }
+}
+
+int main() safe
+{
+  {
+    std2::vector<std::uint64_t> input = {};
+    xorshift rng{ 7 };
+    for (std::size_t i = 0; i < n; ++i) mut input.push_back(mut rng());
+    run("u64: sort_unstable", 0, input);
+    run("u64: radix_sort", 1, input);
+    run("u64: par_radix_sort", 2, input);
+  }
+
+  {
+    std2::vector<double> input = {};
+    xorshift rng{ 9 };
+    for (std::size_t i = 0; i < n; ++i) {
+      mut input.push_back(static_cast<double>(static_cast<std::int64_t>(mut rng())) * 1e-9);
+    }
+    run("double: sort_unstable", 0, input);
+    run("double: radix_sort", 1, input);
+    run("double: par_radix_sort", 2, input);
+  }
+
+  strings();
+}
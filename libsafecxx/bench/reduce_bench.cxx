@@ -0,0 +1,145 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// The slice reductions against checked element loops, reported in GB/s of
+// input so each can be compared with memory bandwidth. The input is sized
+// well past the last-level cache.
+
+static std::size_t const n = std::size_t(1) << 26;
+static int const rounds = 10;
+
+void report_bandwidth(char const* name, std::int64_t ns, std::size_t bytes_per_round) safe
+{
+  double const bytes = static_cast<double>(bytes_per_round) * rounds;
+  unsafe { printf("%-48s %12.3f ms %10.3f GB/s\n", name, static_cast<double>(ns) / 1e6, bytes / static_cast<double>(ns)); }
+}
+
+float loop_sum(const [float; dyn]^ s) safe
+{
+  float acc = 0;
+  for (std::size_t i = 0; i < (*s)~length; ++i) acc += (*s)[i];
+  return acc;
+}
+
+float loop_min(const [float; dyn]^ s) safe
+{
+  float acc = (*s)[0];
+  for (std::size_t i = 1; i < (*s)~length; ++i) acc = (*s)[i] < acc ? (*s)[i] : acc;
+  return acc;
+}
+
+float loop_dot(const [float; dyn]^ a, const [float; dyn]^ b) safe
+{
+  float acc = 0;
+  for (std::size_t i = 0; i < (*a)~length; ++i) acc += (*a)[i] * (*b)[i];
+  return acc;
+}
+
+template<class F>
+void run(char const* name, std::size_t bytes, F f) safe
+{
+  auto start = now_ns();
+  for (int r = 0; r < rounds; ++r) {
+    auto x = mut f();
+    do_not_optimize(^x);
+  }
+  report_bandwidth(name, now_ns() - start, bytes);
+}
+
+struct sum_task/(a)
+{
+  const [float; dyn]^/a s;
+  int kind;
+
+  float operator()(self^) safe {
+    if (self->kind == 0) return loop_sum(self->s);
+    if (self->kind == 1) return std2::sum(self->s);
+    if (self->kind == 2) return std2::pairwise_sum(self->s);
+    return std2::kahan_sum(self->s);
+  }
+};
+
+struct min_task/(a)
+{
+  const [float; dyn]^/a s;
+  int kind;
+
+  float operator()(self^) safe {
+    if (self->kind == 0) return loop_min(self->s);
+    if (self->kind == 1) return std2::min(self->s).unwrap();
+    return static_cast<float>(std2::argmin(self->s).unwrap());
+  }
+};
+
+struct dot_task/(a)
+{
+  const [float; dyn]^/a x;
+  const [float; dyn]^/a y;
+  int kind;
+
+  float operator()(self^) safe {
+    if (self->kind == 0) return loop_dot(self->x, self->y);
+    return std2::dot(self->x, self->y);
+  }
+};
+
+int main() safe
+{
+  std2::vector<float> a = {};
+  std2::vector<float> b = {};
+  mut a.reserve(n);
+  mut b.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    mut a.push_back(static_cast<float>(i % 1024) * 0.5f);
+    mut b.push_back(static_cast<float>(i % 7));
+  }
+
+  std::size_t const bytes = n * sizeof(float);
+  run("sum: checked loop", bytes, sum_task{ a.slice(), 0 });
+  run("sum: std2::sum", bytes, sum_task{ a.slice(), 1 });
+  run("sum: std2::pairwise_sum", bytes, sum_task{ a.slice(), 2 });
+  run("sum: std2::kahan_sum", bytes, sum_task{ a.slice(), 3 });
+  run("min: checked loop", bytes, min_task{ a.slice(), 0 });
+  run("min: std2::min", bytes, min_task{ a.slice(), 1 });
+  run("argmin: std2::argmin", bytes, min_task{ a.slice(), 2 });
+  run("dot: checked loop", 2 * bytes, dot_task{ a.slice(), b.slice(), 0 });
+  run("dot: std2::dot", 2 * bytes, dot_task{ a.slice(), b.slice(), 1 });
+
+  {
+    std2::vector<int> v = {};
+    for (std::size_t i = 0; i < n; ++i) mut v.push_back(1);
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std2::prefix_sum(mut v.slice());
+      do_not_optimize(v[n - 1]);
+    }
+    report_bandwidth("prefix_sum (read + write)", now_ns() - start, 2 * n * sizeof(int));
+  }
+
+  {
+    std2::vector<std2::u8> bytes_in = {};
+    for (std::size_t i = 0; i < n; ++i) mut bytes_in.push_back(static_cast<std2::u8>((i * 2654435761u) >> 11));
+    std2::vector<std::uint64_t> counts = {};
+    for (int i = 0; i < 256; ++i) mut counts.push_back(0);
+
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      for (std::size_t i = 0; i < n; ++i) {
+        unsafe { ++(mut counts.data())[bytes_in[i]]; }
+      }
+    }
+    report_bandwidth("histogram: one table", now_ns() - start, n);
+
+    start = now_ns();
+    for (int r = 0; r < rounds; ++r) std2::histogram(bytes_in.slice(), mut counts.slice());
+    report_bandwidth("histogram: std2::histogram", now_ns() - start, n);
+    do_not_optimize(counts[0]);
+  }
+}
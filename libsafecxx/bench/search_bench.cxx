@@ -0,0 +1,109 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Random lookups in sorted arrays from L1-sized to well past the last-level
+// cache: a branchy textbook binary search, the branchless lower_bound and
+// the Eytzinger layout. Then select_nth_unstable against a full sort for
+// finding a median. Costs are per lookup and per element.
+
+static std::size_t const queries = std::size_t(1) << 22;
+
+std::size_t branchy_lower_bound(const [int; dyn]^ s, int x) safe
+{
+  std::size_t lo = 0;
+  std::size_t hi = (*s)~length;
+  while (lo < hi) {
+    std::size_t const m = lo + (hi - lo) / 2;
+    if ((*s)[m] < x) lo = m + 1;
+    else hi = m;
+  }
+  return lo;
+}
+
+void lookups(std::size_t n) safe
+{
+  std2::vector<int> keys = {};
+  for (std::size_t i = 0; i < n; ++i) mut keys.push_back(static_cast<int>(2 * i));
+  std2::eytzinger<int> tree(keys.slice());
+
+  std2::vector<int> qs = {};
+  xorshift rng{ 5 };
+  for (std::size_t i = 0; i < queries; ++i) {
+    mut qs.push_back(static_cast<int>(mut rng() % (2 * n)));
+  }
+
+  unsafe { char label[96]; }
+
+  {
+    auto start = now_ns();
+    std::size_t acc = 0;
+    for (int q : qs.iter()) acc += branchy_lower_bound(keys.slice(), q);
+    do_not_optimize(^acc);
+    unsafe { snprintf(label, sizeof(label), "branchy binary search (n = %zu)", n); }
+    report(label, now_ns() - start, queries);
+  }
+
+  {
+    auto start = now_ns();
+    std::size_t acc = 0;
+    for (int q : qs.iter()) acc += std2::lower_bound(keys.slice(), q);
+    do_not_optimize(^acc);
+    unsafe { snprintf(label, sizeof(label), "lower_bound (n = %zu)", n); }
+    report(label, now_ns() - start, queries);
+  }
+
+  {
+    auto start = now_ns();
+    long long acc = 0;
+    for (int q : qs.iter()) {
+      acc += match(tree.lower_bound(q)) -> int {
+        .some(x) => x;
+        .none    => 0;
+      };
+    }
+    do_not_optimize(^acc);
+    unsafe { snprintf(label, sizeof(label), "eytzinger lower_bound (n = %zu)", n); }
+    report(label, now_ns() - start, queries);
+  }
+}
+
+void median() safe
+{
+  std::size_t const n = std::size_t(1) << 24;
+  std2::vector<int> input = {};
+  xorshift rng{ 17 };
+  for (std::size_t i = 0; i < n; ++i) mut input.push_back(static_cast<int>(mut rng()));
+
+  {
+    std2::vector<int> v = {};
+    mut v.extend_from_slice(input.slice());
+    auto start = now_ns();
+    int m = *std2::select_nth_unstable(mut v.slice(), n / 2).1;
+    report("median: select_nth_unstable", now_ns() - start, n);
+    do_not_optimize(^m);
+  }
+
+  {
+    std2::vector<int> v = {};
+    mut v.extend_from_slice(input.slice());
+    auto start = now_ns();
+    std2::sort_unstable(mut v.slice());
+    int m = v[n / 2];
+    report("median: sort_unstable", now_ns() - start, n);
+    do_not_optimize(^m);
+  }
+}
+
+int main() safe
+{
+  std::size_t const sizes[] { std::size_t(1) << 10, std::size_t(1) << 16, std::size_t(1) << 20, std::size_t(1) << 25 };
+  for (std::size_t n : sizes) lookups(n);
+  median();
+}
@@ -0,0 +1,126 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Reader scaling of seqlock::read against shared_mutex::lock_shared on a small
+// record. A single writer updates the record at a low rate throughout.
+
+struct rate_limit
+{
+  std::int64_t tokens;
+  std::int64_t refill_ns;
+};
+
+static int const num_reads = 1'000'000;
+
+using seqlock_type = std2::seqlock<rate_limit>;
+using shared_mutex_type = std2::shared_mutex<rate_limit>;
+
+void seqlock_reader(std2::arc<seqlock_type> sp) safe
+{
+  std::int64_t sum = 0;
+  for (int i = 0; i < num_reads; ++i) {
+    rate_limit r = sp->read();
+    sum += r.tokens;
+  }
+  do_not_optimize(^sum);
+  drp sp;
+}
+
+void shared_mutex_reader(std2::arc<shared_mutex_type> sp) safe
+{
+  std::int64_t sum = 0;
+  for (int i = 0; i < num_reads; ++i) {
+    auto guard = sp->lock_shared();
+    sum += (*guard).tokens;
+  }
+  do_not_optimize(^sum);
+  drp sp;
+}
+
+void seqlock_writer(std2::arc<seqlock_type> sp, std2::arc<std2::mutex<bool>> done) safe
+{
+  while (!*done->lock()) {
+    {
+      auto guard = sp->lock();
+      mut guard.borrow()->tokens += 1;
+    }
+    unsafe { std::this_thread::sleep_for(std::chrono::microseconds(100)); }
+  }
+  drp sp;
+  drp done;
+}
+
+void shared_mutex_writer(std2::arc<shared_mutex_type> sp, std2::arc<std2::mutex<bool>> done) safe
+{
+  while (!*done->lock()) {
+    {
+      auto guard = sp->lock();
+      mut guard.borrow()->tokens += 1;
+    }
+    unsafe { std::this_thread::sleep_for(std::chrono::microseconds(100)); }
+  }
+  drp sp;
+  drp done;
+}
+
+void run_seqlock(int num_threads) safe
+{
+  std2::arc<seqlock_type> sp{seqlock_type(rate_limit{0, 1000})};
+  std2::arc<std2::mutex<bool>> done{std2::mutex(false)};
+  std2::thread w(seqlock_writer, cpy sp, cpy done);
+
+  std2::vector<std2::thread> threads = {};
+  auto start = now_ns();
+  for (int i = 0; i < num_threads; ++i) {
+    mut threads.push_back(std2::thread(seqlock_reader, cpy sp));
+  }
+  for (std2::thread t : rel threads) {
+    t rel.join();
+  }
+  auto elapsed = now_ns() - start;
+
+  *done->lock()^.borrow() = true;
+  w rel.join();
+
+  unsafe { char name[64]; snprintf(name, sizeof(name), "seqlock::read %2d threads", num_threads); }
+  unsafe { report(name, elapsed, static_cast<std::int64_t>(num_threads) * num_reads); }
+}
+
+void run_shared_mutex(int num_threads) safe
+{
+  std2::arc<shared_mutex_type> sp{shared_mutex_type(rate_limit{0, 1000})};
+  std2::arc<std2::mutex<bool>> done{std2::mutex(false)};
+  std2::thread w(shared_mutex_writer, cpy sp, cpy done);
+
+  std2::vector<std2::thread> threads = {};
+  auto start = now_ns();
+  for (int i = 0; i < num_threads; ++i) {
+    mut threads.push_back(std2::thread(shared_mutex_reader, cpy sp));
+  }
+  for (std2::thread t : rel threads) {
+    t rel.join();
+  }
+  auto elapsed = now_ns() - start;
+
+  *done->lock()^.borrow() = true;
+  w rel.join();
+
+  unsafe { char name[64]; snprintf(name, sizeof(name), "shared_mutex::lock_shared %2d threads", num_threads); }
+  unsafe { report(name, elapsed, static_cast<std::int64_t>(num_threads) * num_reads); }
+}
+
+int main() safe
+{
+  unsafe { int const hw = static_cast<int>(std::thread::hardware_concurrency()); }
+  for (int n = 1; n <= hw; n *= 2) {
+    run_seqlock(n);
+    run_shared_mutex(n);
+  }
+}
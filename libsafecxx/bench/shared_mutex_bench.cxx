@@ -0,0 +1,108 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Read-heavy (99% shared, 1% exclusive) scalability of std2::shared_mutex
+// against a single-counter std::shared_mutex.
+
+static int const num_ops = 1'000'000;
+
+using shared_mutex_type = std2::shared_mutex<std::int64_t>;
+
+struct [[unsafe::send, unsafe::sync]] legacy_shared_mutex
+{
+  std::shared_mutex unsafe mtx_;
+  std::int64_t unsafe value_;
+
+  legacy_shared_mutex() safe
+    : unsafe mtx_()
+    , value_(0)
+  {
+  }
+};
+
+void std2_worker(std2::arc<shared_mutex_type> sp) safe
+{
+  std::int64_t sum = 0;
+  for (int i = 0; i < num_ops; ++i) {
+    if (i % 100 == 0) {
+      auto guard = sp->lock();
+      mut *guard.borrow() += 1;
+    } else {
+      auto guard = sp->lock_shared();
+      sum += *guard;
+    }
+  }
+  do_not_optimize(^sum);
+  drp sp;
+}
+
+void legacy_worker(std2::arc<legacy_shared_mutex> sp) safe
+{
+  std::int64_t sum = 0;
+  for (int i = 0; i < num_ops; ++i) {
+    unsafe {
+      legacy_shared_mutex* p = const_cast<legacy_shared_mutex*>(addr *sp.operator->());
+      if (i % 100 == 0) {
+        std::unique_lock<std::shared_mutex> lk(p->mtx_);
+        p->value_ += 1;
+      } else {
+        std::shared_lock<std::shared_mutex> lk(p->mtx_);
+        sum += p->value_;
+      }
+    }
+  }
+  do_not_optimize(^sum);
+  drp sp;
+}
+
+void run_std2(int num_threads) safe
+{
+  std2::arc<shared_mutex_type> sp{shared_mutex_type(0)};
+  std2::vector<std2::thread> threads = {};
+
+  auto start = now_ns();
+  for (int i = 0; i < num_threads; ++i) {
+    mut threads.push_back(std2::thread(std2_worker, cpy sp));
+  }
+  for (std2::thread t : rel threads) {
+    t rel.join();
+  }
+  auto elapsed = now_ns() - start;
+
+  unsafe { char name[64]; snprintf(name, sizeof(name), "std2::shared_mutex 99/1 %2d threads", num_threads); }
+  unsafe { report(name, elapsed, static_cast<std::int64_t>(num_threads) * num_ops); }
+}
+
+void run_legacy(int num_threads) safe
+{
+  std2::arc<legacy_shared_mutex> sp{legacy_shared_mutex()};
+  std2::vector<std2::thread> threads = {};
+
+  auto start = now_ns();
+  for (int i = 0; i < num_threads; ++i) {
+    mut threads.push_back(std2::thread(legacy_worker, cpy sp));
+  }
+  for (std2::thread t : rel threads) {
+    t rel.join();
+  }
+  auto elapsed = now_ns() - start;
+
+  unsafe { char name[64]; snprintf(name, sizeof(name), "std::shared_mutex 99/1 %2d threads", num_threads); }
+  unsafe { report(name, elapsed, static_cast<std::int64_t>(num_threads) * num_ops); }
+}
+
+int main() safe
+{
+  unsafe { int const hw = static_cast<int>(std::thread::hardware_concurrency()); }
+  for (int n = 1; n <= hw; n *= 2) {
+    run_std2(n);
+    run_legacy(n);
+  }
+}
@@ -0,0 +1,173 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Scalar loops against native_simd kernels: a float dot product, a byte
+// histogram and a search for a byte. Build with -mavx2 or -mavx512f to
+// compare widths; the ISA the CPU offers is printed first. Costs are per
+// element.
+
+using std2::u8;
+
+static std::size_t const n = std::size_t(1) << 24;
+static int const rounds = 20;
+
+char const* isa_name(std2::simd_isa isa) safe
+{
+  if (isa == std2::simd_isa::avx512) return "avx512";
+  if (isa == std2::simd_isa::avx2) return "avx2";
+  if (isa == std2::simd_isa::sse2) return "sse2";
+  return "scalar";
+}
+
+float dot_scalar(const [float; dyn]^ a, const [float; dyn]^ b) safe
+{
+  float acc = 0;
+  for (std::size_t i = 0; i < (*a)~length; ++i) acc += (*a)[i] * (*b)[i];
+  return acc;
+}
+
+float dot_simd(const [float; dyn]^ a, const [float; dyn]^ b) safe
+{
+  using V = std2::native_simd<float>;
+  std::size_t const len = (*a)~length;
+
+  // Four accumulators hide the latency of the adds.
+  V acc0{};
+  V acc1{};
+  V acc2{};
+  V acc3{};
+  std::size_t i = 0;
+  for (; i + 4 * V::size <= len; i += 4 * V::size) {
+    mut acc0 += V::load(a, i) * V::load(b, i);
+    mut acc1 += V::load(a, i + V::size) * V::load(b, i + V::size);
+    mut acc2 += V::load(a, i + 2 * V::size) * V::load(b, i + 2 * V::size);
+    mut acc3 += V::load(a, i + 3 * V::size) * V::load(b, i + 3 * V::size);
+  }
+  for (; i < len; i += V::size) {
+    mut acc0 += V::load_partial(a, i) * V::load_partial(b, i);
+  }
+  return ((acc0 + acc1) + (acc2 + acc3)).reduce_add();
+}
+
+void histogram_scalar(const [u8; dyn]^ s, [std::uint32_t; 256]^ h) safe
+{
+  for (std::size_t i = 0; i < (*s)~length; ++i) ++(*h)[(*s)[i]];
+}
+
+// Four sub-histograms break the store-to-load dependency when neighbouring
+// bytes are equal. The vector loads feed the counts a register at a time.
+void histogram_simd(const [u8; dyn]^ s, [std::uint32_t; 256]^ h) safe
+{
+  using V = std2::native_simd<u8>;
+  std::uint32_t sub[4][256] {};
+  std::size_t const len = (*s)~length;
+
+  std::size_t i = 0;
+  for (; i + V::size <= len; i += V::size) {
+    V const x = V::load(s, i);
+    for (std::size_t j = 0; j < V::size; ++j) ++sub[j % 4][x[j]];
+  }
+  for (; i < len; ++i) ++sub[0][(*s)[i]];
+
+  for (std::size_t b = 0; b < 256; ++b) {
+    (*h)[b] += sub[0][b] + sub[1][b] + sub[2][b] + sub[3][b];
+  }
+}
+
+std::size_t find_scalar(const [u8; dyn]^ s, u8 needle) safe
+{
+  for (std::size_t i = 0; i < (*s)~length; ++i) {
+    if ((*s)[i] == needle) return i;
+  }
+  return (*s)~length;
+}
+
+std::size_t find_simd(const [u8; dyn]^ s, u8 needle) safe
+{
+  using V = std2::native_simd<u8>;
+  std::size_t const len = (*s)~length;
+  V const target(needle);
+
+  std::size_t i = 0;
+  for (; i + V::size <= len; i += V::size) {
+    std::uint64_t const bits = (V::load(s, i) == target).to_bitmask();
+    if (bits) return i + static_cast<std::size_t>(__builtin_ctzll(bits));
+  }
+
+  auto tail = V::load_partial(s, i) == target & V::mask_type::first_n(len - i);
+  std::uint64_t const bits = tail.to_bitmask();
+  if (bits) return i + static_cast<std::size_t>(__builtin_ctzll(bits));
+  return len;
+}
+
+int main() safe
+{
+  unsafe { printf("cpu supports: %s\n", isa_name(std2::detect_simd_isa())); }
+
+  {
+    std2::vector<float> a = {};
+    std2::vector<float> b = {};
+    for (std::size_t i = 0; i < n; ++i) {
+      mut a.push_back(static_cast<float>(i % 17) * 0.25f);
+      mut b.push_back(static_cast<float>(i % 13) * 0.5f);
+    }
+
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      float d = dot_scalar(a.slice(), b.slice());
+      do_not_optimize(^d);
+    }
+    report("dot: scalar", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+
+    start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      float d = dot_simd(a.slice(), b.slice());
+      do_not_optimize(^d);
+    }
+    report("dot: native_simd x4", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+
+  std2::vector<u8> bytes = {};
+  for (std::size_t i = 0; i < n; ++i) mut bytes.push_back(static_cast<u8>((i * 2654435761u) >> 13));
+
+  {
+    std::uint32_t h[256] {};
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) histogram_scalar(bytes.slice(), ^h);
+    do_not_optimize(h[0]);
+    report("histogram: scalar", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+
+    std::uint32_t h2[256] {};
+    start = now_ns();
+    for (int r = 0; r < rounds; ++r) histogram_simd(bytes.slice(), ^h2);
+    do_not_optimize(h2[0]);
+    report("histogram: native_simd, 4 tables", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+
+  {
+    // A byte the generator never produces, so both scans read everything.
+    std2::vector<u8> haystack = {};
+    for (std::size_t i = 0; i < n; ++i) mut haystack.push_back(static_cast<u8>(i % 255));
+
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std::size_t at = find_scalar(haystack.slice(), 255);
+      do_not_optimize(^at);
+    }
+    report("byte search: scalar", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+
+    start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std::size_t at = find_simd(haystack.slice(), 255);
+      do_not_optimize(^at);
+    }
+    report("byte search: native_simd", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+}
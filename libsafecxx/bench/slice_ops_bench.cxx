@@ -0,0 +1,167 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Bulk slice operations against the checked per-element loops they
+// replace. Costs are per element.
+
+static std::size_t const n = std::size_t(1) << 22;
+static int const rounds = 50;
+
+std2::vector<int> make_input() safe
+{
+  std2::vector<int> v = {};
+  for (std::size_t i = 0; i < n; ++i) mut v.push_back(static_cast<int>(i));
+  return v;
+}
+
+void copy([int; dyn]^ dst, const [int; dyn]^ src) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      for (std::size_t i = 0; i < n; ++i) (*dst)[i] = (*src)[i];
+      do_not_optimize((*dst)[0]);
+    }
+    report("copy: element loop", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std2::copy_from_slice(dst, src);
+      do_not_optimize((*dst)[0]);
+    }
+    report("copy: copy_from_slice", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+}
+
+void fill([int; dyn]^ v) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      for (std::size_t i = 0; i < n; ++i) (*v)[i] = 0;
+      do_not_optimize((*v)[0]);
+    }
+    report("fill 0: element loop", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std2::fill(v, 0);
+      do_not_optimize((*v)[0]);
+    }
+    report("fill 0: fill (memset)", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std2::fill(v, 12345);
+      do_not_optimize((*v)[0]);
+    }
+    report("fill 12345: fill", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+}
+
+void reverse([int; dyn]^ v) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      for (std::size_t i = 0; i < n / 2; ++i) {
+        int const t = (*v)[i];
+        (*v)[i] = (*v)[n - 1 - i];
+        (*v)[n - 1 - i] = t;
+      }
+      do_not_optimize((*v)[0]);
+    }
+    report("reverse: element loop", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std2::reverse(v);
+      do_not_optimize((*v)[0]);
+    }
+    report("reverse: reverse", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+}
+
+void rotate([int; dyn]^ v) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      // Rotate by one with a loop, the common shift-a-window case.
+      int const first = (*v)[0];
+      for (std::size_t i = 1; i < n; ++i) (*v)[i - 1] = (*v)[i];
+      (*v)[n - 1] = first;
+      do_not_optimize((*v)[0]);
+    }
+    report("rotate by 1: element loop", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std2::rotate_left(v, 1);
+      do_not_optimize((*v)[0]);
+    }
+    report("rotate by 1: rotate_left", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std2::rotate_left(v, n / 3);
+      do_not_optimize((*v)[0]);
+    }
+    report("rotate by n/3: rotate_left", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+}
+
+void swap([int; dyn]^ a, [int; dyn]^ b) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      for (std::size_t i = 0; i < n; ++i) {
+        int const t = (*a)[i];
+        (*a)[i] = (*b)[i];
+        (*b)[i] = t;
+      }
+      do_not_optimize((*a)[0]);
+    }
+    report("swap: element loop", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      std2::swap_with_slice(a, b);
+      do_not_optimize((*a)[0]);
+    }
+    report("swap: swap_with_slice", now_ns() - start, static_cast<std::int64_t>(n) * rounds);
+  }
+}
+
+int main() safe
+{
+  std2::vector<int> a = make_input();
+  std2::vector<int> b = make_input();
+  copy(a.slice(), b.slice());
+  fill(a.slice());
+  reverse(a.slice());
+  rotate(a.slice());
+  swap(a.slice(), b.slice());
+}
@@ -0,0 +1,111 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// A twelve-field particle stored as vector<particle> and as
+// soa_vector<particle>. The kernels touch two and four fields, so the
+// array-of-structs layout pulls 48 bytes through cache for every 8 or 16
+// it uses. Costs are per particle.
+
+struct particle
+{
+  float x, y, z;
+  float vx, vy, vz;
+  float mass;
+  float charge;
+  float age;
+  float lifetime;
+  int kind;
+  int flags;
+};
+
+static std::size_t const n = std::size_t(1) << 22;
+static int const rounds = 50;
+static float const dt = 0.01f;
+
+particle make_particle(std::size_t i) safe
+{
+  float const f = static_cast<float>(i % 1000);
+  return particle{ f, f, f, 1.0f, 0.5f, 0.25f, 1.0f, -1.0f, 0.0f, 100.0f,
+    static_cast<int>(i % 4), 0 };
+}
+
+void advance_x(std2::vector<particle>^ aos, std2::soa_vector<particle>^ soa) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      for (particle^ p : mut aos.iter()) {
+        p->x += p->vx * dt;
+      }
+      do_not_optimize(^*aos);
+    }
+    report("x += vx * dt: vector<particle>", now_ns() - start, std::int64_t(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      auto cols = mut soa.columns<&particle::x, &particle::vx>();
+      [float; dyn]^ x = rel cols.0;
+      [float; dyn]^ vx = rel cols.1;
+      for (std::size_t i = 0; i < (*x)~length; ++i) {
+        (*x)[i] += (*vx)[i] * dt;
+      }
+      do_not_optimize(^*soa);
+    }
+    report("x += vx * dt: soa_vector<particle>", now_ns() - start, std::int64_t(n) * rounds);
+  }
+}
+
+void kinetic(std2::vector<particle> const^ aos, std2::soa_vector<particle> const^ soa) safe
+{
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      float e = 0;
+      for (particle const^ p : aos.iter()) {
+        e += p->mass * (p->vx * p->vx + p->vy * p->vy + p->vz * p->vz);
+      }
+      do_not_optimize(^e);
+    }
+    report("kinetic energy: vector<particle>", now_ns() - start, std::int64_t(n) * rounds);
+  }
+
+  {
+    auto start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+      const [float; dyn]^ m = soa.column<&particle::mass>();
+      const [float; dyn]^ vx = soa.column<&particle::vx>();
+      const [float; dyn]^ vy = soa.column<&particle::vy>();
+      const [float; dyn]^ vz = soa.column<&particle::vz>();
+      float e = 0;
+      for (std::size_t i = 0; i < (*m)~length; ++i) {
+        e += (*m)[i] * ((*vx)[i] * (*vx)[i] + (*vy)[i] * (*vy)[i] + (*vz)[i] * (*vz)[i]);
+      }
+      do_not_optimize(^e);
+    }
+    report("kinetic energy: soa_vector<particle>", now_ns() - start, std::int64_t(n) * rounds);
+  }
+}
+
+int main() safe
+{
+  std2::vector<particle> aos = {};
+  std2::soa_vector<particle> soa = {};
+  mut aos.reserve(n);
+  mut soa.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    mut aos.push_back(make_particle(i));
+    mut soa.push_back(make_particle(i));
+  }
+
+  advance_x(^aos, ^soa);
+  kinetic(aos, soa);
+}
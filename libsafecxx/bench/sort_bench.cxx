@@ -0,0 +1,72 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include <algorithm>
+
+#include "helpers.h"
+
+// std2::sort_unstable and std2::sort against std::sort and std::stable_sort
+// on random, already sorted and sawtooth inputs. Costs are per element.
+
+static std::size_t const n = std::size_t(1) << 22;
+static int const rounds = 5;
+
+std2::vector<std::uint64_t> make_input(int shape) safe
+{
+  std2::vector<std::uint64_t> v = {};
+  mut v.reserve(n);
+  xorshift rng{ 0x9e3779b97f4a7c15 };
+  for (std::size_t i = 0; i < n; ++i) {
+    if (shape == 0) mut v.push_back(mut rng());
+    else if (shape == 1) mut v.push_back(i);
+    else mut v.push_back(i % 4096);
+  }
+  return v;
+}
+
+void run(char const* algo, char const* shape_name, int which, std2::vector<std::uint64_t> const^ input) safe
+{
+  std::int64_t elapsed = 0;
+  for (int r = 0; r < rounds; ++r) {
+    std2::vector<std::uint64_t> v = {};
+    mut v.extend_from_slice(input.slice());
+
+    auto start = now_ns();
+    if (which == 0) {
+      std2::sort_unstable(mut v.slice());
+    } else if (which == 1) {
+      std2::sort(mut v.slice());
+    } else if (which == 2) {
+      unsafe { std::sort(v.data(), v.data() + v.size()); }
+    } else {
+      unsafe { std::stable_sort(v.data(), v.data() + v.size()); }
+    }
+    elapsed += now_ns() - start;
+    do_not_optimize(^v);
+  }
+
+  unsafe { char label[96]; }
+  unsafe { snprintf(label, sizeof(label), "%s (%s)", algo, shape_name); }
+  report(label, elapsed, static_cast<std::int64_t>(n) * rounds);
+}
+
+void bench(char const* shape_name, int shape) safe
+{
+  std2::vector<std::uint64_t> input = make_input(shape);
+  run("std2::sort_unstable", shape_name, 0, input);
+  run("std::sort", shape_name, 2, input);
+  run("std2::sort", shape_name, 1, input);
+  run("std::stable_sort", shape_name, 3, input);
+}
+
+int main() safe
+{
+  bench("random", 0);
+  bench("sorted", 1);
+  bench("sawtooth", 2);
+}
@@ -0,0 +1,80 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Writing a header/body/trailer frame to /dev/null: concatenating into one
+// string and writing it, one write per part, and a single gather write.
+
+using std2::u8;
+using std2::fs::file;
+
+static int const iterations = 1'000'000;
+
+std2::vector<u8> filled(std::size_t n, u8 c) safe
+{
+  std2::vector<u8> v = {};
+  for (std::size_t i = 0; i < n; ++i) mut v.push_back(c);
+  return v;
+}
+
+file dev_null() safe
+{
+  return file::open_with("/dev/null", std2::fs::open_options{ .write = true }).unwrap();
+}
+
+void bench(char const* name, std::size_t body_size) safe
+{
+  std2::vector<u8> header = filled(16, 'h');
+  std2::vector<u8> body = filled(body_size, 'b');
+  std2::vector<u8> trailer = filled(8, 't');
+  file f = dev_null();
+
+  unsafe { char label[96]; }
+
+  {
+    auto start = now_ns();
+    for (int i = 0; i < iterations; ++i) {
+      std2::vector<u8> frame = {};
+      mut frame.reserve(header.size() + body.size() + trailer.size());
+      mut frame.extend_from_slice(header.slice());
+      mut frame.extend_from_slice(body.slice());
+      mut frame.extend_from_slice(trailer.slice());
+      mut f.write(frame.slice()).unwrap();
+    }
+    unsafe { snprintf(label, sizeof(label), "concatenate then write (%s)", name); }
+    report(label, now_ns() - start, iterations);
+  }
+
+  {
+    auto start = now_ns();
+    for (int i = 0; i < iterations; ++i) {
+      mut f.write(header.slice()).unwrap();
+      mut f.write(body.slice()).unwrap();
+      mut f.write(trailer.slice()).unwrap();
+    }
+    unsafe { snprintf(label, sizeof(label), "three writes (%s)", name); }
+    report(label, now_ns() - start, iterations);
+  }
+
+  {
+    auto start = now_ns();
+    for (int i = 0; i < iterations; ++i) {
+      const [u8; dyn]^ parts[3] { header.slice(), body.slice(), trailer.slice() };
+      mut f.write_vectored(^parts).unwrap();
+    }
+    unsafe { snprintf(label, sizeof(label), "write_vectored (%s)", name); }
+    report(label, now_ns() - start, iterations);
+  }
+}
+
+int main() safe
+{
+  bench("1 KiB body", 1024);
+  bench("64 KiB body", 64 * 1024);
+}
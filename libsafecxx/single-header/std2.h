@@ -9,6 +9,32 @@
 #include <cstring>
 #include <atomic>
 #include <string>
+#include <cerrno>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 
 namespace std2 {
 
@@ -358,6 +384,12 @@ public:
   {
   }
 
+  // Checks str without constructing a view, for callers that must report
+  // malformed input instead of panicking.
+  static bool is_valid_utf(const [value_type; dyn]^ str) noexcept safe {
+    return verify_utf(str) == (*str)~length;
+  }
+
   value_type const* data(self) noexcept safe {
     return (*self.p_)~as_pointer;
   }
@@ -481,8 +513,29 @@ choice expected {
       .err(e) => panic("{} is err".format(expected~string));
     };
   }
+
+  E unwrap_err(self) noexcept safe {
+    return match(self) -> E {
+      .ok(t)  => panic("{} is ok".format(expected~string));
+      .err(e) => rel e;
+    };
+  }
+
+  bool is_ok(self const^) noexcept safe {
+    return match(*self) {
+      .ok(_)  => true;
+      .err(_) => false;
+    };
+  }
+
+  bool is_err(self const^) noexcept safe {
+    return !self.is_ok();
+  }
 };
 
+// The value of operations that succeed without producing anything.
+struct unit {};
+
 ////////////////////////////////////////////////////////////////////////////////
 // optional.h
 
@@ -568,6 +621,56 @@ interface make_iter {
   into_iter_type iter(self) safe;
 };
 
+// Iterators that know exactly how many items they have left.
+interface exact_size_iterator {
+  std::size_t len(self const^) safe;
+};
+
+// Iterators that can also be consumed from the back. next() and
+// next_back() meet in the middle and never yield an item twice.
+interface double_ended_iterator {
+  typename item_type;
+  optional<item_type> next_back(self^) safe;
+};
+
+namespace iter
+{
+
+// The result of calling F with Args.
+template<class F, class ...Args>
+using call_result_t = decltype(std::declval<F&>()(std::declval<Args>()...));
+
+// The lower bound on the items left, and the upper bound if there is one.
+using size_hint_type = (std::size_t, optional<std::size_t>);
+
+template<class I>
+concept has_size_hint = requires(I const i)
+{
+  i.size_hint();
+};
+
+// Exact-size iterators report their length, other iterators can provide a
+// size_hint() member, and anything else gets the (0, none) default. The
+// hint is only for preallocation: consumers must stay correct if it's
+// wrong.
+template<class I>
+size_hint_type size_hint(I const^ it) safe
+requires impl<I, iterator>
+{
+  if constexpr (impl<I, exact_size_iterator>) {
+    std::size_t const n = it.std2::exact_size_iterator::len();
+    optional<std::size_t> upper = .some(n);
+    return (n, rel upper);
+  } else if constexpr (has_size_hint<I>) {
+    return it.size_hint();
+  } else {
+    optional<std::size_t> upper = .none;
+    return (std::size_t(0), rel upper);
+  }
+}
+
+} // namespace iter
+
 ////////////////////////////////////////////////////////////////////////////////
 // slice.h
 
@@ -575,7 +678,7 @@ template<class T>
 class slice_iterator/(a)
 {
   T* unsafe p_;
-  T* end_;
+  T* unsafe end_;
   T^/a __phantom_data;
 
 public:
@@ -588,6 +691,54 @@ public:
     if (self->p_ == self->end_) { return .none; }
     return .some(^*self->p_++);
   }
+
+  optional<T^/a> next_back(self^) noexcept safe {
+    if (self->p_ == self->end_) { return .none; }
+    return .some(^*--self->end_);
+  }
+
+  std::size_t len(self const^) noexcept safe {
+    return static_cast<std::size_t>(self->end_ - self->p_);
+  }
+
+  // Skips up to n items in constant time and returns how many were
+  // skipped.
+  std::size_t advance_by(self^, std::size_t n) noexcept safe {
+    std::size_t const k = n < self.len() ? n : self.len();
+    self->p_ += k;
+    return k;
+  }
+
+  // The item n places ahead, consuming it and everything before it.
+  optional<T^/a> nth(self^, std::size_t n) noexcept safe {
+    if (self.advance_by(n) < n) return .none;
+    return self.next();
+  }
+
+  // Internal iteration runs as a plain pointer loop, without an optional
+  // and an end check per item in the caller, so the compiler can
+  // vectorize it.
+  template<class B+, class F+>
+  B fold(self, B init, F f) safe {
+    B acc = rel init;
+    for (; self.p_ != self.end_; ++self.p_) {
+      acc = mut f(rel acc, ^*self.p_);
+    }
+    return acc;
+  }
+
+  // f returns an expected. The first error stops the loop, leaving the
+  // iterator just past the item that produced it.
+  template<class B+, class F+>
+  iter::call_result_t<F, B, T^> try_fold(self^, B init, F f) safe {
+    B acc = rel init;
+    while (self->p_ != self->end_) {
+      iter::call_result_t<F, B, T^> r = mut f(rel acc, ^*self->p_++);
+      if (r.is_err()) return rel r;
+      acc = r rel.unwrap();
+    }
+    return .ok(rel acc);
+  }
 };
 
 template<class T>
@@ -600,6 +751,24 @@ impl slice_iterator<T>: iterator
   }
 };
 
+template<class T>
+impl slice_iterator<T>: double_ended_iterator
+{
+  using item_type = T^;
+
+  optional<item_type> next_back(self^) safe override {
+    return self.next_back();
+  }
+};
+
+template<class T>
+impl slice_iterator<T>: exact_size_iterator
+{
+  std::size_t len(self const^) safe override {
+    return self.len();
+  }
+};
+
 template<class T>
 impl slice_iterator<T>: make_iter {
   using iter_type = slice_iterator<T>;
@@ -611,1217 +780,9548 @@ impl slice_iterator<T>: make_iter {
   into_iter_type iter(self) safe override { return self; }
 };
 
-////////////////////////////////////////////////////////////////////////////////
-// utility.h
-
-interface send {};
-interface sync {};
+// Sub-slice iterators. Each yields borrows with the lifetime of the
+// original slice, so kernels can loop over whole chunks and fixed-size
+// arrays with the bounds checks done once per chunk instead of per element.
+// Like slice_iterator, an iterator over [T; dyn] yields mutable borrows and
+// an iterator over [const T; dyn] yields const ones.
 
-template<class T+>
-class manually_drop
+template<class T>
+class chunks_iterator/(a)
 {
-  T t_;
+  T* unsafe p_;
+  T* unsafe end_;
+  std::size_t n_;
+  T^/a __phantom_data;
 
 public:
-  explicit
-  manually_drop(T t) noexcept safe
-    : t_(rel t)
+  chunks_iterator([T; dyn]^/a s, std::size_t n) noexcept safe
+    : p_((*s)~as_pointer), unsafe end_((*s)~as_pointer + (*s)~length), n_(n)
   {
+    if (n == 0) panic("chunk size must be non-zero");
   }
 
-  ~manually_drop() = trivial;
+  optional<[T; dyn]^/a> next(self^) noexcept safe {
+    if (self->p_ == self->end_) return .none;
 
-  void destroy(self^) noexcept {
-    self->t_^.~T();
+    std::size_t const left = static_cast<std::size_t>(self->end_ - self->p_);
+    std::size_t const len = left < self->n_ ? left : self->n_;
+    unsafe { auto chunk = slice_from_raw_parts(self->p_, len); }
+    self->p_ += len;
+    return .some(chunk);
   }
 
-  T const^ get(self const^) noexcept safe {
-    return ^self->t_;
+  std::size_t len(self const^) noexcept safe {
+    std::size_t const left = static_cast<std::size_t>(self->end_ - self->p_);
+    return left / self->n_ + (left % self->n_ != 0);
   }
 };
 
-template<class T+>
-void forget(T t) noexcept safe
-{
-  manually_drop<T>(rel t);
-}
-
-template<class T+>
-class [[unsafe::sync(false)]] unsafe_cell
+template<class T>
+impl chunks_iterator<T>: iterator
 {
-  T t_;
-
-public:
-  unsafe_cell() = default;
-
-  explicit
-  unsafe_cell(T t) noexcept safe
-    : t_(rel t)
-  {
-  }
+  using item_type = [T; dyn]^;
 
-  T* get(self const^) noexcept safe {
-    return const_cast<T*>(addr self->t_);
+  optional<item_type> next(self^) safe override {
+    return self.next();
   }
 };
 
-template<class T+>
-T replace/(a)(T^/a dst, T src) safe
+template<class T>
+impl chunks_iterator<T>: exact_size_iterator
 {
-  unsafe {
-    T result = __rel_read(addr *dst);
-    __rel_write(addr *dst, rel src);
-    return result;
+  std::size_t len(self const^) safe override {
+    return self.len();
   }
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// atomic.h
+};
 
+// Yields only full chunks. The leftover tail is available up front from
+// remainder().
 template<class T>
-class [[unsafe::sync(true)]] atomic
+class chunks_exact_iterator/(a)
 {
-  unsafe_cell<std::atomic<T> unsafe>  t_;
+  T* unsafe p_;
+  T* unsafe end_;
+  T* unsafe rem_end_;
+  std::size_t n_;
+  T^/a __phantom_data;
 
 public:
-  atomic(T t = T()) safe
-  : t_(rel t)
-  {}
-
-  atomic(atomic const^) = delete;
-  operator rel(atomic) = delete;
-
-  T fetch_add(self const^, T op, std::memory_order memory_order = std::memory_order_seq_cst) noexcept safe {
-    unsafe { return  self->t_.get()&->fetch_add(op, memory_order) + op; }
-  }
-
-  T fetch_sub(self const^, T op, std::memory_order memory_order = std::memory_order_seq_cst) noexcept safe {
-    unsafe { return  self->t_.get()&->fetch_sub(op, memory_order); }
+  chunks_exact_iterator([T; dyn]^/a s, std::size_t n) noexcept safe
+    : p_((*s)~as_pointer)
+    , unsafe end_((*s)~as_pointer + (n ? (*s)~length / n * n : 0))
+    , unsafe rem_end_((*s)~as_pointer + (*s)~length)
+    , n_(n)
+  {
+    if (n == 0) panic("chunk size must be non-zero");
   }
 
-  T add_fetch(self const^, T op, std::memory_order memory_order = std::memory_order_seq_cst) noexcept safe {
-    unsafe { return  self->t_.get()&->fetch_add(op, memory_order) + op; }
-  }
+  optional<[T; dyn]^/a> next(self^) noexcept safe {
+    if (self->p_ == self->end_) return .none;
 
-  T sub_fetch(self const^, T op, std::memory_order memory_order = std::memory_order_seq_cst) noexcept safe {
-    unsafe { return  self->t_.get()&->fetch_sub(op, memory_order) - op; }
+    unsafe { auto chunk = slice_from_raw_parts(self->p_, self->n_); }
+    self->p_ += self->n_;
+    return .some(chunk);
   }
 
-  void store(self const^, T op, std::memory_order memory_order = std::memory_order_seq_cst) noexcept safe {
-    unsafe { self->t_.get()&.store(op, memory_order); }
+  // The tail never overlaps a chunk, so it can be looked at while chunks are
+  // still live. Writing to it takes the iterator: see into_remainder().
+  const [T; dyn]^/a remainder(self const^) noexcept safe {
+    unsafe { return slice_from_raw_parts(self->end_, static_cast<std::size_t>(self->rem_end_ - self->end_)); }
   }
 
-  T load(self const^, std::memory_order memory_order = std::memory_order_seq_cst) noexcept safe {
-    unsafe { self->t_.get()&.load(memory_order); }
+  [T; dyn]^/a into_remainder(self) noexcept safe {
+    unsafe { return slice_from_raw_parts(self.end_, static_cast<std::size_t>(self.rem_end_ - self.end_)); }
   }
 
-  T operator++(self const^) noexcept safe {
-    return self->add_fetch(1);
+  std::size_t len(self const^) noexcept safe {
+    return static_cast<std::size_t>(self->end_ - self->p_) / self->n_;
   }
+};
 
-  T operator++(self const^, int) noexcept safe {
-    return self->fetch_add(1);
-  }
+template<class T>
+impl chunks_exact_iterator<T>: iterator
+{
+  using item_type = [T; dyn]^;
 
-  T operator--(self const^) noexcept safe {
-    return self->sub_fetch(1);
+  optional<item_type> next(self^) safe override {
+    return self.next();
   }
+};
 
-  T operator--(self const^, int) noexcept safe {
-    return self->fetch_sub(1);
+template<class T>
+impl chunks_exact_iterator<T>: exact_size_iterator
+{
+  std::size_t len(self const^) safe override {
+    return self.len();
   }
 };
 
-////////////////////////////////////////////////////////////////////////////////
-// arc.h
-
-template<class T+>
-class
-[[unsafe::send(T~is_send && T~is_sync), unsafe::sync(T~is_send && T~is_sync)]]
-arc
+// Like chunks_exact_iterator, with the chunk length in the type so each
+// item is a fixed-size array.
+template<class T, std::size_t N>
+class array_chunks_iterator/(a)
 {
-  struct arc_inner;
-  arc_inner* unsafe p_;
+  static_assert(N > 0, "chunk size must be non-zero");
 
-  struct arc_inner
-  {
-    manually_drop<T> data_;
-    atomic<std::size_t> strong_;
-    atomic<std::size_t> weak_;
-
-    arc_inner(T data) noexcept safe
-      : data_(rel data)
-      , strong_(1)
-      , weak_(1)
-    {
-    }
-  };
+  T* unsafe p_;
+  T* unsafe end_;
+  T* unsafe rem_end_;
+  T^/a __phantom_data;
 
 public:
-
-  explicit
-  arc(T t) safe
-    : p_(new(std::nothrow) arc_inner(rel t))
+  array_chunks_iterator([T; dyn]^/a s) noexcept safe
+    : p_((*s)~as_pointer)
+    , unsafe end_((*s)~as_pointer + ((*s)~length / N) * N)
+    , unsafe rem_end_((*s)~as_pointer + (*s)~length)
   {
   }
 
-  template<typename T2>
-  explicit arc(T2 t) safe :
-    arc(T(rel t)) { }
+  optional<[T; N]^/a> next(self^) noexcept safe {
+    if (self->p_ == self->end_) return .none;
 
-  arc(arc const^ rhs) safe
-    : p_(rhs->p_)
-  {
-    ++p_->strong_;
+    unsafe { [T; N]^/a chunk = ^*reinterpret_cast<[T; N]*>(self->p_); }
+    self->p_ += N;
+    return .some(chunk);
   }
 
-  [[unsafe::drop_only(T)]]
-  ~arc() safe
-  {
-    std::size_t s = --p_->strong_;
-    if (s == 0) {
-      unsafe { mut p_->data_.destroy(); }
+  // Read-only for the same reason as chunks_exact_iterator's.
+  const [T; dyn]^/a remainder(self const^) noexcept safe {
+    unsafe { return slice_from_raw_parts(self->end_, static_cast<std::size_t>(self->rem_end_ - self->end_)); }
+  }
 
-      std::size_t w = --p_->weak_;
-      if (w == 0) {
-        delete p_;
-      }
-    }
+  [T; dyn]^/a into_remainder(self) noexcept safe {
+    unsafe { return slice_from_raw_parts(self.end_, static_cast<std::size_t>(self.rem_end_ - self.end_)); }
   }
 
-  T const^ operator->(self const^) noexcept safe {
-    return ^*self->p_->data_.get();
+  std::size_t len(self const^) noexcept safe {
+    return static_cast<std::size_t>(self->end_ - self->p_) / N;
   }
 };
 
-////////////////////////////////////////////////////////////////////////////////
-// box.h
-
-template<class T+>
-class
-[[safety::niche_zero, unsafe::send(T~is_send), unsafe::sync(T~is_sync)]]
-box
+template<class T, std::size_t N>
+impl array_chunks_iterator<T, N>: iterator
 {
-  T* unsafe p_;
-  T __phantom_data;
-
-public:
-  box(T* p) noexcept
-    : p_(p)
-  {
-  }
+  using item_type = [T; N]^;
 
-  explicit
-  box(T t) safe
-    : p_(new(std::nothrow) T(rel t))
-  {
+  optional<item_type> next(self^) safe override {
+    return self.next();
   }
+};
 
-  [[unsafe::drop_only(T)]]
-  ~box() safe {
-    delete p_;
+template<class T, std::size_t N>
+impl array_chunks_iterator<T, N>: exact_size_iterator
+{
+  std::size_t len(self const^) safe override {
+    return self.len();
   }
+};
 
-  // Delete the copy constructors.
-  box(const box^) = delete;
-  box(const box&) = delete;
+// Overlapping windows of n elements, advancing one element at a time.
+// Windows are always shared borrows since they overlap.
+template<class T>
+class windows_iterator/(a)
+{
+  T const* unsafe p_;
+  T const* unsafe end_;
+  std::size_t n_;
+  T const^/a __phantom_data;
 
-  static
-  box make_default() safe requires(safe(T()))
+public:
+  windows_iterator(const [T; dyn]^/a s, std::size_t n) noexcept safe
+    : p_((*s)~as_pointer), unsafe end_((*s)~as_pointer + (*s)~length), n_(n)
   {
-    unsafe { return box(new T()); }
+    if (n == 0) panic("window size must be non-zero");
   }
 
-  T^ borrow(self^) noexcept safe {
-    return ^*self->p_;
-  }
+  optional<const [T; dyn]^/a> next(self^) noexcept safe {
+    if (static_cast<std::size_t>(self->end_ - self->p_) < self->n_) return .none;
 
-  T const^ borrow(self const^) noexcept safe {
-    return ^*self->p_;
+    unsafe { auto w = slice_from_raw_parts(self->p_, self->n_); }
+    ++self->p_;
+    return .some(w);
   }
 
-  T^ operator*(self^) noexcept safe {
-    return self.borrow();
+  std::size_t len(self const^) noexcept safe {
+    std::size_t const left = static_cast<std::size_t>(self->end_ - self->p_);
+    return left < self->n_ ? 0 : left - self->n_ + 1;
   }
+};
 
-  const T^ operator*(const self^) noexcept safe {
-    return self.borrow();
-  }
+template<class T>
+impl windows_iterator<T>: iterator
+{
+  using item_type = const [T; dyn]^;
 
-  T^ operator->(self^) noexcept safe {
-    return ^*self->p_;
+  optional<item_type> next(self^) safe override {
+    return self.next();
   }
+};
 
-  const T^ operator->(self const^) noexcept safe {
-    return ^*self->p_;
+template<class T>
+impl windows_iterator<T>: exact_size_iterator
+{
+  std::size_t len(self const^) safe override {
+    return self.len();
+  }
+};
+
+template<class T>
+chunks_iterator<const T> chunks(const [T; dyn]^ s, std::size_t n) noexcept safe
+{
+  return chunks_iterator<const T>(s, n);
+}
+
+template<class T>
+chunks_iterator<T> chunks_mut([T; dyn]^ s, std::size_t n) noexcept safe
+{
+  return chunks_iterator<T>(s, n);
+}
+
+template<class T>
+chunks_exact_iterator<const T> chunks_exact(const [T; dyn]^ s, std::size_t n) noexcept safe
+{
+  return chunks_exact_iterator<const T>(s, n);
+}
+
+template<class T>
+chunks_exact_iterator<T> chunks_exact_mut([T; dyn]^ s, std::size_t n) noexcept safe
+{
+  return chunks_exact_iterator<T>(s, n);
+}
+
+template<std::size_t N, class T>
+array_chunks_iterator<const T, N> array_chunks(const [T; dyn]^ s) noexcept safe
+{
+  return array_chunks_iterator<const T, N>(s);
+}
+
+template<std::size_t N, class T>
+array_chunks_iterator<T, N> array_chunks_mut([T; dyn]^ s) noexcept safe
+{
+  return array_chunks_iterator<T, N>(s);
+}
+
+template<class T>
+windows_iterator<T> windows(const [T; dyn]^ s, std::size_t n) noexcept safe
+{
+  return windows_iterator<T>(s, n);
+}
+
+// Splits into [0, mid) and [mid, len). Panics if mid is past the end.
+template<class T>
+auto split_at/(a)(const [T; dyn]^/a s, std::size_t mid) noexcept safe
+  -> (const [T; dyn]^/a, const [T; dyn]^/a)
+{
+  std::size_t const len = (*s)~length;
+  if (mid > len) panic_bounds("split_at index is out-of-bounds");
+
+  T const* p = (*s)~as_pointer;
+  unsafe { return (slice_from_raw_parts(p, mid), slice_from_raw_parts(p + mid, len - mid)); }
+}
+
+// The two halves don't overlap, so both can be borrowed mutably at once.
+template<class T>
+auto split_at_mut/(a)([T; dyn]^/a s, std::size_t mid) noexcept safe
+  -> ([T; dyn]^/a, [T; dyn]^/a)
+{
+  std::size_t const len = (*s)~length;
+  if (mid > len) panic_bounds("split_at_mut index is out-of-bounds");
+
+  T* p = (*s)~as_pointer;
+  unsafe { return (slice_from_raw_parts(p, mid), slice_from_raw_parts(p + mid, len - mid)); }
+}
+
+template<class T>
+auto split_first/(a)(const [T; dyn]^/a s) noexcept safe
+  -> optional<(const T^/a, const [T; dyn]^/a)>
+{
+  std::size_t const len = (*s)~length;
+  if (len == 0) return .none;
+
+  T const* p = (*s)~as_pointer;
+  unsafe { return .some((^*p, slice_from_raw_parts(p + 1, len - 1))); }
+}
+
+template<class T>
+auto split_first_mut/(a)([T; dyn]^/a s) noexcept safe
+  -> optional<(T^/a, [T; dyn]^/a)>
+{
+  std::size_t const len = (*s)~length;
+  if (len == 0) return .none;
+
+  T* p = (*s)~as_pointer;
+  unsafe { return .some((^*p, slice_from_raw_parts(p + 1, len - 1))); }
+}
+
+template<class T>
+auto split_last/(a)(const [T; dyn]^/a s) noexcept safe
+  -> optional<(const T^/a, const [T; dyn]^/a)>
+{
+  std::size_t const len = (*s)~length;
+  if (len == 0) return .none;
+
+  T const* p = (*s)~as_pointer;
+  unsafe { return .some((^p[len - 1], slice_from_raw_parts(p, len - 1))); }
+}
+
+template<class T>
+auto split_last_mut/(a)([T; dyn]^/a s) noexcept safe
+  -> optional<(T^/a, [T; dyn]^/a)>
+{
+  std::size_t const len = (*s)~length;
+  if (len == 0) return .none;
+
+  T* p = (*s)~as_pointer;
+  unsafe { return .some((^p[len - 1], slice_from_raw_parts(p, len - 1))); }
+}
+
+namespace detail
+{
+
+// Swaps two non-overlapping byte ranges through a small stack buffer, so
+// each step is a fixed-size memcpy the compiler can vectorize.
+inline void swap_bytes(unsigned char* a, unsigned char* b, std::size_t n) noexcept
+{
+  unsigned char buf[256];
+  while (n >= sizeof(buf)) {
+    std::memcpy(buf, a, sizeof(buf));
+    std::memcpy(a, b, sizeof(buf));
+    std::memcpy(b, buf, sizeof(buf));
+    a += sizeof(buf);
+    b += sizeof(buf);
+    n -= sizeof(buf);
+  }
+  std::memcpy(buf, a, n);
+  std::memcpy(a, b, n);
+  std::memcpy(b, buf, n);
+}
+
+template<class T>
+void reverse_range(T* p, std::size_t n) noexcept
+{
+  T* lo = p;
+  T* hi = p + n;
+  while (hi - lo > 1) {
+    --hi;
+    alignas(T) unsigned char t[sizeof(T)];
+    std::memcpy(t, static_cast<void*>(lo), sizeof(T));
+    std::memcpy(static_cast<void*>(lo), static_cast<void*>(hi), sizeof(T));
+    std::memcpy(static_cast<void*>(hi), t, sizeof(T));
+    ++lo;
+  }
+}
+
+// Rotates bitwise. When either side fits in the stack buffer it's parked
+// there and the other side slides over with one memmove; otherwise three
+// reversals do it in place.
+template<class T>
+void rotate_left_impl(T* p, std::size_t n, std::size_t mid) noexcept
+{
+  std::size_t const left = mid;
+  std::size_t const right = n - mid;
+  if (left == 0 || right == 0) return;
+
+  unsigned char buf[1024];
+  unsigned char* bytes = reinterpret_cast<unsigned char*>(p);
+  if (left * sizeof(T) <= sizeof(buf)) {
+    std::memcpy(buf, bytes, left * sizeof(T));
+    std::memmove(bytes, bytes + left * sizeof(T), right * sizeof(T));
+    std::memcpy(bytes + right * sizeof(T), buf, left * sizeof(T));
+  } else if (right * sizeof(T) <= sizeof(buf)) {
+    std::memcpy(buf, bytes + left * sizeof(T), right * sizeof(T));
+    std::memmove(bytes + right * sizeof(T), bytes, left * sizeof(T));
+    std::memcpy(bytes, buf, right * sizeof(T));
+  } else {
+    reverse_range(p, left);
+    reverse_range(p + left, right);
+    reverse_range(p, n);
+  }
+}
+
+} // namespace detail
+
+// Copies src into dst with one memcpy. The lengths must match.
+template<class T>
+void copy_from_slice([T; dyn]^ dst, const [T; dyn]^ src) safe
+requires(T~is_trivially_copyable)
+{
+  std::size_t const n = (*dst)~length;
+  if (n != (*src)~length) panic("copy_from_slice requires slices of equal length");
+  unsafe { std::memcpy((*dst)~as_pointer, (*src)~as_pointer, n * sizeof(T)); }
+}
+
+// Copy-assigns each element of src to dst after checking the lengths once.
+// The assignments run unchecked, so T's copy assignment must be safe.
+template<class T>
+void clone_from_slice([T; dyn]^ dst, const [T; dyn]^ src) safe
+requires(std::is_copy_assignable_v<T> && safe((*dst)[0] = (*src)[0]))
+{
+  std::size_t const n = (*dst)~length;
+  if (n != (*src)~length) panic("clone_from_slice requires slices of equal length");
+
+  T* d = (*dst)~as_pointer;
+  T const* s = (*src)~as_pointer;
+  if constexpr (T~is_trivially_copyable) {
+    unsafe { std::memcpy(d, s, n * sizeof(T)); }
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      unsafe { d[i] = s[i]; }
+    }
+  }
+}
+
+// Assigns value to every element, which needs a safe copy assignment.
+// Trivially copyable values made of one repeated byte, zero included,
+// become a memset.
+template<class T>
+void fill([T; dyn]^ s, T value) safe
+requires(std::is_copy_assignable_v<T> && safe((*s)[0] = value))
+{
+  std::size_t const n = (*s)~length;
+  T* p = (*s)~as_pointer;
+
+  if constexpr (T~is_trivially_copyable) {
+    unsafe { unsigned char const* b = reinterpret_cast<unsigned char const*>(addr value); }
+    bool uniform = true;
+    for (std::size_t i = 1; i < sizeof(T); ++i) {
+      unsafe { uniform = uniform && b[i] == b[0]; }
+    }
+    if (uniform) {
+      unsafe { std::memset(p, b[0], n * sizeof(T)); }
+      return;
+    }
+  }
+
+  for (std::size_t i = 0; i < n; ++i) {
+    unsafe { p[i] = value; }
+  }
+}
+
+template<class T, class F+>
+void fill_with([T; dyn]^ s, F f) safe
+requires(safe(mut f()) && safe((*s)[0] = mut f()))
+{
+  std::size_t const n = (*s)~length;
+  T* p = (*s)~as_pointer;
+  for (std::size_t i = 0; i < n; ++i) {
+    unsafe { p[i] = mut f(); }
+  }
+}
+
+// Exchanges the contents of a and b, which must have the same length.
+template<class T>
+void swap_with_slice([T; dyn]^ a, [T; dyn]^ b) safe
+{
+  std::size_t const n = (*a)~length;
+  if (n != (*b)~length) panic("swap_with_slice requires slices of equal length");
+  unsafe {
+    detail::swap_bytes(
+      reinterpret_cast<unsigned char*>((*a)~as_pointer),
+      reinterpret_cast<unsigned char*>((*b)~as_pointer),
+      n * sizeof(T));
+  }
+}
+
+template<class T>
+void reverse([T; dyn]^ s) noexcept safe
+{
+  unsafe { detail::reverse_range((*s)~as_pointer, (*s)~length); }
+}
+
+// Moves the first mid elements to the end, keeping both runs in order.
+template<class T>
+void rotate_left([T; dyn]^ s, std::size_t mid) safe
+{
+  std::size_t const n = (*s)~length;
+  if (mid > n) panic_bounds("rotate_left amount is out-of-bounds");
+  unsafe { detail::rotate_left_impl((*s)~as_pointer, n, mid); }
+}
+
+// Moves the last k elements to the front, keeping both runs in order.
+template<class T>
+void rotate_right([T; dyn]^ s, std::size_t k) safe
+{
+  std::size_t const n = (*s)~length;
+  if (k > n) panic_bounds("rotate_right amount is out-of-bounds");
+  unsafe { detail::rotate_left_impl((*s)~as_pointer, n, n - k); }
+}
+
+// Copies [src_begin, src_end) to the range starting at dest within the same
+// slice. The ranges may overlap.
+template<class T>
+void copy_within([T; dyn]^ s, std::size_t src_begin, std::size_t src_end, std::size_t dest) safe
+requires(T~is_trivially_copyable)
+{
+  std::size_t const n = (*s)~length;
+  if (src_begin > src_end || src_end > n) panic_bounds("copy_within source range is out-of-bounds");
+
+  std::size_t const count = src_end - src_begin;
+  if (dest > n - count) panic_bounds("copy_within destination is out-of-bounds");
+
+  T* p = (*s)~as_pointer;
+  unsafe { std::memmove(p + dest, p + src_begin, count * sizeof(T)); }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// sort.h
+
+// Sorting for slices. Elements are moved bitwise, the same way vector
+// relocates them. Every loop is bounded by the slice, never by the
+// comparator, so an inconsistent comparator can leave the slice in an
+// unspecified order but can't read or write out of bounds or duplicate or
+// lose an element. If the comparator throws, any element parked in a
+// temporary is written back before the exception leaves.
+
+namespace detail
+{
+
+template<class T>
+void relocate_one(T* dst, T const* src) noexcept
+{
+  std::memcpy(static_cast<void*>(dst), static_cast<void const*>(src), sizeof(T));
+}
+
+template<class T>
+void swap_elems(T* a, T* b) noexcept
+{
+  if (a == b) return;
+
+  alignas(T) unsigned char tmp[sizeof(T)];
+  std::memcpy(tmp, static_cast<void*>(a), sizeof(T));
+  relocate_one(a, b);
+  std::memcpy(static_cast<void*>(b), tmp, sizeof(T));
+}
+
+// Holds an element moved out to a temporary and writes it back into dest
+// on every exit path, so a throwing comparator never leaves a duplicate.
+template<class T>
+struct sort_hole
+{
+  T* src;
+  T* dest;
+
+  ~sort_hole() { relocate_one(dest, src); }
+};
+
+// The left run of a merge, parked in the scratch buffer. Whatever hasn't
+// been merged yet fills the gap at out.
+template<class T>
+struct merge_hole
+{
+  T* start;
+  T* end;
+  T* out;
+
+  ~merge_hole() {
+    std::memcpy(static_cast<void*>(out), static_cast<void const*>(start), (end - start) * sizeof(T));
+  }
+};
+
+struct scratch_buffer
+{
+  void* p;
+
+  ~scratch_buffer() { ::operator delete(p); }
+};
+
+template<class T, class F>
+bool sort_lt(F& less, T const* a, T const* b)
+{
+  return less(^*a, ^*b);
+}
+
+// Guarded insertion sort over [v, v + n). Stable.
+template<class T, class F>
+void insertion_sort(T* v, std::size_t n, F& less)
+{
+  for (std::size_t i = 1; i < n; ++i) {
+    if (!sort_lt(less, v + i, v + i - 1)) continue;
+
+    alignas(T) unsigned char buf[sizeof(T)];
+    T* tmp = reinterpret_cast<T*>(buf);
+    relocate_one(tmp, v + i);
+    sort_hole<T> hole{ tmp, v + i };
+
+    for (std::size_t j = i; j > 0; --j) {
+      if (j < i && !sort_lt(less, static_cast<T const*>(tmp), v + j - 1)) break;
+      relocate_one(v + j, v + j - 1);
+      hole.dest = v + j - 1;
+    }
+  }
+}
+
+// Moves the last element of [v, v + n) left to its place.
+template<class T, class F>
+void shift_tail(T* v, std::size_t n, F& less)
+{
+  if (n < 2) return;
+  for (std::size_t j = n - 1; j > 0 && sort_lt(less, v + j, v + j - 1); --j) {
+    swap_elems(v + j, v + j - 1);
+  }
+}
+
+// Moves the first element of [v, v + n) right to its place.
+template<class T, class F>
+void shift_head(T* v, std::size_t n, F& less)
+{
+  for (std::size_t j = 0; j + 1 < n && sort_lt(less, v + j + 1, v + j); ++j) {
+    swap_elems(v + j, v + j + 1);
+  }
+}
+
+// Fixes up a nearly sorted slice with a bounded number of insertions.
+// Returns true if the slice ends up sorted.
+template<class T, class F>
+bool partial_insertion_sort(T* v, std::size_t n, F& less)
+{
+  std::size_t const max_steps = 5;
+  std::size_t const shortest_shifting = 50;
+
+  std::size_t i = 1;
+  for (std::size_t step = 0; step < max_steps; ++step) {
+    while (i < n && !sort_lt(less, v + i, v + i - 1)) ++i;
+    if (i == n) return true;
+    if (n < shortest_shifting) return false;
+
+    swap_elems(v + i - 1, v + i);
+    shift_tail(v, i, less);
+    shift_head(v + i, n - i, less);
+  }
+  return false;
+}
+
+template<class T, class F>
+void sift_down(T* v, std::size_t n, std::size_t node, F& less)
+{
+  while (true) {
+    std::size_t child = 2 * node + 1;
+    if (child >= n) return;
+    if (child + 1 < n && sort_lt(less, v + child, v + child + 1)) ++child;
+    if (!sort_lt(less, v + node, v + child)) return;
+    swap_elems(v + node, v + child);
+    node = child;
+  }
+}
+
+template<class T, class F>
+void heapsort(T* v, std::size_t n, F& less)
+{
+  for (std::size_t i = n / 2; i > 0; --i) sift_down(v, n, i - 1, less);
+  for (std::size_t end = n; end > 1; --end) {
+    swap_elems(v, v + end - 1);
+    sift_down(v, end - 1, 0, less);
+  }
+}
+
+// Block partitioning from BlockQuicksort: comparison results are recorded
+// as offsets without branching, then out-of-place pairs are swapped in a
+// cyclic permutation. Returns the number of elements less than the pivot.
+template<class T, class F>
+std::size_t partition_in_blocks(T* v, std::size_t n, T const* pivot, F& less)
+{
+  std::size_t const block = 128;
+
+  T* l = v;
+  std::size_t block_l = block;
+  std::uint8_t offsets_l[block];
+  std::uint8_t* start_l = nullptr;
+  std::uint8_t* end_l = nullptr;
+
+  T* r = v + n;
+  std::size_t block_r = block;
+  std::uint8_t offsets_r[block];
+  std::uint8_t* start_r = nullptr;
+  std::uint8_t* end_r = nullptr;
+
+  while (true) {
+    std::size_t const width = static_cast<std::size_t>(r - l);
+    bool const is_done = width <= 2 * block;
+
+    if (is_done) {
+      std::size_t rem = width;
+      if (start_l < end_l || start_r < end_r) rem -= block;
+
+      if (start_l < end_l) {
+        block_r = rem;
+      } else if (start_r < end_r) {
+        block_l = rem;
+      } else {
+        block_l = rem / 2;
+        block_r = rem - block_l;
+      }
+    }
+
+    if (start_l == end_l) {
+      start_l = end_l = offsets_l;
+      T* elem = l;
+      for (std::size_t i = 0; i < block_l; ++i) {
+        *end_l = static_cast<std::uint8_t>(i);
+        end_l += !sort_lt(less, static_cast<T const*>(elem), pivot);
+        ++elem;
+      }
+    }
+
+    if (start_r == end_r) {
+      start_r = end_r = offsets_r;
+      T* elem = r;
+      for (std::size_t i = 0; i < block_r; ++i) {
+        --elem;
+        *end_r = static_cast<std::uint8_t>(i);
+        end_r += sort_lt(less, static_cast<T const*>(elem), pivot);
+      }
+    }
+
+    std::size_t const count_l = static_cast<std::size_t>(end_l - start_l);
+    std::size_t const count_r = static_cast<std::size_t>(end_r - start_r);
+    std::size_t const count = count_l < count_r ? count_l : count_r;
+
+    if (count > 0) {
+      alignas(T) unsigned char buf[sizeof(T)];
+      T* tmp = reinterpret_cast<T*>(buf);
+
+      relocate_one(tmp, l + *start_l);
+      relocate_one(l + *start_l, r - *start_r - 1);
+      for (std::size_t i = 1; i < count; ++i) {
+        ++start_l;
+        relocate_one(r - *start_r - 1, l + *start_l);
+        ++start_r;
+        relocate_one(l + *start_l, r - *start_r - 1);
+      }
+      relocate_one(r - *start_r - 1, tmp);
+      ++start_l;
+      ++start_r;
+    }
+
+    if (start_l == end_l) l += block_l;
+    if (start_r == end_r) r -= block_r;
+    if (is_done) break;
+  }
+
+  if (start_l < end_l) {
+    while (start_l < end_l) {
+      --end_l;
+      swap_elems(l + *end_l, r - 1);
+      --r;
+    }
+    return static_cast<std::size_t>(r - v);
+  }
+
+  while (start_r < end_r) {
+    --end_r;
+    swap_elems(l, r - *end_r - 1);
+    ++l;
+  }
+  return static_cast<std::size_t>(l - v);
+}
+
+// Partitions around v[pivot] and moves the pivot to its final place.
+// Returns that place and whether the slice was already partitioned.
+template<class T, class F>
+std::size_t partition(T* v, std::size_t n, std::size_t pivot, F& less, bool* was_partitioned)
+{
+  swap_elems(v, v + pivot);
+  T const* p = v;
+  T* rest = v + 1;
+  std::size_t const m = n - 1;
+
+  std::size_t l = 0;
+  std::size_t r = m;
+  while (l < r && sort_lt(less, static_cast<T const*>(rest + l), p)) ++l;
+  while (l < r && !sort_lt(less, static_cast<T const*>(rest + r - 1), p)) --r;
+
+  *was_partitioned = l >= r;
+  std::size_t const mid = l + partition_in_blocks(rest + l, r - l, p, less);
+  swap_elems(v, v + mid);
+  return mid;
+}
+
+// Puts the elements equal to v[pivot] first, assuming none is less than
+// it. Returns how many there are.
+template<class T, class F>
+std::size_t partition_equal(T* v, std::size_t n, std::size_t pivot, F& less)
+{
+  swap_elems(v, v + pivot);
+  T const* p = v;
+  T* rest = v + 1;
+
+  std::size_t l = 0;
+  std::size_t r = n - 1;
+  while (true) {
+    while (l < r && !sort_lt(less, p, static_cast<T const*>(rest + l))) ++l;
+    while (l < r && sort_lt(less, p, static_cast<T const*>(rest + r - 1))) --r;
+    if (l >= r) break;
+
+    --r;
+    swap_elems(rest + l, rest + r);
+    ++l;
+  }
+  return l + 1;
+}
+
+// Scatters a few elements to break up patterns that made partitions
+// unbalanced.
+template<class T>
+void break_patterns(T* v, std::size_t n) noexcept
+{
+  if (n < 8) return;
+
+  std::uint64_t seed = n;
+  std::size_t modulus = 1;
+  while (modulus < n) modulus <<= 1;
+
+  std::size_t const pos = n / 4 * 2;
+  for (std::size_t i = 0; i < 3; ++i) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    std::size_t other = static_cast<std::size_t>(seed) & (modulus - 1);
+    if (other >= n) other -= n;
+    swap_elems(v + pos - 1 + i, v + other);
+  }
+}
+
+// Picks a pivot by median of three, or Tukey's ninther for longer slices.
+// A slice that looks descending is reversed. Sets likely_sorted when no
+// comparison was out of order.
+template<class T, class F>
+std::size_t choose_pivot(T* v, std::size_t n, F& less, bool* likely_sorted)
+{
+  std::size_t const max_swaps = 4 * 3;
+
+  std::size_t a = n / 4 * 1;
+  std::size_t b = n / 4 * 2;
+  std::size_t c = n / 4 * 3;
+  std::size_t swaps = 0;
+
+  auto sort2 = [&](std::size_t& x, std::size_t& y) {
+    if (sort_lt(less, static_cast<T const*>(v + y), static_cast<T const*>(v + x))) {
+      std::size_t t = x;
+      x = y;
+      y = t;
+      ++swaps;
+    }
+  };
+  auto sort3 = [&](std::size_t& x, std::size_t& y, std::size_t& z) {
+    sort2(x, y);
+    sort2(y, z);
+    sort2(x, y);
+  };
+
+  if (n >= 8) {
+    if (n >= 50) {
+      auto sort_adjacent = [&](std::size_t& x) {
+        std::size_t lo = x - 1;
+        std::size_t hi = x + 1;
+        sort3(lo, x, hi);
+      };
+      sort_adjacent(a);
+      sort_adjacent(b);
+      sort_adjacent(c);
+    }
+    sort3(a, b, c);
+  }
+
+  if (swaps < max_swaps) {
+    *likely_sorted = swaps == 0;
+    return b;
+  }
+
+  for (std::size_t i = 0; i < n / 2; ++i) swap_elems(v + i, v + n - 1 - i);
+  *likely_sorted = true;
+  return n - 1 - b;
+}
+
+template<class T, class F>
+void pdqsort(T* v, std::size_t n, F& less, T const* pred, std::size_t limit)
+{
+  std::size_t const max_insertion = 20;
+
+  bool was_balanced = true;
+  bool was_partitioned = true;
+
+  while (true) {
+    if (n <= max_insertion) {
+      insertion_sort(v, n, less);
+      return;
+    }
+
+    if (limit == 0) {
+      heapsort(v, n, less);
+      return;
+    }
+
+    if (!was_balanced) {
+      break_patterns(v, n);
+      --limit;
+    }
+
+    bool likely_sorted = false;
+    std::size_t const pivot = choose_pivot(v, n, less, &likely_sorted);
+
+    if (was_balanced && was_partitioned && likely_sorted) {
+      if (partial_insertion_sort(v, n, less)) return;
+    }
+
+    // Everything here is at least the predecessor. If the pivot equals it,
+    // the pivot's equals go first and are done.
+    if (pred && !sort_lt(less, pred, static_cast<T const*>(v + pivot))) {
+      std::size_t const mid = partition_equal(v, n, pivot, less);
+      v += mid;
+      n -= mid;
+      continue;
+    }
+
+    std::size_t const mid = partition(v, n, pivot, less, &was_partitioned);
+    std::size_t const left_n = mid;
+    std::size_t const right_n = n - mid - 1;
+    was_balanced = (left_n < right_n ? left_n : right_n) >= n / 8;
+
+    // Recurse into the shorter side to bound the stack depth.
+    if (left_n < right_n) {
+      pdqsort(v, left_n, less, pred, limit);
+      pred = v + mid;
+      v += mid + 1;
+      n = right_n;
+    } else {
+      pdqsort(v + mid + 1, right_n, less, static_cast<T const*>(v + mid), limit);
+      n = left_n;
+    }
+  }
+}
+
+template<class T, class F>
+void sort_unstable_impl(T* v, std::size_t n, F& less)
+{
+  if (n < 2) return;
+
+  std::size_t limit = 0;
+  for (std::size_t k = n; k > 0; k >>= 1) ++limit;
+  pdqsort(v, n, less, static_cast<T const*>(nullptr), limit);
+}
+
+// Top-down merge sort. Only the left run of a merge is moved to the
+// scratch buffer, so it needs room for n / 2 elements.
+template<class T, class F>
+void merge_sort(T* v, std::size_t n, T* buf, F& less)
+{
+  std::size_t const max_insertion = 20;
+  if (n <= max_insertion) {
+    insertion_sort(v, n, less);
+    return;
+  }
+
+  std::size_t const mid = n / 2;
+  merge_sort(v, mid, buf, less);
+  merge_sort(v + mid, n - mid, buf, less);
+
+  if (!sort_lt(less, static_cast<T const*>(v + mid), static_cast<T const*>(v + mid - 1))) return;
+
+  std::memcpy(static_cast<void*>(buf), static_cast<void const*>(v), mid * sizeof(T));
+
+  merge_hole<T> hole{ buf, buf + mid, v };
+  T* right = v + mid;
+  T* const right_end = v + n;
+  while (hole.start < hole.end && right < right_end) {
+    // Taking from the left on ties keeps the sort stable.
+    if (sort_lt(less, static_cast<T const*>(right), static_cast<T const*>(hole.start))) {
+      relocate_one(hole.out, right);
+      ++right;
+    } else {
+      relocate_one(hole.out, hole.start);
+      ++hole.start;
+    }
+    ++hole.out;
+  }
+}
+
+template<class T, class F>
+void sort_impl(T* v, std::size_t n, F& less)
+{
+  if (n < 2) return;
+
+  if (n <= 20) {
+    insertion_sort(v, n, less);
+    return;
+  }
+
+  // The buffer never owns elements, so freeing it on unwind is enough.
+  scratch_buffer buf{ ::operator new((n / 2) * sizeof(T)) };
+  merge_sort(v, n, static_cast<T*>(buf.p), less);
+}
+
+} // namespace detail
+
+struct default_less
+{
+  template<class T>
+  bool operator()(self const^, T const^ a, T const^ b) safe {
+    return *a < *b;
+  }
+};
+
+template<class K+>
+struct key_less
+{
+  K key;
+
+  template<class T>
+  bool operator()(self^, T const^ a, T const^ b) safe {
+    return mut self->key(a) < mut self->key(b);
+  }
+};
+
+// Stable merge sort. Needs scratch space for half the slice.
+template<class T>
+void sort([T; dyn]^ s) safe
+{
+  default_less less{};
+  unsafe { detail::sort_impl((*s)~as_pointer, (*s)~length, less); }
+}
+
+// less is a strict weak ordering over const borrows. It runs inside the
+// sort's unsafe block, so it must be safe to call.
+template<class T, class F+>
+void sort_by([T; dyn]^ s, F less) safe
+requires FnMut<F, bool, T const, T const>
+{
+  unsafe { detail::sort_impl((*s)~as_pointer, (*s)~length, less); }
+}
+
+template<class T, class K+>
+void sort_by_key([T; dyn]^ s, K key) safe
+requires FnMut<K, iter::call_result_t<K, T const^>, T const>
+{
+  key_less<K> less{ rel key };
+  unsafe { detail::sort_impl((*s)~as_pointer, (*s)~length, less); }
+}
+
+// Pattern-defeating quicksort: in place, not stable, O(n log n) worst case.
+template<class T>
+void sort_unstable([T; dyn]^ s) safe
+{
+  default_less less{};
+  unsafe { detail::sort_unstable_impl((*s)~as_pointer, (*s)~length, less); }
+}
+
+template<class T, class F+>
+void sort_unstable_by([T; dyn]^ s, F less) safe
+requires FnMut<F, bool, T const, T const>
+{
+  unsafe { detail::sort_unstable_impl((*s)~as_pointer, (*s)~length, less); }
+}
+
+template<class T, class K+>
+void sort_unstable_by_key([T; dyn]^ s, K key) safe
+requires FnMut<K, iter::call_result_t<K, T const^>, T const>
+{
+  key_less<K> less{ rel key };
+  unsafe { detail::sort_unstable_impl((*s)~as_pointer, (*s)~length, less); }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// search.h
+
+namespace detail
+{
+
+// Branchless binary search: the loop runs a fixed log2(n) times and the
+// step is a conditional move, so the branch predictor never has to guess.
+template<class T, class P>
+std::size_t partition_point_impl(T const* p, std::size_t n, P& pred)
+{
+  if (n == 0) return 0;
+
+  T const* first = p;
+  std::size_t len = n;
+  while (len > 1) {
+    std::size_t const half = len / 2;
+    first = pred(^first[half - 1]) ? first + half : first;
+    len -= half;
+  }
+  return static_cast<std::size_t>(first - p) + (pred(^*first) ? 1 : 0);
+}
+
+template<class T>
+struct below/(a)
+{
+  T const^/a x;
+
+  bool operator()(self^, T const^ e) safe { return *e < *self->x; }
+};
+
+template<class T>
+struct not_above/(a)
+{
+  T const^/a x;
+
+  bool operator()(self^, T const^ e) safe { return !(*self->x < *e); }
+};
+
+template<class F+>
+struct ordered_before/(a)
+{
+  F^/a f;
+
+  template<class T>
+  bool operator()(self^, T const^ e) safe { return mut (*self->f)(e) < 0; }
+};
+
+template<class T, class F>
+void select_nth_impl(T* v, std::size_t n, std::size_t k, F& less)
+{
+  std::size_t limit = 0;
+  for (std::size_t m = n; m > 0; m >>= 1) ++limit;
+
+  while (true) {
+    if (n <= 16) {
+      insertion_sort(v, n, less);
+      return;
+    }
+
+    // Too many lopsided partitions: finish in O(n log n).
+    if (limit == 0) {
+      heapsort(v, n, less);
+      return;
+    }
+
+    bool likely_sorted = false;
+    std::size_t const pivot = choose_pivot(v, n, less, &likely_sorted);
+
+    bool was_partitioned = false;
+    std::size_t const mid = partition(v, n, pivot, less, &was_partitioned);
+
+    if (mid == 0) {
+      // The pivot is a minimum: it and its equals are in their final range.
+      std::size_t const equal = partition_equal(v, n, 0, less);
+      if (k < equal) return;
+      v += equal;
+      n -= equal;
+      k -= equal;
+      continue;
+    }
+
+    std::size_t const right_n = n - mid - 1;
+    if ((mid < right_n ? mid : right_n) < n / 8) --limit;
+
+    if (k == mid) return;
+    if (k < mid) {
+      n = mid;
+    } else {
+      v += mid + 1;
+      k -= mid + 1;
+      n = right_n;
+    }
+  }
+}
+
+} // namespace detail
+
+// Given a slice whose elements satisfy pred for some prefix and not after
+// it, returns the length of that prefix.
+template<class T, class P+>
+std::size_t partition_point(const [T; dyn]^ s, P pred) safe
+requires FnMut<P, bool, T const>
+{
+  unsafe { return detail::partition_point_impl((*s)~as_pointer, (*s)~length, pred); }
+}
+
+// Index of the first element not less than x.
+template<class T>
+std::size_t lower_bound(const [T; dyn]^ s, const T^ x) safe
+{
+  detail::below<T> pred{ x };
+  unsafe { return detail::partition_point_impl((*s)~as_pointer, (*s)~length, pred); }
+}
+
+// Index of the first element greater than x.
+template<class T>
+std::size_t upper_bound(const [T; dyn]^ s, const T^ x) safe
+{
+  detail::not_above<T> pred{ x };
+  unsafe { return detail::partition_point_impl((*s)~as_pointer, (*s)~length, pred); }
+}
+
+// Searches a sorted slice for x. Returns .ok with the index of a match, or
+// .err with the index x would have to be inserted at to keep s sorted.
+template<class T>
+expected<std::size_t, std::size_t> binary_search(const [T; dyn]^ s, const T^ x) safe
+{
+  std::size_t const i = lower_bound(s, x);
+  if (i < (*s)~length && !(*x < (*s)[i])) return .ok(i);
+  return .err(i);
+}
+
+// As binary_search, with f returning how an element compares to the target:
+// negative, zero or positive, or a std::*_ordering.
+template<class T, class F+>
+expected<std::size_t, std::size_t> binary_search_by(const [T; dyn]^ s, F f) safe
+requires FnMut<F, iter::call_result_t<F, T const^>, T const>
+{
+  detail::ordered_before<F> pred{ ^f };
+  unsafe { std::size_t const i = detail::partition_point_impl((*s)~as_pointer, (*s)~length, pred); }
+  if (i < (*s)~length && mut f((*s)[i]) == 0) return .ok(i);
+  return .err(i);
+}
+
+template<class T, class K, class F+>
+expected<std::size_t, std::size_t> binary_search_by_key(const [T; dyn]^ s, const K^ key, F f) safe
+requires FnMut<F, K, T const>
+{
+  std::size_t lo = 0;
+  std::size_t hi = (*s)~length;
+
+  // Keys may be expensive, so this stays a plain binary search that stops
+  // on the first match.
+  while (lo < hi) {
+    std::size_t const m = lo + (hi - lo) / 2;
+    K const k = mut f((*s)[m]);
+    if (k < *key) lo = m + 1;
+    else if (*key < k) hi = m;
+    else return .ok(m);
+  }
+  return .err(lo);
+}
+
+template<class T, class F+>
+bool is_sorted_by(const [T; dyn]^ s, F less) safe
+{
+  std::size_t const n = (*s)~length;
+  for (std::size_t i = 1; i < n; ++i) {
+    if (mut less((*s)[i], (*s)[i - 1])) return false;
+  }
+  return true;
+}
+
+template<class T>
+bool is_sorted(const [T; dyn]^ s) safe
+{
+  return is_sorted_by(s, default_less{});
+}
+
+// Reorders s so that the element at k is the one a full sort would put
+// there, with nothing greater before it and nothing less after it. Expected
+// O(n), O(n log n) at worst. Returns the part before k, the element and the
+// part after.
+template<class T, class F+>
+auto select_nth_unstable_by/(a)([T; dyn]^/a s, std::size_t k, F less) safe
+  -> ([T; dyn]^/a, T^/a, [T; dyn]^/a)
+requires FnMut<F, bool, T const, T const>
+{
+  std::size_t const n = (*s)~length;
+  if (k >= n) panic_bounds("select_nth_unstable index is out-of-bounds");
+
+  T* p = (*s)~as_pointer;
+  unsafe { detail::select_nth_impl(p, n, k, less); }
+  unsafe { return (slice_from_raw_parts(p, k), ^p[k], slice_from_raw_parts(p + k + 1, n - k - 1)); }
+}
+
+template<class T>
+auto select_nth_unstable/(a)([T; dyn]^/a s, std::size_t k) safe
+  -> ([T; dyn]^/a, T^/a, [T; dyn]^/a)
+{
+  return select_nth_unstable_by(s, k, default_less{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// simd.h
+
+// Fixed-width vectors over the compiler's generic vector types. Each
+// operation lowers to the widest instructions the build targets: SSE2 on
+// baseline x86-64, AVX2 or AVX-512 when built with -mavx2 or -mavx512f.
+// Wider vectors than the target supports are split into several registers.
+
+enum class simd_isa
+{
+  scalar,
+  sse2,
+  avx2,
+  avx512,
+};
+
+// The widest vector extension this CPU supports, for choosing between
+// kernels or builds at run time.
+inline simd_isa detect_simd_isa() noexcept safe
+{
+#if defined(__x86_64__)
+  unsafe { __builtin_cpu_init(); }
+  unsafe { bool const avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"); }
+  if (avx512) return simd_isa::avx512;
+  unsafe { bool const avx2 = __builtin_cpu_supports("avx2"); }
+  if (avx2) return simd_isa::avx2;
+  return simd_isa::sse2;
+#else
+  return simd_isa::scalar;
+#endif
+}
+
+// Lanes of T in one register of the widest extension enabled at compile
+// time.
+template<class T>
+inline constexpr std::size_t native_simd_size =
+#if defined(__AVX512F__)
+  64 / sizeof(T);
+#elif defined(__AVX2__)
+  32 / sizeof(T);
+#else
+  16 / sizeof(T);
+#endif
+
+namespace detail
+{
+
+template<std::size_t Bytes>
+struct simd_lane_int;
+
+template<> struct simd_lane_int<1> { using type = std::int8_t; };
+template<> struct simd_lane_int<2> { using type = std::int16_t; };
+template<> struct simd_lane_int<4> { using type = std::int32_t; };
+template<> struct simd_lane_int<8> { using type = std::int64_t; };
+
+} // namespace detail
+
+template<class T, std::size_t N>
+class simd;
+
+// The result of comparing two simd values: every lane is all ones or all
+// zeros.
+template<class T, std::size_t N>
+class simd_mask
+{
+  using lane_type = typename detail::simd_lane_int<sizeof(T)>::type;
+  using vector_type = lane_type __attribute__((vector_size(N * sizeof(T))));
+
+  vector_type v_;
+
+  friend class simd<T, N>;
+
+  explicit simd_mask(vector_type v) noexcept safe
+    : v_(v)
+  {
+  }
+
+public:
+  static constexpr std::size_t size = N;
+
+  // The first n lanes set, for the tail of a slice.
+  static simd_mask first_n(std::size_t n) noexcept safe {
+    vector_type v = {};
+    for (std::size_t i = 0; i < N; ++i) {
+      v[i] = i < n ? lane_type(-1) : lane_type(0);
+    }
+    return simd_mask(v);
+  }
+
+  bool operator[](self const^, std::size_t i) noexcept safe {
+    if (i >= N) panic_bounds("simd_mask lane is out-of-bounds");
+    return self->v_[i] != 0;
+  }
+
+  simd_mask operator&(self const^, simd_mask const^ rhs) noexcept safe {
+    return simd_mask(self->v_ & rhs->v_);
+  }
+
+  simd_mask operator|(self const^, simd_mask const^ rhs) noexcept safe {
+    return simd_mask(self->v_ | rhs->v_);
+  }
+
+  simd_mask operator!(self const^) noexcept safe {
+    return simd_mask(~self->v_);
+  }
+
+  // Lane i in bit i. On x86 this is a movemask.
+  std::uint64_t to_bitmask(self const^) noexcept safe
+  requires(N <= 64)
+  {
+    std::uint64_t bits = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+      bits |= std::uint64_t(self->v_[i] & 1) << i;
+    }
+    return bits;
+  }
+
+  // Masks too wide for a bitmask, such as simd<std::int8_t, 128>, are
+  // scanned lane by lane instead.
+
+  bool any(self const^) noexcept safe {
+    if constexpr (N <= 64) {
+      return self.to_bitmask() != 0;
+    } else {
+      return self.first_set().is_some();
+    }
+  }
+
+  bool all(self const^) noexcept safe {
+    return self.count() == N;
+  }
+
+  std::size_t count(self const^) noexcept safe {
+    if constexpr (N <= 64) {
+      return static_cast<std::size_t>(__builtin_popcountll(self.to_bitmask()));
+    } else {
+      std::size_t n = 0;
+      for (std::size_t i = 0; i < N; ++i) n += self->v_[i] != 0;
+      return n;
+    }
+  }
+
+  optional<std::size_t> first_set(self const^) noexcept safe {
+    if constexpr (N <= 64) {
+      std::uint64_t const bits = self.to_bitmask();
+      if (bits == 0) return .none;
+      return .some(static_cast<std::size_t>(__builtin_ctzll(bits)));
+    } else {
+      for (std::size_t i = 0; i < N; ++i) {
+        if (self->v_[i] != 0) return .some(i);
+      }
+      return .none;
+    }
+  }
+};
+
+template<class T, std::size_t N>
+class simd
+{
+  static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "simd lanes must be numbers");
+  static_assert(N > 0 && (N & (N - 1)) == 0, "simd width must be a power of two");
+
+  using vector_type = T __attribute__((vector_size(N * sizeof(T))));
+
+  vector_type v_;
+
+  explicit simd(vector_type v) noexcept safe
+    : v_(v)
+  {
+  }
+
+  static vector_type splat(T x) noexcept safe {
+    vector_type v = {};
+    return v + x;
+  }
+
+public:
+  using value_type = T;
+  using mask_type = simd_mask<T, N>;
+  static constexpr std::size_t size = N;
+
+  simd() noexcept safe
+    : v_{}
+  {
+  }
+
+  // Every lane set to x.
+  explicit simd(T x) noexcept safe
+    : v_(splat(x))
+  {
+  }
+
+  static simd load(const [T; N]^ a) noexcept safe {
+    simd r{};
+    unsafe { std::memcpy(addr r.v_, addr (*a)[0], sizeof(vector_type)); }
+    return r;
+  }
+
+  // The N lanes starting at s[offset], which must all be in bounds.
+  static simd load(const [T; dyn]^ s, std::size_t offset) noexcept safe {
+    std::size_t const len = (*s)~length;
+    if (offset > len || len - offset < N) panic_bounds("simd load is out-of-bounds");
+
+    simd r{};
+    unsafe { std::memcpy(addr r.v_, (*s)~as_pointer + offset, sizeof(vector_type)); }
+    return r;
+  }
+
+  // Loads what's left of s from offset, up to N lanes, and sets the lanes
+  // past the end to fill. Pair with mask_type::first_n for the tail of a
+  // loop.
+  static simd load_partial(const [T; dyn]^ s, std::size_t offset, T fill = T()) noexcept safe {
+    std::size_t const len = (*s)~length;
+    if (offset > len) panic_bounds("simd load is out-of-bounds");
+
+    std::size_t const n = len - offset < N ? len - offset : N;
+    simd r(fill);
+    unsafe { std::memcpy(addr r.v_, (*s)~as_pointer + offset, n * sizeof(T)); }
+    return r;
+  }
+
+  void store(self const^, [T; N]^ a) noexcept safe {
+    unsafe { std::memcpy(addr (*a)[0], addr self->v_, sizeof(vector_type)); }
+  }
+
+  void store(self const^, [T; dyn]^ s, std::size_t offset) noexcept safe {
+    std::size_t const len = (*s)~length;
+    if (offset > len || len - offset < N) panic_bounds("simd store is out-of-bounds");
+    unsafe { std::memcpy((*s)~as_pointer + offset, addr self->v_, sizeof(vector_type)); }
+  }
+
+  // Stores up to N lanes, stopping at the end of s.
+  void store_partial(self const^, [T; dyn]^ s, std::size_t offset) noexcept safe {
+    std::size_t const len = (*s)~length;
+    if (offset > len) panic_bounds("simd store is out-of-bounds");
+
+    std::size_t const n = len - offset < N ? len - offset : N;
+    unsafe { std::memcpy((*s)~as_pointer + offset, addr self->v_, n * sizeof(T)); }
+  }
+
+  T operator[](self const^, std::size_t i) noexcept safe {
+    if (i >= N) panic_bounds("simd lane is out-of-bounds");
+    return self->v_[i];
+  }
+
+  simd operator+(self const^, simd const^ rhs) noexcept safe { return simd(self->v_ + rhs->v_); }
+  simd operator-(self const^, simd const^ rhs) noexcept safe { return simd(self->v_ - rhs->v_); }
+  simd operator*(self const^, simd const^ rhs) noexcept safe { return simd(self->v_ * rhs->v_); }
+
+  simd operator/(self const^, simd const^ rhs) noexcept safe {
+    if constexpr (std::is_integral_v<T>) {
+      for (std::size_t i = 0; i < N; ++i) {
+        if (rhs->v_[i] == 0) panic("simd integer division by zero");
+        if constexpr (std::is_signed_v<T>) {
+          if (rhs->v_[i] == T(-1) && self->v_[i] == std::numeric_limits<T>::min()) {
+            panic("simd integer division overflow");
+          }
+        }
+      }
+    }
+    return simd(self->v_ / rhs->v_);
+  }
+
+  simd operator-(self const^) noexcept safe { return simd(-self->v_); }
+
+  simd operator&(self const^, simd const^ rhs) noexcept safe requires(std::is_integral_v<T>) {
+    return simd(self->v_ & rhs->v_);
+  }
+
+  simd operator|(self const^, simd const^ rhs) noexcept safe requires(std::is_integral_v<T>) {
+    return simd(self->v_ | rhs->v_);
+  }
+
+  simd operator^(self const^, simd const^ rhs) noexcept safe requires(std::is_integral_v<T>) {
+    return simd(self->v_ ^ rhs->v_);
+  }
+
+  // Shifts past the lane width are masked to it, as x86 does not.
+  simd operator<<(self const^, unsigned n) noexcept safe requires(std::is_integral_v<T>) {
+    return simd(self->v_ << T(n % (8 * sizeof(T))));
+  }
+
+  simd operator>>(self const^, unsigned n) noexcept safe requires(std::is_integral_v<T>) {
+    return simd(self->v_ >> T(n % (8 * sizeof(T))));
+  }
+
+  void operator+=(self^, simd const^ rhs) noexcept safe { self->v_ += rhs->v_; }
+  void operator-=(self^, simd const^ rhs) noexcept safe { self->v_ -= rhs->v_; }
+  void operator*=(self^, simd const^ rhs) noexcept safe { self->v_ *= rhs->v_; }
+
+  mask_type operator==(self const^, simd const^ rhs) noexcept safe { return mask_type(self->v_ == rhs->v_); }
+  mask_type operator!=(self const^, simd const^ rhs) noexcept safe { return mask_type(self->v_ != rhs->v_); }
+  mask_type operator<(self const^, simd const^ rhs) noexcept safe { return mask_type(self->v_ < rhs->v_); }
+  mask_type operator<=(self const^, simd const^ rhs) noexcept safe { return mask_type(self->v_ <= rhs->v_); }
+  mask_type operator>(self const^, simd const^ rhs) noexcept safe { return mask_type(self->v_ > rhs->v_); }
+  mask_type operator>=(self const^, simd const^ rhs) noexcept safe { return mask_type(self->v_ >= rhs->v_); }
+
+  // Lanes of a where m is set, of b elsewhere.
+  static simd select(mask_type const^ m, simd const^ a, simd const^ b) noexcept safe {
+    using bits_type = typename mask_type::vector_type;
+    bits_type const x = (bits_type)a->v_;
+    bits_type const y = (bits_type)b->v_;
+    return simd((vector_type)((m->v_ & x) | (~m->v_ & y)));
+  }
+
+  static simd min(simd const^ a, simd const^ b) noexcept safe {
+    return select(*a < *b, a, b);
+  }
+
+  static simd max(simd const^ a, simd const^ b) noexcept safe {
+    return select(*a > *b, a, b);
+  }
+
+  // Horizontal reductions halve the vector until one lane is left, which
+  // compiles to log2(N) shuffles.
+  T reduce_add(self const^) noexcept safe {
+    vector_type v = self->v_;
+    for (std::size_t w = N / 2; w > 0; w /= 2) {
+      for (std::size_t i = 0; i < w; ++i) v[i] += v[i + w];
+    }
+    return v[0];
+  }
+
+  T reduce_min(self const^) noexcept safe {
+    vector_type v = self->v_;
+    for (std::size_t w = N / 2; w > 0; w /= 2) {
+      for (std::size_t i = 0; i < w; ++i) v[i] = v[i + w] < v[i] ? v[i + w] : v[i];
+    }
+    return v[0];
+  }
+
+  T reduce_max(self const^) noexcept safe {
+    vector_type v = self->v_;
+    for (std::size_t w = N / 2; w > 0; w /= 2) {
+      for (std::size_t i = 0; i < w; ++i) v[i] = v[i] < v[i + w] ? v[i + w] : v[i];
+    }
+    return v[0];
+  }
+};
+
+// One register's worth of T on this build.
+template<class T>
+using native_simd = simd<T, native_simd_size<T>>;
+
+////////////////////////////////////////////////////////////////////////////////
+// numeric.h
+
+// Reductions over numeric slices. Each kernel runs several vector
+// accumulators so loads and adds overlap, and handles the tail with one
+// partial load. Float sums are reassociated, so their rounding differs
+// from a left-to-right loop; pairwise_sum and kahan_sum bound that error.
+//
+// On x86-64, sum, dot, min, max and histogram are also built for AVX2 and
+// AVX-512 and choose at run time the widest one the CPU supports, so a
+// baseline build still gets the wide registers. The lane count then
+// depends on the CPU, and so does the rounding of float sum and dot.
+
+namespace detail
+{
+
+template<class T>
+inline constexpr bool is_simd_number = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+
+// Index of the first element equal to x at or after from, or the length.
+template<class T>
+std::size_t position_of(const [T; dyn]^ s, T x, std::size_t from) noexcept safe
+{
+  using V = native_simd<T>;
+  std::size_t const len = (*s)~length;
+  V const target(x);
+
+  std::size_t i = from;
+  for (; i + V::size <= len; i += V::size) {
+    std::uint64_t const bits = (V::load(s, i) == target).to_bitmask();
+    if (bits) return i + static_cast<std::size_t>(__builtin_ctzll(bits));
+  }
+  if (i < len) {
+    auto m = V::load_partial(s, i) == target & V::mask_type::first_n(len - i);
+    std::uint64_t const bits = m.to_bitmask();
+    if (bits) return i + static_cast<std::size_t>(__builtin_ctzll(bits));
+  }
+  return len;
+}
+
+// Index of the first element that isn't NaN, or the length.
+template<class T>
+std::size_t first_number(const [T; dyn]^ s) noexcept safe
+{
+  std::size_t i = 0;
+  if constexpr (std::is_floating_point_v<T>) {
+    while (i < (*s)~length && (*s)[i] != (*s)[i]) ++i;
+  }
+  return i;
+}
+
+// The kernels behind sum, dot, min, max and histogram. They are generic over
+// the vector type and always inlined, so each one compiles for the target of
+// the function that instantiates it.
+
+template<class V, class T>
+inline __attribute__((always_inline))
+T sum_kernel(const [T; dyn]^ s) noexcept safe
+{
+  std::size_t const len = (*s)~length;
+
+  V acc0{};
+  V acc1{};
+  V acc2{};
+  V acc3{};
+  std::size_t i = 0;
+  for (; i + 4 * V::size <= len; i += 4 * V::size) {
+    mut acc0 += V::load(s, i);
+    mut acc1 += V::load(s, i + V::size);
+    mut acc2 += V::load(s, i + 2 * V::size);
+    mut acc3 += V::load(s, i + 3 * V::size);
+  }
+  for (; i < len; i += V::size) {
+    mut acc0 += V::load_partial(s, i);
+  }
+  return ((acc0 + acc1) + (acc2 + acc3)).reduce_add();
+}
+
+// a and b have the same length.
+template<class V, class T>
+inline __attribute__((always_inline))
+T dot_kernel(const [T; dyn]^ a, const [T; dyn]^ b) noexcept safe
+{
+  std::size_t const len = (*a)~length;
+
+  V acc0{};
+  V acc1{};
+  V acc2{};
+  V acc3{};
+  std::size_t i = 0;
+  for (; i + 4 * V::size <= len; i += 4 * V::size) {
+    mut acc0 += V::load(a, i) * V::load(b, i);
+    mut acc1 += V::load(a, i + V::size) * V::load(b, i + V::size);
+    mut acc2 += V::load(a, i + 2 * V::size) * V::load(b, i + 2 * V::size);
+    mut acc3 += V::load(a, i + 3 * V::size) * V::load(b, i + 3 * V::size);
+  }
+  for (; i < len; i += V::size) {
+    mut acc0 += V::load_partial(a, i) * V::load_partial(b, i);
+  }
+  return ((acc0 + acc1) + (acc2 + acc3)).reduce_add();
+}
+
+// The least element at or after i, where (*s)[i] isn't NaN.
+template<class V, class T>
+inline __attribute__((always_inline))
+T min_kernel(const [T; dyn]^ s, std::size_t i) noexcept safe
+{
+  std::size_t const len = (*s)~length;
+
+  T const init = (*s)[i];
+  V acc0(init);
+  V acc1(init);
+  for (; i + 2 * V::size <= len; i += 2 * V::size) {
+    V const x0 = V::load(s, i);
+    V const x1 = V::load(s, i + V::size);
+    acc0 = V::select(x0 < acc0, x0, acc0);
+    acc1 = V::select(x1 < acc1, x1, acc1);
+  }
+  for (; i < len; i += V::size) {
+    V const x = V::load_partial(s, i, init);
+    acc0 = V::select(x < acc0, x, acc0);
+  }
+  return V::select(acc1 < acc0, acc1, acc0).reduce_min();
+}
+
+template<class V, class T>
+inline __attribute__((always_inline))
+T max_kernel(const [T; dyn]^ s, std::size_t i) noexcept safe
+{
+  std::size_t const len = (*s)~length;
+
+  T const init = (*s)[i];
+  V acc0(init);
+  V acc1(init);
+  for (; i + 2 * V::size <= len; i += 2 * V::size) {
+    V const x0 = V::load(s, i);
+    V const x1 = V::load(s, i + V::size);
+    acc0 = V::select(acc0 < x0, x0, acc0);
+    acc1 = V::select(acc1 < x1, x1, acc1);
+  }
+  for (; i < len; i += V::size) {
+    V const x = V::load_partial(s, i, init);
+    acc0 = V::select(acc0 < x, x, acc0);
+  }
+  return V::select(acc0 < acc1, acc1, acc0).reduce_max();
+}
+
+template<class T>
+inline __attribute__((always_inline))
+void histogram_kernel(const [T; dyn]^ s, [std::uint64_t; dyn]^ counts) safe
+{
+  std::size_t const len = (*s)~length;
+  std::size_t const bins = (*counts)~length;
+  T const* p = (*s)~as_pointer;
+  std::uint64_t* c = (*counts)~as_pointer;
+
+  if constexpr (sizeof(T) == 1) {
+    if (bins >= 256) {
+      std::uint64_t tables[4][256] {};
+      std::size_t i = 0;
+      for (; i + 4 <= len; i += 4) {
+        unsafe {
+          ++tables[0][p[i]];
+          ++tables[1][p[i + 1]];
+          ++tables[2][p[i + 2]];
+          ++tables[3][p[i + 3]];
+        }
+      }
+      for (; i < len; ++i) {
+        unsafe { ++tables[0][p[i]]; }
+      }
+
+      for (std::size_t b = 0; b < 256; ++b) {
+        unsafe { c[b] += tables[0][b] + tables[1][b] + tables[2][b] + tables[3][b]; }
+      }
+      return;
+    }
+  }
+
+  for (std::size_t i = 0; i < len; ++i) {
+    unsafe { T const x = p[i]; }
+    if (x >= bins) panic_bounds("histogram value has no bin");
+    unsafe { ++c[x]; }
+  }
+}
+
+#if defined(__x86_64__)
+
+// The kernels built for AVX2 and AVX-512 whatever the build's own target.
+// Only called once detect_simd_isa has found the extension on this CPU.
+
+template<class T>
+__attribute__((target("avx2")))
+T sum_avx2(const [T; dyn]^ s) noexcept safe
+{
+  return sum_kernel<simd<T, 32 / sizeof(T)>>(s);
+}
+
+template<class T>
+__attribute__((target("avx512f,avx512bw")))
+T sum_avx512(const [T; dyn]^ s) noexcept safe
+{
+  return sum_kernel<simd<T, 64 / sizeof(T)>>(s);
+}
+
+template<class T>
+__attribute__((target("avx2")))
+T dot_avx2(const [T; dyn]^ a, const [T; dyn]^ b) noexcept safe
+{
+  return dot_kernel<simd<T, 32 / sizeof(T)>>(a, b);
+}
+
+template<class T>
+__attribute__((target("avx512f,avx512bw")))
+T dot_avx512(const [T; dyn]^ a, const [T; dyn]^ b) noexcept safe
+{
+  return dot_kernel<simd<T, 64 / sizeof(T)>>(a, b);
+}
+
+template<class T>
+__attribute__((target("avx2")))
+T min_avx2(const [T; dyn]^ s, std::size_t i) noexcept safe
+{
+  return min_kernel<simd<T, 32 / sizeof(T)>>(s, i);
+}
+
+template<class T>
+__attribute__((target("avx512f,avx512bw")))
+T min_avx512(const [T; dyn]^ s, std::size_t i) noexcept safe
+{
+  return min_kernel<simd<T, 64 / sizeof(T)>>(s, i);
+}
+
+template<class T>
+__attribute__((target("avx2")))
+T max_avx2(const [T; dyn]^ s, std::size_t i) noexcept safe
+{
+  return max_kernel<simd<T, 32 / sizeof(T)>>(s, i);
+}
+
+template<class T>
+__attribute__((target("avx512f,avx512bw")))
+T max_avx512(const [T; dyn]^ s, std::size_t i) noexcept safe
+{
+  return max_kernel<simd<T, 64 / sizeof(T)>>(s, i);
+}
+
+template<class T>
+__attribute__((target("avx2")))
+void histogram_avx2(const [T; dyn]^ s, [std::uint64_t; dyn]^ counts) safe
+{
+  histogram_kernel(s, counts);
+}
+
+template<class T>
+__attribute__((target("avx512f,avx512bw")))
+void histogram_avx512(const [T; dyn]^ s, [std::uint64_t; dyn]^ counts) safe
+{
+  histogram_kernel(s, counts);
+}
+
+#endif
+
+// The extension the numeric functions dispatch on, detected once.
+inline simd_isa numeric_isa() noexcept safe
+{
+  unsafe { static simd_isa const isa = detect_simd_isa(); }
+  return isa;
+}
+
+} // namespace detail
+
+// Sum in T with four vector accumulators.
+template<class T>
+T sum(const [T; dyn]^ s) noexcept safe
+requires(detail::is_simd_number<T>)
+{
+#if defined(__x86_64__)
+  switch (detail::numeric_isa()) {
+    case simd_isa::avx512: return detail::sum_avx512(s);
+    case simd_isa::avx2: return detail::sum_avx2(s);
+    default: break;
+  }
+#endif
+  return detail::sum_kernel<native_simd<T>>(s);
+}
+
+// Float sum with error growing as O(log n) rather than O(n): halves are
+// summed recursively down to blocks small enough for sum.
+template<class T>
+T pairwise_sum(const [T; dyn]^ s) noexcept safe
+requires(std::is_floating_point_v<T>)
+{
+  std::size_t const len = (*s)~length;
+  if (len <= 256) return sum(s);
+
+  auto halves = split_at(s, len / 2);
+  return pairwise_sum(halves.0) + pairwise_sum(halves.1);
+}
+
+// Compensated float sum: each lane carries the rounding error of its
+// running total and feeds it back into the next add. Error is independent
+// of n, at about twice the cost of sum. Don't build with -ffast-math,
+// which optimizes the compensation away.
+template<class T>
+T kahan_sum(const [T; dyn]^ s) noexcept safe
+requires(std::is_floating_point_v<T>)
+{
+  using V = native_simd<T>;
+  std::size_t const len = (*s)~length;
+
+  V total{};
+  V error{};
+  for (std::size_t i = 0; i < len; i += V::size) {
+    V const y = V::load_partial(s, i) - error;
+    V const t = total + y;
+    error = (t - total) - y;
+    total = t;
+  }
+
+  T r = 0;
+  T c = 0;
+  for (std::size_t j = 0; j < V::size; ++j) {
+    T const y = total[j] - c;
+    T const t = r + y;
+    c = (t - r) - y;
+    r = t;
+  }
+  for (std::size_t j = 0; j < V::size; ++j) {
+    T const y = -error[j] - c;
+    T const t = r + y;
+    c = (t - r) - y;
+    r = t;
+  }
+  return r;
+}
+
+// The least element, or .none for an empty slice. NaNs are skipped; a
+// slice of only NaNs yields its first element.
+template<class T>
+optional<T> min(const [T; dyn]^ s) noexcept safe
+requires(detail::is_simd_number<T>)
+{
+  std::size_t const len = (*s)~length;
+  if (len == 0) return .none;
+
+  std::size_t const i = detail::first_number(s);
+  if (i == len) return .some((*s)[0]);
+
+#if defined(__x86_64__)
+  switch (detail::numeric_isa()) {
+    case simd_isa::avx512: return .some(detail::min_avx512(s, i));
+    case simd_isa::avx2: return .some(detail::min_avx2(s, i));
+    default: break;
+  }
+#endif
+  return .some(detail::min_kernel<native_simd<T>>(s, i));
+}
+
+// The greatest element, with the same NaN handling as min.
+template<class T>
+optional<T> max(const [T; dyn]^ s) noexcept safe
+requires(detail::is_simd_number<T>)
+{
+  std::size_t const len = (*s)~length;
+  if (len == 0) return .none;
+
+  std::size_t const i = detail::first_number(s);
+  if (i == len) return .some((*s)[0]);
+
+#if defined(__x86_64__)
+  switch (detail::numeric_isa()) {
+    case simd_isa::avx512: return .some(detail::max_avx512(s, i));
+    case simd_isa::avx2: return .some(detail::max_avx2(s, i));
+    default: break;
+  }
+#endif
+  return .some(detail::max_kernel<native_simd<T>>(s, i));
+}
+
+// Index of the first least element. Two vector passes: min, then a search
+// for it, which beats carrying an index vector through the first pass.
+template<class T>
+optional<std::size_t> argmin(const [T; dyn]^ s) noexcept safe
+requires(detail::is_simd_number<T>)
+{
+  std::size_t const len = (*s)~length;
+  if (len == 0) return .none;
+
+  std::size_t const from = detail::first_number(s);
+  if (from == len) return .some(std::size_t(0));
+  return .some(detail::position_of(s, min(s).unwrap(), from));
+}
+
+template<class T>
+optional<std::size_t> argmax(const [T; dyn]^ s) noexcept safe
+requires(detail::is_simd_number<T>)
+{
+  std::size_t const len = (*s)~length;
+  if (len == 0) return .none;
+
+  std::size_t const from = detail::first_number(s);
+  if (from == len) return .some(std::size_t(0));
+  return .some(detail::position_of(s, max(s).unwrap(), from));
+}
+
+// Sum of a[i] * b[i]. The slices must have the same length.
+template<class T>
+T dot(const [T; dyn]^ a, const [T; dyn]^ b) safe
+requires(detail::is_simd_number<T>)
+{
+  if ((*a)~length != (*b)~length) panic("dot requires slices of equal length");
+
+#if defined(__x86_64__)
+  switch (detail::numeric_isa()) {
+    case simd_isa::avx512: return detail::dot_avx512(a, b);
+    case simd_isa::avx2: return detail::dot_avx2(a, b);
+    default: break;
+  }
+#endif
+  return detail::dot_kernel<native_simd<T>>(a, b);
+}
+
+// Replaces each element with the sum of it and everything before it. The
+// loop carries a dependency from one element to the next, so it stays
+// scalar; the gain is dropping the per-element bounds checks.
+template<class T>
+void prefix_sum([T; dyn]^ s) noexcept safe
+requires(detail::is_simd_number<T>)
+{
+  std::size_t const len = (*s)~length;
+  T* p = (*s)~as_pointer;
+
+  T acc = 0;
+  for (std::size_t i = 0; i < len; ++i) {
+    unsafe {
+      acc += p[i];
+      p[i] = acc;
+    }
+  }
+}
+
+// Adds the count of each value in s to counts[value]. Every value must
+// have a bin. Bytes with a full 256 bins skip the checks and spread the
+// counts over four tables, so runs of equal bytes don't serialize on one
+// counter.
+template<class T>
+void histogram(const [T; dyn]^ s, [std::uint64_t; dyn]^ counts) safe
+requires(std::is_integral_v<T> && std::is_unsigned_v<T>)
+{
+#if defined(__x86_64__)
+  switch (detail::numeric_isa()) {
+    case simd_isa::avx512: return detail::histogram_avx512(s, counts);
+    case simd_isa::avx2: return detail::histogram_avx2(s, counts);
+    default: break;
+  }
+#endif
+  detail::histogram_kernel(s, counts);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// utility.h
+
+interface send {};
+interface sync {};
+
+template<class T+>
+class manually_drop
+{
+  T t_;
+
+public:
+  explicit
+  manually_drop(T t) noexcept safe
+    : t_(rel t)
+  {
+  }
+
+  ~manually_drop() = trivial;
+
+  void destroy(self^) noexcept {
+    self->t_^.~T();
+  }
+
+  T const^ get(self const^) noexcept safe {
+    return ^self->t_;
+  }
+};
+
+template<class T+>
+void forget(T t) noexcept safe
+{
+  manually_drop<T>(rel t);
+}
+
+template<class T+>
+class [[unsafe::sync(false)]] unsafe_cell
+{
+  T t_;
+
+public:
+  unsafe_cell() = default;
+
+  explicit
+  unsafe_cell(T t) noexcept safe
+    : t_(rel t)
+  {
+  }
+
+  T* get(self const^) noexcept safe {
+    return const_cast<T*>(addr self->t_);
+  }
+};
+
+template<class T+>
+T replace/(a)(T^/a dst, T src) safe
+{
+  unsafe {
+    T result = __rel_read(addr *dst);
+    __rel_write(addr *dst, rel src);
+    return result;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// atomic.h
+
+template<class T>
+class [[unsafe::sync(true)]] atomic
+{
+  unsafe_cell<std::atomic<T> unsafe>  t_;
+
+public:
+  atomic(T t = T()) safe
+  : t_(rel t)
+  {}
+
+  atomic(atomic const^) = delete;
+  operator rel(atomic) = delete;
+
+  T fetch_add(self const^, T op, std::memory_order memory_order = std::memory_order_seq_cst) noexcept safe {
+    unsafe { return  self->t_.get()&->fetch_add(op, memory_order) + op; }
+  }
+
+  T fetch_sub(self const^, T op, std::memory_order memory_order = std::memory_order_seq_cst) noexcept safe {
+    unsafe { return  self->t_.get()&->fetch_sub(op, memory_order); }
+  }
+
+  T add_fetch(self const^, T op, std::memory_order memory_order = std::memory_order_seq_cst) noexcept safe {
+    unsafe { return  self->t_.get()&->fetch_add(op, memory_order) + op; }
+  }
+
+  T sub_fetch(self const^, T op, std::memory_order memory_order = std::memory_order_seq_cst) noexcept safe {
+    unsafe { return  self->t_.get()&->fetch_sub(op, memory_order) - op; }
+  }
+
+  void store(self const^, T op, std::memory_order memory_order = std::memory_order_seq_cst) noexcept safe {
+    unsafe { self->t_.get()&->store(op, memory_order); }
+  }
+
+  T load(self const^, std::memory_order memory_order = std::memory_order_seq_cst) noexcept safe {
+    unsafe { return self->t_.get()&->load(memory_order); }
+  }
+
+  T operator++(self const^) noexcept safe {
+    return self->add_fetch(1);
+  }
+
+  T operator++(self const^, int) noexcept safe {
+    return self->fetch_add(1);
+  }
+
+  T operator--(self const^) noexcept safe {
+    return self->sub_fetch(1);
+  }
+
+  T operator--(self const^, int) noexcept safe {
+    return self->fetch_sub(1);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// arc.h
+
+template<class T+>
+class
+[[unsafe::send(T~is_send && T~is_sync), unsafe::sync(T~is_send && T~is_sync)]]
+arc
+{
+  struct arc_inner;
+  arc_inner* unsafe p_;
+
+  struct arc_inner
+  {
+    manually_drop<T> data_;
+    atomic<std::size_t> strong_;
+    atomic<std::size_t> weak_;
+
+    arc_inner(T data) noexcept safe
+      : data_(rel data)
+      , strong_(1)
+      , weak_(1)
+    {
+    }
+  };
+
+public:
+
+  explicit
+  arc(T t) safe
+    : p_(new(std::nothrow) arc_inner(rel t))
+  {
+  }
+
+  template<typename T2>
+  explicit arc(T2 t) safe :
+    arc(T(rel t)) { }
+
+  arc(arc const^ rhs) safe
+    : p_(rhs->p_)
+  {
+    ++p_->strong_;
+  }
+
+  [[unsafe::drop_only(T)]]
+  ~arc() safe
+  {
+    std::size_t s = --p_->strong_;
+    if (s == 0) {
+      unsafe { mut p_->data_.destroy(); }
+
+      std::size_t w = --p_->weak_;
+      if (w == 0) {
+        delete p_;
+      }
+    }
+  }
+
+  T const^ operator->(self const^) noexcept safe {
+    return ^*self->p_->data_.get();
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// box.h
+
+template<class T+>
+class
+[[safety::niche_zero, unsafe::send(T~is_send), unsafe::sync(T~is_sync)]]
+box
+{
+  T* unsafe p_;
+  T __phantom_data;
+
+public:
+  box(T* p) noexcept
+    : p_(p)
+  {
+  }
+
+  explicit
+  box(T t) safe
+    : p_(new(std::nothrow) T(rel t))
+  {
+  }
+
+  [[unsafe::drop_only(T)]]
+  ~box() safe {
+    delete p_;
+  }
+
+  // Delete the copy constructors.
+  box(const box^) = delete;
+  box(const box&) = delete;
+
+  static
+  box make_default() safe requires(safe(T()))
+  {
+    unsafe { return box(new T()); }
+  }
+
+  T^ borrow(self^) noexcept safe {
+    return ^*self->p_;
+  }
+
+  T const^ borrow(self const^) noexcept safe {
+    return ^*self->p_;
+  }
+
+  T^ operator*(self^) noexcept safe {
+    return self.borrow();
+  }
+
+  const T^ operator*(const self^) noexcept safe {
+    return self.borrow();
+  }
+
+  T^ operator->(self^) noexcept safe {
+    return ^*self->p_;
+  }
+
+  const T^ operator->(self const^) noexcept safe {
+    return ^*self->p_;
+  }
+
+  T* get(self const^) noexcept safe {
+    return self->p_;
+  }
+
+  T* leak(self) noexcept safe {
+    auto p = self.p_;
+    forget(rel self);
+    return p;
+  }
+
+  T into_inner(self) noexcept safe {
+    unsafe { T t = __rel_read(self.p_); }
+    unsafe { ::operator delete(self.p_); }
+    return rel t;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// unique_ptr.h
+
+template<class T+>
+using unique_ptr = optional<box<T>>;
+
+////////////////////////////////////////////////////////////////////////////////
+// cell.h
+
+template<class T+>
+class [[unsafe::sync(false)]] cell
+{
+  unsafe_cell<T> t_;
+
+  public:
+
+  explicit cell(T t) noexcept safe
+    requires(T~is_trivially_copyable && T~is_trivially_destructible)
+    : t_(rel t)
+  {
+  }
+
+  T get(self const^) safe {
+    // rely on implicit copy operator erroring out for types with non-trivial
+    // destructors or types that have user-defined copy constructors
+    unsafe { return cpy *self->t_.get(); }
+  }
+
+  void set(self const^, T t) safe {
+    unsafe { *self->t_.get() = rel t; }
+  }
+
+  T replace(self const^, T t) noexcept safe {
+    unsafe { auto old = __rel_read(self->t_.get()); }
+    unsafe { __rel_write(self->t_.get(), rel t); }
+    return old;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// initializer_list.h
+
+template<class T+>
+class initializer_list/(a) {
+  // Point to byte data on the stack.
+  T* unsafe _cur;
+  T* _end;
+  T^/a __phantom_data;
+
+  explicit
+  initializer_list([T; dyn]^/a data) noexcept safe :
+    _cur((*data)~as_pointer),
+    unsafe _end((*data)~as_pointer + (*data)~length) { }
+
+public:
+  // compiler-provided
+  // must live in namespace std2
+
+  initializer_list() noexcept safe : _cur(nullptr), _end(nullptr) { }
+  initializer_list(const initializer_list&) = delete;
+  initializer_list& operator=(const initializer_list&) = delete;
+
+  ~initializer_list() safe requires(T~is_trivially_destructible) = default;
+
+  [[unsafe::drop_only(T)]]
+  ~initializer_list() safe requires(!T~is_trivially_destructible) {
+    std::destroy_n(_cur, _end - _cur);
+  }
+
+  [T; dyn]^ slice(self^) noexcept safe {
+    return slice_from_raw_parts(self->_cur, self->size());
+  }
+
+  const [T; dyn]^ slice(const self^) noexcept safe {
+    return slice_from_raw_parts(self->_cur, self->size());
+  }
+
+  optional<T> next(self^) noexcept safe {
+    if(self->_cur != self->_end)
+      return .some(__rel_read(self->_cur++));
+    else
+      return .none;
+  }
+
+  T* data(self^) noexcept safe {
+    return self->_cur;
+  }
+
+  const T* data(const self^) noexcept safe {
+    return self->_cur;
+  }
+
+  std::size_t size(const self^) noexcept safe {
+    return (std::size_t)(self->_end - self->_cur);
+  }
+
+  // Unsafe call to advance. Use this after relocating data out of
+  // data().
+  void advance(self^, std::size_t size) noexcept {
+    self->_cur += static_cast<std::ptrdiff_t>(size);
+  }
+};
+
+template<class T>
+impl initializer_list<T>: iterator
+{
+  using item_type = T;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+template<class T>
+impl initializer_list<T>: exact_size_iterator
+{
+  std::size_t len(self const^) safe override {
+    return self.size();
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// string.h
+
+template<class CharT>
+class basic_string;
+
+using string    = basic_string<char>;
+using wstring   = basic_string<wchar_t>;
+using u8string  = basic_string<char8_t>;
+using u16string = basic_string<char16_t>;
+using u32string = basic_string<char32_t>;
+
+template<class CharT>
+class [[unsafe::send, unsafe::sync]]
+  __attribute__((preferred_name(string)))
+  __attribute__((preferred_name(wstring)))
+  __attribute__((preferred_name(u8string)))
+  __attribute__((preferred_name(u16string)))
+  __attribute__((preferred_name(u32string)))
+basic_string
+{
+  public:
+
+  using value_type = CharT;
+  using size_type = std::size_t;
+
+  static_assert(value_type~is_trivially_destructible);
+
+  basic_string() safe
+    : p_(nullptr)
+    , size_{0}
+    , capacity_{0}
+  {
+  }
+
+  // Make expensive converting ctors explicit.
+  // The user should know they're doing a heap allocation.
+  explicit
+  basic_string(string_constant<value_type> sc) safe
+    : basic_string(basic_string_view<value_type>(sc))
+  {
+  }
+
+  explicit
+  basic_string(basic_string_view<value_type> sv) safe
+    : basic_string()
+  {
+    if (sv.empty()) return;
+
+    auto n = sv.size() * sizeof(value_type);
+    unsafe { p_ = static_cast<value_type*>(::operator new(n)); }
+    unsafe { std::memcpy(p_, sv.data(), n); }
+    size_ = sv.size();
+    capacity_ = sv.size();
+  }
+
+  explicit
+  basic_string(const [value_type; dyn]^ init) safe
+    : basic_string(basic_string_view<value_type>(init))
+  {
+  }
+
+  basic_string(basic_string const^ rhs) safe :
+    basic_string(rhs.str())
+  {
+  }
+
+  // Adopts a buffer from ::operator new holding size valid characters out
+  // of capacity.
+  static basic_string from_raw_parts(value_type* p, size_type size, size_type capacity) noexcept {
+    basic_string s{};
+    s.p_ = p;
+    s.size_ = size;
+    s.capacity_ = capacity;
+    return s;
+  }
+
+  ~basic_string() safe {
+    if (p_)
+      unsafe { operator delete(p_); }
+  }
+
+  const [value_type; dyn]^ slice(self const^) noexcept safe {
+    unsafe { return slice_from_raw_parts(self.data(), self.size()); }
+  }
+
+  basic_string_view<value_type> str(self const^) noexcept safe {
+    using no_utf_check = typename basic_string_view<value_type>::no_utf_check;
+    unsafe { return basic_string_view<value_type>(self.slice(), no_utf_check{}); }
+  }
+
+  operator basic_string_view<value_type>(self const^) noexcept safe {
+    return self.str();
+  }
+
+  value_type const* data(self const^) noexcept safe {
+    return self->p_;
+  }
+
+  size_type size(self const^) noexcept safe {
+    return self->size_;
+  }
+
+  size_type capacity(self const^) noexcept safe {
+    return self->capacity_;
+  }
+
+  void append(self^, basic_string_view<value_type> rhs) safe {
+    if (auto len = self.size() + rhs.size(); len > self.capacity()) {
+      unsafe { auto p = static_cast<value_type*>(::operator new(len * sizeof(value_type))); }
+      unsafe { std::memcpy(p, self.data(), self.size() * sizeof(value_type)); }
+      unsafe { ::operator delete(self->p_); }
+
+      self->p_ = p;
+      self->capacity_ = len;
+    }
+
+    unsafe { std::memcpy(self->p_ + self.size(), rhs.data(), rhs.size() * sizeof(value_type)); };
+    self->size_ += rhs.size();
+  }
+
+  basic_string operator+(self const^, basic_string_view<value_type> rhs) safe {
+    basic_string s = cpy self;
+    mut s.append(rhs);
+    drp self;
+    return rel s;
+  }
+
+  private:
+  value_type* unsafe p_;
+  size_type size_;
+  size_type capacity_;
+};
+
+namespace literals
+{
+namespace string_literals
+{
+
+inline
+auto operator""s2(char const* p, std::size_t len) noexcept safe -> string
+{
+  unsafe { return string(slice_from_raw_parts(p, len)); }
+}
+
+inline
+auto operator""s2(char8_t const* p, std::size_t len) noexcept safe -> u8string
+{
+  unsafe { return u8string(slice_from_raw_parts(p, len)); }
+}
+
+inline
+auto operator""s2(char16_t const* p, std::size_t len) noexcept safe -> u16string
+{
+  unsafe { return u16string(slice_from_raw_parts(p, len)); }
+}
+
+inline
+auto operator""s2(char32_t const* p, std::size_t len) noexcept safe -> u32string
+{
+  unsafe { return u32string(slice_from_raw_parts(p, len)); }
+}
+
+inline
+auto operator""s2(wchar_t const* p, std::size_t len) noexcept safe -> wstring
+{
+  unsafe { return wstring(slice_from_raw_parts(p, len)); }
+}
+
+} // namespace string_literals
+} // namespace literals
+
+////////////////////////////////////////////////////////////////////////////////
+// io.h
+
+inline void println(string_view sv) noexcept safe
+{
+  unsafe { printf("%.*s\n", sv.size(), sv.data()); }
+}
+
+inline void println(string_constant<char> sc) noexcept safe
+{
+  println(sc.text());
+}
+
+inline void println(const std::string^ s) noexcept safe {
+  unsafe { printf("%s\n", s->c_str()); }
+}
+
+inline void println(signed char x) noexcept safe
+{
+  unsafe { printf("%hhd\n", x); }
+}
+
+inline void println(short x) noexcept safe
+{
+  unsafe { printf("%hd\n", x); }
+}
+
+inline void println(int x) noexcept safe
+{
+  unsafe { printf("%d\n", x); }
+}
+
+inline void println(long int x) noexcept safe
+{
+  unsafe { printf("%ld\n", x); }
+}
+
+inline void println(long long int x) noexcept safe
+{
+  unsafe { printf("%lld\n", x); }
+}
+
+inline void println(unsigned char x) noexcept safe
+{
+  unsafe { printf("%hhu\n", x); }
+}
+
+inline void println(unsigned short x) noexcept safe
+{
+  unsafe { printf("%hu\n", x); }
+}
+
+inline void println(unsigned int x) noexcept safe
+{
+  unsafe { printf("%u\n", x); }
+}
+
+inline void println(long unsigned int x) noexcept safe
+{
+  unsafe { printf("%lu\n", x); }
+}
+
+inline void println(long long unsigned int x) noexcept safe
+{
+  unsafe { printf("%llu\n", x); }
+}
+
+inline void println(float x) noexcept safe {
+  unsafe { printf("%f\n", x); }
+}
+
+inline void println(double x) noexcept safe {
+  unsafe { printf("%f\n", x); }
+}
+
+inline void println(long double x) noexcept safe {
+  unsafe { printf("%Lf\n", x); }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// mutex.h
+
+template<class T+>
+class
+[[unsafe::send(T~is_send), unsafe::sync(T~is_send)]]
+mutex
+{
+  using mutex_type = unsafe_cell<std::mutex>;
+
+  unsafe_cell<T> data_;
+  box<mutex_type> mtx_;
+
+
+public:
+  class lock_guard/(a)
+  {
+    friend class mutex;
+
+    mutex const^/a m_;
+
+    lock_guard(mutex const^/a m) noexcept safe
+      : m_(m)
+    {
+    }
+
+    public:
+    ~lock_guard() safe {
+      unsafe { mut m_->mtx_->get()->unlock(); }
+    }
+
+    T const^ borrow(self const^) noexcept safe {
+      unsafe { return ^*self->m_->data_.get(); }
+    }
+
+    T^ borrow(self^) noexcept safe {
+      unsafe { return ^*self->m_->data_.get(); }
+    }
+
+    T^ operator*(self^) noexcept safe {
+      return self.borrow();
+    }
+
+    T const^ operator*(self const^) noexcept safe {
+      return self.borrow();
+    }
+  };
+
+  explicit mutex(T data) noexcept safe
+    : data_(rel data)
+    , unsafe mtx_(box<mutex_type>::make_default())
+  {
+  }
+
+  mutex(mutex const^) = delete;
+
+  lock_guard lock(self const^) safe {
+    unsafe { mut self->mtx_->get()->lock();}
+    return lock_guard(self);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// rc.h
+
+template<class T+>
+class [[unsafe::send(false)]] rc
+{
+  struct rc_inner;
+
+  rc_inner* unsafe p_;
+
+  struct rc_inner
+  {
+    manually_drop<T> data_;
+    std::size_t strong_;
+    std::size_t weak_;
+
+    explicit
+    rc_inner(T data) noexcept safe
+      : data_(rel data)
+      , strong_(1)
+      , weak_(1)
+    {
+    }
+  };
+
+  public:
+
+  explicit
+  rc(T t) safe
+    : p_(new(std::nothrow) rc_inner(rel t))
+  {
+  }
+
+  rc(rc const^ rhs) safe
+    : p_(rhs->p_)
+  {
+    ++p_->strong_;
+  }
+
+  [[unsafe::drop_only(T)]]
+  ~rc() safe
+  {
+    std::size_t s = --p_->strong_;
+    if (s == 0) {
+      unsafe { mut p_->data_.destroy(); }
+
+      std::size_t w = --p_->weak_;
+      if (w == 0) {
+        delete p_;
+      }
+    }
+  }
+
+  T const^ operator->(self const^) noexcept safe {
+    return *self->p_->data_.get();
+  }
+
+  T const^ operator*(self const^) noexcept safe {
+    return *self->p_->data_.get();
+  }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ref_cell.h
+
+template<class T+>
+class ref_cell
+{
+  unsafe_cell<T> t_;
+  cell<int> borrow_count_;
+
+  public:
+
+  class ref/(a)
+  {
+    friend class ref_cell;
+
+    T* value_;
+    cell<int> const^/a borrow_;
+
+    ref(T* value, cell<int> const^/a borrow) noexcept safe
+      : value_(value)
+      , borrow_(borrow)
+    {
+      borrow_.set(borrow_.get() + 1);
+    }
+
+    public:
+
+    ref(ref const^ rhs) safe
+      : ref(rhs.value_, rhs.borrow_)
+    {
+    }
+
+    ~ref() safe {
+      auto b = borrow_.get();
+      borrow_.set(b - 1);
+    }
+
+    T const^ operator*(self const^) noexcept safe {
+      unsafe { return *self->value_; }
+    }
+  };
+
+  class ref_mut/(a)
+  {
+    friend class ref_cell;
+
+    T* value_;
+    cell<int> const^/a borrow_;
+    // T^/a __phantom_data;
+
+    ref_mut(T* value, cell<int> const^/a borrow) noexcept safe
+      : value_(value)
+      , borrow_(borrow)
+    {
+      borrow_.set(borrow_.get() - 1);
+    }
+
+    public:
+
+    ~ref_mut() safe {
+      auto b = borrow_.get();
+      borrow_.set(b + 1);
+    }
+
+    T const^ operator*(self const^) noexcept safe {
+      unsafe { return *self->value_; }
+    }
+
+    T^ operator*(self^) noexcept safe {
+      unsafe { return ^*self->value_; }
+    }
+  };
+
+  explicit
+  ref_cell(T t) noexcept safe
+    : t_(rel t)
+    , borrow_count_{0}
+  {
+  }
+
+  ref_cell(ref_cell const^) = delete;
+
+  optional<ref> try_borrow(self const^) noexcept safe
+  {
+    auto b = self->borrow_count_.get();
+    if (b < 0) return .none;
+    return .some(ref{self->t_.get(), self->borrow_count_});
+  }
+
+  ref borrow(self const^) noexcept safe {
+    auto opt = self.try_borrow();
+    return match(rel opt) {
+      .some(b) => rel b;
+      .none => panic("ref_cell failed to acquire const borrow");
+    };
+  }
+
+  optional<ref_mut> try_borrow_mut(self const^) noexcept safe
+  {
+    auto b = self->borrow_count_.get();
+    if (b > 0) return .none;
+    if (b == -1) return .none;
+    return .some(ref_mut{self->t_.get(), self->borrow_count_});
+  }
+
+  ref_mut borrow_mut(self const^) noexcept safe {
+    auto opt = self.try_borrow_mut();
+    return match(rel opt) {
+      .some(b) => rel b;
+      .none => panic("ref_cell failed to acquire const borrow");
+    };
+  }
+
+  T^ get_mut(self^) noexcept safe {
+    unsafe { return ^*self->t_.get(); }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// shared_mutex.h
+
+// A reader-biased reader-writer lock.
+// Readers announce themselves on one of several cache-line sized shards
+// instead of a single shared counter, so concurrent lock_shared calls from
+// different threads don't contend on the same line. A writer revokes the
+// bias by raising writer_, then waits for every shard to drain. Readers that
+// observe a revoked bias back out and sleep until the writer is done, which
+// keeps writers from starving under a constant stream of readers.
+class reader_biased_rwlock
+{
+public:
+  static constexpr std::size_t num_shards = 32;
+
+  // Returns the shard the reader was counted on. It must be passed back to
+  // unlock_shared.
+  std::size_t lock_shared() noexcept {
+    std::size_t shard = this_thread_shard();
+    auto& count = readers_[shard].count_;
+
+    while (true) {
+      count.fetch_add(1, std::memory_order_seq_cst);
+      if (!writer_.load(std::memory_order_seq_cst)) return shard;
+
+      unlock_shared(shard);
+      writer_.wait(1, std::memory_order_acquire);
+    }
+  }
+
+  void unlock_shared(std::size_t shard) noexcept {
+    auto& count = readers_[shard].count_;
+    count.fetch_sub(1, std::memory_order_seq_cst);
+    if (writer_.load(std::memory_order_seq_cst)) count.notify_all();
+  }
+
+  void lock() noexcept {
+    writer_mtx_.lock();
+    writer_.store(1, std::memory_order_seq_cst);
+
+    for (auto& slot : readers_) {
+      std::uint32_t c;
+      while ((c = slot.count_.load(std::memory_order_seq_cst)) != 0) {
+        slot.count_.wait(c, std::memory_order_acquire);
+      }
+    }
+  }
+
+  void unlock() noexcept {
+    writer_.store(0, std::memory_order_release);
+    writer_.notify_all();
+    writer_mtx_.unlock();
+  }
+
+private:
+  static std::size_t this_thread_shard() noexcept {
+    static std::atomic<std::size_t> next{0};
+    thread_local std::size_t shard =
+      next.fetch_add(1, std::memory_order_relaxed) % num_shards;
+    return shard;
+  }
+
+  struct alignas(64) reader_slot
+  {
+    std::atomic<std::uint32_t> count_{0};
+  };
+
+  reader_slot readers_[num_shards];
+  alignas(64) std::atomic<std::uint32_t> writer_{0};
+  std::mutex writer_mtx_;
+};
+
+template<class T+>
+class
+[[unsafe::send(T~is_send), unsafe::sync(T~is_send)]]
+shared_mutex
+{
+  using mutex_type = unsafe_cell<reader_biased_rwlock>;
+
+  unsafe_cell<T> data_;
+  box<mutex_type> mtx_;
+
+public:
+  class lock_guard/(a)
+  {
+    friend class shared_mutex;
+
+    shared_mutex const^/a m_;
+
+    lock_guard(shared_mutex const^/a m) noexcept safe
+      : m_(m)
+    {
+    }
+
+    public:
+    ~lock_guard() safe {
+      unsafe { m_->mtx_->get()&->unlock(); }
+    }
+
+    T const^ borrow(self const^) noexcept safe {
+      unsafe { return ^*self->m_->data_.get(); }
+    }
+
+    T^ borrow(self^) noexcept safe {
+      unsafe { return ^*self->m_->data_.get(); }
+    }
+
+    T^ operator*(self^) noexcept safe {
+      return self.borrow();
+    }
+
+    T const^ operator*(self const^) noexcept safe {
+      return self.borrow();
+    }
+  };
+
+  class shared_lock_guard/(a)
+  {
+    friend class shared_mutex;
+
+    shared_mutex const^/a m_;
+    std::size_t shard_;
+
+    shared_lock_guard(shared_mutex const^/a m, std::size_t shard) noexcept safe
+      : m_(m)
+      , shard_(shard)
+    {
+    }
+
+    public:
+    ~shared_lock_guard() safe {
+      // TODO: it seems hard to get implementations to trigger tools like helgrind, drd
+      // here, even with assertions enabled in libstdc++
+      // this was mistakenly a call to `->unlock()` which is incorrect
+      // we need some method of verifying we get a failure here if we call the wrong thing
+      unsafe { m_->mtx_->get()&->unlock_shared(shard_); }
+    }
+
+    T const^ borrow(self const^) noexcept safe {
+      unsafe { return ^*self->m_->data_.get(); }
+    }
+
+    T const^ operator*(self const^) noexcept safe {
+      return self.borrow();
+    }
+  };
+
+  explicit shared_mutex(T data) noexcept safe
+    : data_(rel data)
+    , unsafe mtx_(box<mutex_type>::make_default())
+  {
+  }
+
+  shared_mutex(shared_mutex const^) = delete;
+
+  lock_guard lock(self const^) safe  {
+    unsafe { self->mtx_->get()&->lock(); }
+    return lock_guard(self);
+  }
+
+  shared_lock_guard lock_shared(self const^) safe {
+    unsafe { auto shard = self->mtx_->get()&->lock_shared(); }
+    return shared_lock_guard(self, shard);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// seqlock.h
+
+// A sequence lock for small, read-mostly, trivially copyable records.
+// Readers never write to shared memory: they load the sequence number, copy
+// the value out and load the sequence number again, retrying if a writer
+// was active in between. Writers are serialized by an internal mutex and
+// bump the sequence number to an odd value for the duration of the update.
+template<class T+>
+class
+[[unsafe::send(T~is_send), unsafe::sync(T~is_send)]]
+seqlock
+{
+  static_assert(T~is_trivially_copyable && T~is_trivially_destructible);
+
+  using mutex_type = unsafe_cell<std::mutex>;
+
+  unsafe_cell<T> data_;
+  unsafe_cell<std::atomic<std::size_t> unsafe> seq_;
+  box<mutex_type> mtx_;
+
+public:
+  class write_guard/(a)
+  {
+    friend class seqlock;
+
+    seqlock const^/a m_;
+    std::size_t seq_;
+
+    write_guard(seqlock const^/a m, std::size_t seq) noexcept safe
+      : m_(m)
+      , seq_(seq)
+    {
+    }
+
+    public:
+    ~write_guard() safe {
+      // Publishing the even sequence number with release semantics orders
+      // the writes to data_ before any reader that observes it.
+      unsafe { m_->seq_.get()&->store(seq_ + 2, std::memory_order_release); }
+      unsafe { mut m_->mtx_->get()->unlock(); }
+    }
+
+    T const^ borrow(self const^) noexcept safe {
+      unsafe { return ^*self->m_->data_.get(); }
+    }
+
+    T^ borrow(self^) noexcept safe {
+      unsafe { return ^*self->m_->data_.get(); }
+    }
+
+    T^ operator*(self^) noexcept safe {
+      return self.borrow();
+    }
+
+    T const^ operator*(self const^) noexcept safe {
+      return self.borrow();
+    }
+  };
+
+  explicit seqlock(T data) noexcept safe
+    : data_(rel data)
+    , seq_(0)
+    , unsafe mtx_(box<mutex_type>::make_default())
+  {
+  }
+
+  seqlock(seqlock const^) = delete;
+
+  T read(self const^) noexcept safe {
+    while (true) {
+      unsafe { auto s1 = self->seq_.get()&->load(std::memory_order_acquire); }
+      if (s1 & 1) {
+        unsafe { std::this_thread::yield(); }
+        continue;
+      }
+
+      // This copy may race with a writer. The value is discarded unless the
+      // sequence number is unchanged afterwards, and T is trivially copyable
+      // so a torn copy has no side effects.
+      unsafe { T t = cpy *self->data_.get(); }
+
+      unsafe { std::atomic_thread_fence(std::memory_order_acquire); }
+      unsafe { auto s2 = self->seq_.get()&->load(std::memory_order_relaxed); }
+      if (s1 == s2) return t;
+    }
+  }
+
+  write_guard lock(self const^) safe {
+    unsafe { mut self->mtx_->get()->lock(); }
+
+    unsafe { auto s = self->seq_.get()&->load(std::memory_order_relaxed); }
+    unsafe { self->seq_.get()&->store(s + 1, std::memory_order_relaxed); }
+    unsafe { std::atomic_thread_fence(std::memory_order_release); }
+
+    return write_guard(self, s);
+  }
+
+  template<class F>
+  void write(self const^, F f) safe
+  requires FnMut<F, void, T>
+  {
+    auto guard = self.lock();
+    T^ t = mut guard.borrow();
+    mut f(t);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// latch.h
+
+// The synchronization primitives below block on std::atomic<std::uint32_t>
+// wait/notify, which libstdc++ and libc++ lower directly to futex(2) on Linux
+// for 32-bit atomics.
+
+// A single-use downward counter. Threads block in wait() until the count
+// reaches zero.
+class
+[[unsafe::send, unsafe::sync]]
+latch
+{
+  unsafe_cell<std::atomic<std::uint32_t> unsafe> count_;
+
+public:
+  explicit latch(std::uint32_t expected) noexcept safe
+    : count_(expected)
+  {
+  }
+
+  latch(latch const^) = delete;
+
+  void count_down(self const^, std::uint32_t n = 1) safe {
+    // Check before storing, so waiters never see a wrapped count.
+    unsafe { auto prev = self->count_.get()&->load(std::memory_order_relaxed); }
+    while (true) {
+      if (prev < n) panic("latch counted down below zero");
+      unsafe {
+        bool stored = self->count_.get()&->compare_exchange_weak(
+          prev, prev - n, std::memory_order_acq_rel, std::memory_order_relaxed);
+      }
+      if (stored) break;
+    }
+
+    if (prev == n) {
+      unsafe { self->count_.get()&->notify_all(); }
+    }
+  }
+
+  bool try_wait(self const^) noexcept safe {
+    unsafe { return self->count_.get()&->load(std::memory_order_acquire) == 0; }
+  }
+
+  void wait(self const^) noexcept safe {
+    while (true) {
+      unsafe { auto c = self->count_.get()&->load(std::memory_order_acquire); }
+      if (c == 0) return;
+      unsafe { self->count_.get()&->wait(c, std::memory_order_acquire); }
+    }
+  }
+
+  void arrive_and_wait(self const^, std::uint32_t n = 1) safe {
+    self.count_down(n);
+    self.wait();
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// semaphore.h
+
+// A counting semaphore. acquire() hands out a permit guard that returns its
+// permit when dropped, so the number of live permits bounds concurrency.
+class
+[[unsafe::send, unsafe::sync]]
+semaphore
+{
+  unsafe_cell<std::atomic<std::uint32_t> unsafe> count_;
+
+  void release(self const^) noexcept safe {
+    unsafe { self->count_.get()&->fetch_add(1, std::memory_order_release); }
+    unsafe { self->count_.get()&->notify_one(); }
+  }
+
+public:
+  class permit/(a)
+  {
+    friend class semaphore;
+
+    semaphore const^/a sem_;
+
+    permit(semaphore const^/a sem) noexcept safe
+      : sem_(sem)
+    {
+    }
+
+    public:
+    ~permit() safe {
+      sem_.release();
+    }
+  };
+
+  explicit semaphore(std::uint32_t permits) noexcept safe
+    : count_(permits)
+  {
+  }
+
+  semaphore(semaphore const^) = delete;
+
+  permit acquire(self const^) noexcept safe {
+    while (true) {
+      unsafe { auto c = self->count_.get()&->load(std::memory_order_relaxed); }
+      if (c == 0) {
+        unsafe { self->count_.get()&->wait(0, std::memory_order_relaxed); }
+        continue;
+      }
+
+      unsafe {
+        bool acquired = self->count_.get()&->compare_exchange_weak(
+          c, c - 1, std::memory_order_acquire, std::memory_order_relaxed);
+      }
+      if (acquired) return permit(self);
+    }
+  }
+
+  optional<permit> try_acquire(self const^) noexcept safe {
+    unsafe { auto c = self->count_.get()&->load(std::memory_order_relaxed); }
+    while (c != 0) {
+      unsafe {
+        bool acquired = self->count_.get()&->compare_exchange_weak(
+          c, c - 1, std::memory_order_acquire, std::memory_order_relaxed);
+      }
+      if (acquired) return .some(permit(self));
+    }
+    return .none;
+  }
+
+  // Adds permits that are not tied to a guard.
+  void add_permits(self const^, std::uint32_t n) noexcept safe {
+    unsafe { self->count_.get()&->fetch_add(n, std::memory_order_release); }
+    unsafe { self->count_.get()&->notify_all(); }
+  }
+
+  std::uint32_t available(self const^) noexcept safe {
+    unsafe { return self->count_.get()&->load(std::memory_order_relaxed); }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// barrier.h
+
+struct noop_completion
+{
+  void operator()(self const^) noexcept safe {}
+};
+
+// A reusable barrier for phased algorithms. The last thread to arrive in a
+// phase runs the completion function before anyone is released, so the
+// completion function never runs concurrently with itself.
+template<class F+ = noop_completion>
+class
+[[unsafe::send(F~is_send), unsafe::sync(F~is_send)]]
+barrier
+{
+  unsafe_cell<F> completion_;
+  unsafe_cell<std::atomic<std::uint32_t> unsafe> remaining_;
+  unsafe_cell<std::atomic<std::uint32_t> unsafe> phase_;
+  std::uint32_t expected_;
+
+public:
+  explicit barrier(std::uint32_t expected) safe
+    requires(safe(F()))
+    : barrier(expected, F())
+  {
+  }
+
+  barrier(std::uint32_t expected, F f) safe
+    requires FnMut<F, void>
+    : completion_(rel f)
+    , remaining_(expected)
+    , phase_(0)
+    , expected_(expected)
+  {
+    if (expected == 0) panic("barrier expects at least one thread");
+  }
+
+  barrier(barrier const^) = delete;
+
+  void arrive_and_wait(self const^) safe {
+    unsafe { auto phase = self->phase_.get()&->load(std::memory_order_acquire); }
+    unsafe { auto prev = self->remaining_.get()&->fetch_sub(1, std::memory_order_acq_rel); }
+
+    if (prev == 1) {
+      // Every other participant is parked waiting for the phase to change,
+      // so this thread has exclusive access to the completion function.
+      unsafe { mut (*self->completion_.get())(); }
+
+      unsafe { self->remaining_.get()&->store(self->expected_, std::memory_order_relaxed); }
+      unsafe { self->phase_.get()&->store(phase + 1, std::memory_order_release); }
+      unsafe { self->phase_.get()&->notify_all(); }
+      return;
+    }
+
+    while (true) {
+      unsafe { self->phase_.get()&->wait(phase, std::memory_order_acquire); }
+      unsafe { auto p = self->phase_.get()&->load(std::memory_order_acquire); }
+      if (p != phase) return;
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// thread.h
+
+class thread
+{
+  std::thread unsafe t_;
+
+  template<class F, class ...Args>
+  static
+  void call((F, (Args...,))* p_tup) safe
+  {
+    unsafe { box<(F, (Args...,))> p = p_tup; }
+
+    auto tup = p rel.into_inner();
+    mut tup.0 rel.(rel tup.1.[:] ...);
+  }
+
+public:
+
+  thread() = delete;
+  thread(thread const^) safe = delete;
+
+  template<class F+, class ...Args+>
+  thread/(where F: static, Args...: static)(F f, Args... args) safe
+  requires(
+    F~is_send &&
+    (Args~is_send && ...) &&
+    safe(mut f(rel args...)))
+    : unsafe t_()
+  {
+    static_assert(!__is_lambda(F), "lambdas in std2::thread not yet supported by toolchain");
+    using tuple_type = (F, (Args...,));
+
+    box<tuple_type> p{(rel f, (rel args... ,))};
+    // TODO: have the thread constructor throw here somehow
+    // must catch the case where a clever stdlib dev thinks they can
+    // replace p.get() with `p rel.leak()` here, which causes a memory
+    // leak upon `std::thread::thread` throwing
+    unsafe { t_ = std::thread(&call<F, Args...>, p.get()); }
+    forget(rel p);
+  }
+
+  ~thread() safe {
+    mut t_.detach();
+  }
+
+  void join(self) safe {
+    mut self.t_.join();
+
+    // TODO: this line will someday be _required_ once ABI issues are worked out
+    // and dropping through a relocated function parameter works
+    forget(rel self);
+  }
+};
+
+namespace detail
+{
+
+template<class F>
+void join_call(F* f)
+{
+  mut (*f)();
+}
+
+template<class A, class B>
+void join_impl(A* a, B* b)
+{
+  std::thread t(&join_call<A>, a);
+
+  // a's borrows have to stay alive until its thread is done, even if b
+  // throws.
+  struct joiner
+  {
+    std::thread* t;
+    ~joiner() { t->join(); }
+  } j{ &t };
+
+  mut (*b)();
+}
+
+} // namespace detail
+
+// Runs a on a new thread and b on the calling thread, and returns once both
+// have finished. Unlike thread, the callables needn't be static: nothing
+// they borrow can go away before join returns, so a slice split with
+// split_at_mut can hand each half to one side.
+template<class A+, class B+>
+void join(A a, B b) safe
+requires(
+  A~is_send &&
+  safe(mut a()) &&
+  safe(mut b()))
+{
+  unsafe { detail::join_impl(addr a, addr b); }
+}
+
+// The number of threads that can run concurrently, and at least 1.
+inline std::size_t available_parallelism() noexcept safe
+{
+  unsafe { unsigned n = std::thread::hardware_concurrency(); }
+  return n ? n : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// par_sort.h
+
+// Parallel sorts. The slice, and the merge sort's scratch buffer, are
+// divided with split_at_mut and the halves go to join, so the borrow
+// checker sees that no two threads share an element. Every task gets its
+// own copy of the comparator. A comparator that throws on a worker thread
+// terminates the program.
+
+namespace detail
+{
+
+// Below this a range is sorted or merged on the current thread.
+inline constexpr std::size_t par_sort_grain = std::size_t(1) << 14;
+
+// Sequential stable merge of [a, a_end) and [b, b_end) into out, which
+// overlaps neither.
+template<class T, class F>
+void merge_into(T* a, T* a_end, T* b, T* b_end, T* out, F& less) noexcept
+{
+  while (a < a_end && b < b_end) {
+    if (sort_lt(less, static_cast<T const*>(b), static_cast<T const*>(a))) {
+      relocate_one(out++, b++);
+    } else {
+      relocate_one(out++, a++);
+    }
+  }
+  std::memcpy(static_cast<void*>(out), static_cast<void const*>(a), (a_end - a) * sizeof(T));
+  out += a_end - a;
+  std::memcpy(static_cast<void*>(out), static_cast<void const*>(b), (b_end - b) * sizeof(T));
+}
+
+template<class T, class F>
+void par_merge([T; dyn]^ a, [T; dyn]^ b, [T; dyn]^ out, F^ less, std::size_t threads) noexcept;
+
+template<class T, class F>
+struct [[unsafe::send(T~is_send && F~is_send)]] par_merge_task/(a)
+{
+  [T; dyn]^/a a;
+  [T; dyn]^/a b;
+  [T; dyn]^/a out;
+  F less;
+  std::size_t threads;
+
+  void operator()(self^) safe {
+    unsafe { par_merge(self->a, self->b, self->out, ^self->less, self->threads); }
+  }
+};
+
+// Stable merge of the runs a and b into out. The longer run is split at its
+// middle and the matching split in the other run is found by binary
+// search. Then the two pairs are merged into disjoint parts of out in
+// parallel.
+//
+// Elements are relocated: a and b are left moved-from and out's previous
+// contents are overwritten without being dropped. The caller must treat
+// them that way.
+template<class T, class F>
+void par_merge([T; dyn]^ a, [T; dyn]^ b, [T; dyn]^ out, F^ less, std::size_t threads) noexcept
+{
+  std::size_t const na = (*a)~length;
+  std::size_t const nb = (*b)~length;
+  if ((*out)~length != na + nb) panic("par_merge output must be as long as both runs");
+  if (threads < 2 || na + nb < par_sort_grain) {
+    T* pa = (*a)~as_pointer;
+    T* pb = (*b)~as_pointer;
+    merge_into(pa, pa + na, pb, pb + nb, (*out)~as_pointer, *less);
+    return;
+  }
+
+  std::size_t a_mid = 0;
+  std::size_t b_mid = 0;
+  if (na >= nb) {
+    a_mid = na / 2;
+
+    // Elements of b equal to a[a_mid] go after it.
+    std::size_t lo = 0;
+    std::size_t hi = nb;
+    while (lo < hi) {
+      std::size_t const m = lo + (hi - lo) / 2;
+      if (mut (*less)(^const (*b)[m], ^const (*a)[a_mid])) lo = m + 1;
+      else hi = m;
+    }
+    b_mid = lo;
+  } else {
+    b_mid = nb / 2;
+
+    // Elements of a equal to b[b_mid] go before it.
+    std::size_t lo = 0;
+    std::size_t hi = na;
+    while (lo < hi) {
+      std::size_t const m = lo + (hi - lo) / 2;
+      if (!mut (*less)(^const (*b)[b_mid], ^const (*a)[m])) lo = m + 1;
+      else hi = m;
+    }
+    a_mid = lo;
+  }
+
+  auto as = split_at_mut(a, a_mid);
+  auto bs = split_at_mut(b, b_mid);
+  auto outs = split_at_mut(out, a_mid + b_mid);
+  join(
+    par_merge_task<T, F>{ rel as.0, rel bs.0, rel outs.0, cpy *less, threads / 2 },
+    par_merge_task<T, F>{ rel as.1, rel bs.1, rel outs.1, cpy *less, threads - threads / 2 });
+}
+
+template<class T, class F>
+void par_sort_rec([T; dyn]^ s, [T; dyn]^ buf, F^ less, std::size_t threads);
+
+template<class T, class F>
+struct [[unsafe::send(T~is_send && F~is_send)]] par_sort_task/(a)
+{
+  [T; dyn]^/a s;
+  [T; dyn]^/a buf;
+  F less;
+  std::size_t threads;
+
+  void operator()(self^) safe {
+    unsafe { par_sort_rec(self->s, self->buf, ^self->less, self->threads); }
+  }
+};
+
+// Sorts the halves of s in parallel, each with its half of buf as scratch,
+// then moves s into buf and merges it back. buf is as long as s and holds
+// no live elements of its own: whatever is in it is overwritten without
+// being dropped.
+template<class T, class F>
+void par_sort_rec([T; dyn]^ s, [T; dyn]^ buf, F^ less, std::size_t threads)
+{
+  std::size_t const n = (*s)~length;
+  if ((*buf)~length != n) panic("par_sort scratch must be as long as the slice");
+  if (threads < 2 || n < par_sort_grain) {
+    sort_impl((*s)~as_pointer, n, *less);
+    return;
+  }
+
+  std::size_t const mid = n / 2;
+  {
+    auto halves = split_at_mut(^*s, mid);
+    auto scratch = split_at_mut(^*buf, mid);
+    join(
+      par_sort_task<T, F>{ rel halves.0, rel scratch.0, cpy *less, threads / 2 },
+      par_sort_task<T, F>{ rel halves.1, rel scratch.1, cpy *less, threads - threads / 2 });
+  }
+
+  std::memcpy(static_cast<void*>((*buf)~as_pointer), static_cast<void const*>((*s)~as_pointer), n * sizeof(T));
+  auto runs = split_at_mut(buf, mid);
+  par_merge(rel runs.0, rel runs.1, s, less, threads);
+}
+
+template<class T, class F>
+void par_sort_scratch([T; dyn]^ s, F^ less, std::size_t threads)
+{
+  std::size_t const n = (*s)~length;
+  scratch_buffer buf{ ::operator new(n * sizeof(T)) };
+  par_sort_rec(s, slice_from_raw_parts(static_cast<T*>(buf.p), n), less, threads);
+}
+
+template<class T, class F>
+void par_sort_unstable_rec([T; dyn]^ s, F^ less, std::size_t threads, std::size_t limit) safe;
+
+template<class T, class F>
+struct [[unsafe::send(T~is_send && F~is_send)]] par_sort_unstable_task/(a)
+{
+  [T; dyn]^/a s;
+  F less;
+  std::size_t threads;
+  std::size_t limit;
+
+  void operator()(self^) safe {
+    par_sort_unstable_rec(self->s, ^self->less, self->threads, self->limit);
+  }
+};
+
+// Quicksort whose two sides run in parallel, using pdqsort's pivot choice
+// and block partitioning. Runs equal to a minimal pivot are peeled off, and
+// a range whose partitions keep coming out unbalanced is finished on the
+// current thread, where pdqsort has its heapsort fallback.
+template<class T, class F>
+void par_sort_unstable_rec([T; dyn]^ s, F^ less, std::size_t threads, std::size_t limit) safe
+{
+  std::size_t const n = (*s)~length;
+  T* v = (*s)~as_pointer;
+  if (threads < 2 || n < par_sort_grain || limit == 0) {
+    unsafe { sort_unstable_impl(v, n, *less); }
+    return;
+  }
+
+  bool likely_sorted = false;
+  unsafe { std::size_t const pivot = choose_pivot(v, n, *less, addr likely_sorted); }
+  if (likely_sorted) {
+    unsafe { bool sorted = partial_insertion_sort(v, n, *less); }
+    if (sorted) return;
+  }
+
+  bool was_partitioned = false;
+  unsafe { std::size_t const mid = partition(v, n, pivot, *less, addr was_partitioned); }
+
+  if (mid == 0) {
+    // Nothing is less than the pivot, so it and its equals are in place.
+    // A short run of equals is as lopsided as any other partition and
+    // counts against limit, so this can't recurse once per element.
+    unsafe { std::size_t const equal = partition_equal(v, n, 0, *less); }
+    auto rest = split_at_mut(s, equal);
+    par_sort_unstable_rec(rel rest.1, less, threads, equal >= n / 8 ? limit : limit - 1);
+    return;
+  }
+
+  std::size_t const right_n = n - mid - 1;
+  bool const balanced = (mid < right_n ? mid : right_n) >= n / 8;
+  std::size_t const next_limit = balanced ? limit : limit - 1;
+
+  auto halves = split_at_mut(s, mid);
+  auto right = split_at_mut(rel halves.1, 1);
+  join(
+    par_sort_unstable_task<T, F>{ rel halves.0, cpy *less, threads / 2, next_limit },
+    par_sort_unstable_task<T, F>{ rel right.1, cpy *less, threads - threads / 2, next_limit });
+}
+
+} // namespace detail
+
+// Stable parallel merge sort on up to threads threads. Needs scratch space
+// the size of s. less must be copyable; each task sorts with its own copy.
+template<class T, class F+>
+void par_sort_by([T; dyn]^ s, F less, std::size_t threads) safe
+requires(T~is_send && F~is_send && std::is_copy_constructible_v<F>) && FnMut<F, bool, T const, T const>
+{
+  std::size_t const n = (*s)~length;
+  if (threads < 2 || n < detail::par_sort_grain) {
+    sort_by(s, rel less);
+    return;
+  }
+
+  unsafe { detail::par_sort_scratch(s, ^less, threads); }
+}
+
+template<class T, class F+>
+void par_sort_by([T; dyn]^ s, F less) safe
+requires(T~is_send && F~is_send && std::is_copy_constructible_v<F>) && FnMut<F, bool, T const, T const>
+{
+  par_sort_by(s, rel less, available_parallelism());
+}
+
+template<class T>
+void par_sort([T; dyn]^ s) safe
+requires(T~is_send)
+{
+  par_sort_by(s, default_less{}, available_parallelism());
+}
+
+template<class T, class K+>
+void par_sort_by_key([T; dyn]^ s, K key) safe
+requires(T~is_send && K~is_send && std::is_copy_constructible_v<K>) &&
+  FnMut<K, iter::call_result_t<K, T const^>, T const>
+{
+  par_sort_by(s, key_less<K>{ rel key }, available_parallelism());
+}
+
+// Parallel pdqsort on up to threads threads, in place and not stable.
+template<class T, class F+>
+void par_sort_unstable_by([T; dyn]^ s, F less, std::size_t threads) safe
+requires(T~is_send && F~is_send && std::is_copy_constructible_v<F>) && FnMut<F, bool, T const, T const>
+{
+  std::size_t limit = 0;
+  for (std::size_t k = (*s)~length; k > 0; k >>= 1) ++limit;
+  detail::par_sort_unstable_rec(s, ^less, threads, limit);
+}
+
+template<class T, class F+>
+void par_sort_unstable_by([T; dyn]^ s, F less) safe
+requires(T~is_send && F~is_send && std::is_copy_constructible_v<F>) && FnMut<F, bool, T const, T const>
+{
+  par_sort_unstable_by(s, rel less, available_parallelism());
+}
+
+template<class T>
+void par_sort_unstable([T; dyn]^ s) safe
+requires(T~is_send)
+{
+  par_sort_unstable_by(s, default_less{}, available_parallelism());
+}
+
+template<class T, class K+>
+void par_sort_unstable_by_key([T; dyn]^ s, K key) safe
+requires(T~is_send && K~is_send && std::is_copy_constructible_v<K>) &&
+  FnMut<K, iter::call_result_t<K, T const^>, T const>
+{
+  par_sort_unstable_by(s, key_less<K>{ rel key }, available_parallelism());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// vector.h
+
+
+template<class T+>
+class vector;
+
+template<class T+>
+class into_iterator
+{
+  using value_type = T;
+
+  friend class vector<T>;
+
+  value_type* unsafe origin_;
+  value_type* unsafe p_;
+  value_type* unsafe end_;
+
+
+  public:
+  into_iterator(value_type* p, value_type* end)
+    : origin_(p)
+    , p_(p)
+    , end_(end)
+  {
+  }
+
+  ~into_iterator() safe {
+    while (p_ < end_) {
+      unsafe { auto t = __rel_read(p_++); }
+      (void)t;
+    }
+    unsafe { ::operator delete(origin_); }
+  }
+
+  optional<value_type> next(self^) noexcept safe {
+    if (self->p_ < self->end_) {
+      unsafe { return .some(__rel_read(self->p_++)); }
+    } else {
+      return .none;
+    }
+  }
+
+  optional<value_type> next_back(self^) noexcept safe {
+    if (self->p_ < self->end_) {
+      unsafe { return .some(__rel_read(--self->end_)); }
+    } else {
+      return .none;
+    }
+  }
+
+  std::size_t len(self const^) noexcept safe {
+    return static_cast<std::size_t>(self->end_ - self->p_);
+  }
+
+  // Skips and drops up to n items, returning how many were skipped. The
+  // cursor moves in constant time; trivially destructible items cost
+  // nothing more.
+  std::size_t advance_by(self^, std::size_t n) noexcept safe {
+    std::size_t const k = n < self.len() ? n : self.len();
+    value_type* first = self->p_;
+    self->p_ += k;
+    if constexpr (!T~is_trivially_destructible) {
+      for (std::size_t i = 0; i < k; ++i) {
+        unsafe { auto t = __rel_read(first + i); }
+        (void)t;
+      }
+    }
+    return k;
+  }
+
+  optional<value_type> nth(self^, std::size_t n) noexcept safe {
+    if (self.advance_by(n) < n) return .none;
+    return self.next();
+  }
+
+  template<class B+, class F+>
+  B fold(self, B init, F f) safe {
+    B acc = rel init;
+    while (self.p_ < self.end_) {
+      unsafe { value_type x = __rel_read(self.p_++); }
+      acc = mut f(rel acc, rel x);
+    }
+    return acc;
+  }
+
+  template<class B+, class F+>
+  iter::call_result_t<F, B, value_type> try_fold(self^, B init, F f) safe {
+    B acc = rel init;
+    while (self->p_ < self->end_) {
+      unsafe { value_type x = __rel_read(self->p_++); }
+      iter::call_result_t<F, B, value_type> r = mut f(rel acc, rel x);
+      if (r.is_err()) return rel r;
+      acc = r rel.unwrap();
+    }
+    return .ok(rel acc);
+  }
+};
+
+// TODO: make vector conditionally Send/Sync
+template<class T+>
+class vector
+{
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+
+  vector() safe
+    : p_(nullptr)
+    , capacity_{0}
+    , size_{0}
+  {
+  }
+
+  vector(initializer_list<value_type> unsafe ilist) safe
+    : vector()
+  {
+    self^.reserve(ilist.size());
+    unsafe { relocate_array(mut self.data(), ilist.data(), ilist.size()); }
+    self.size_ = ilist.size();
+
+    ilist^.advance(ilist.size());
+  }
+
+  [[unsafe::drop_only(T)]]
+  ~vector() safe {
+    // TODO: std::destroy_n() doesn't seem to like `int^` as a value_type
+    // eventually we should fix this
+
+    unsafe {
+      auto const* end = self.data() + self.size();
+      auto* pos = self^.data();
+
+      while (pos < end) {
+        auto t = __rel_read(pos);
+        drp t;
+        ++pos;
+      }
+
+      ::operator delete(p_);
+    }
+  }
+
+  slice_iterator<const value_type> iter(const self^) noexcept safe {
+    return slice_iterator<const value_type>(self.slice());
+  }
+
+  slice_iterator<value_type> iter(self^) noexcept safe {
+    return slice_iterator<value_type>(self.slice());
+  }
+
+  value_type* data(self^) noexcept safe {
+    return self->p_;
+  }
+
+  const value_type* data(const self^) noexcept safe {
+    return self->p_;
+  }
+
+  size_type size(const self^) noexcept safe {
+    return self->size_;
+  }
+
+  size_type capacity(const self^) noexcept safe {
+    return self->capacity_;
+  }
+
+  bool empty(const self^) noexcept safe {
+    return self.size() == 0;
+  }
+
+  void push_back(self^, T t) safe {
+    if (self.capacity() == self.size()) { self.grow(); }
+
+    __rel_write(self->p_ + self->size_, rel t);
+    ++self->size_;
+  }
+
+  // Appends a copy of s with a single reservation.
+  void extend_from_slice(self^, const [T; dyn]^ s) safe
+  requires(T~is_trivially_copyable)
+  {
+    size_type const n = (*s)~length;
+    if (n == 0) return;
+
+    self.reserve_additional(n);
+    unsafe { std::memcpy(self->p_ + self->size_, (*s)~as_pointer, n * sizeof(value_type)); }
+    self->size_ += n;
+  }
+
+  // Appends every item of it. An exact-size iterator's length is reserved up
+  // front and that many items are written without capacity checks; an
+  // iterator that runs out sooner just ends that loop. Other iterators only
+  // offer a hint, which is used to reserve but never trusted, so their items
+  // go through push_back.
+  template<class I+>
+  void extend(self^, I it) safe
+  requires impl<I, iterator> && std::is_same_v<typename impl<I, iterator>::item_type, T>
+  {
+    if constexpr (impl<I, exact_size_iterator>) {
+      size_type const n = it.std2::exact_size_iterator::len();
+      self.reserve_additional(n);
+
+      for (size_type i = 0; i < n; ++i) {
+        optional<T> x = mut it.std2::iterator::next();
+        if (x.is_none()) return;
+        __rel_write(self->p_ + self->size_, x rel.unwrap());
+        ++self->size_;
+      }
+    } else {
+      self.reserve_additional(iter::size_hint(it).0);
+    }
+
+    while (true) {
+      optional<T> x = mut it.std2::iterator::next();
+      if (x.is_none()) return;
+      self.push_back(x rel.unwrap());
+    }
+  }
+
+  optional<T> pop_back(self^) noexcept safe {
+    if (self.empty()) return .none;
+
+    --self->size_;
+    unsafe { return .some(__rel_read(self->p_ + self->size_)); }
+  }
+
+  [value_type; dyn]^ slice(self^) noexcept safe {
+    unsafe { return slice_from_raw_parts(self.data(), self.size()); }
+  }
+
+  const [value_type; dyn]^ slice(const self^) noexcept safe {
+    unsafe { return slice_from_raw_parts(self.data(), self.size()); }
+  }
+
+  void sort(self^) safe {
+    std2::sort(self.slice());
+  }
+
+  template<class F+>
+  void sort_by(self^, F less) safe {
+    std2::sort_by(self.slice(), rel less);
+  }
+
+  template<class K+>
+  void sort_by_key(self^, K key) safe {
+    std2::sort_by_key(self.slice(), rel key);
+  }
+
+  void sort_unstable(self^) safe {
+    std2::sort_unstable(self.slice());
+  }
+
+  template<class F+>
+  void sort_unstable_by(self^, F less) safe {
+    std2::sort_unstable_by(self.slice(), rel less);
+  }
+
+  template<class K+>
+  void sort_unstable_by_key(self^, K key) safe {
+    std2::sort_unstable_by_key(self.slice(), rel key);
+  }
+
+  void par_sort(self^) safe {
+    std2::par_sort(self.slice());
+  }
+
+  void par_sort_unstable(self^) safe {
+    std2::par_sort_unstable(self.slice());
+  }
+
+  value_type^ operator[](self^, size_type i) noexcept safe {
+    if (i >= self.size()) panic_bounds("vector subscript is out-of-bounds");
+    unsafe { return ^self.data()[i]; }
+  }
+  value_type^ operator[](self^, size_type i, no_runtime_check) noexcept {
+    return ^self.data()[i];
+  }
+
+  const value_type^ operator[](const self^, size_type i) noexcept safe {
+    if (i >= self.size()) panic_bounds("vector subscript is out-of-bounds");
+    unsafe { return ^self.data()[i]; }
+  }
+  const value_type^ operator[](const self^, size_type i, no_runtime_check) noexcept {
+    return ^self.data()[i];
+  }
+
+  void reserve(self^, size_type n) safe {
+    if (n <= self.capacity()) return;
+    if (n > max_elements) panic("vector capacity overflow");
+
+    value_type* p;
+    unsafe {
+      p = static_cast<value_type*>(::operator new(n * sizeof(value_type)));
+      relocate_array(p, self.data(), self.size());
+      ::operator delete(self->p_);
+    }
+
+    self->p_ = p;
+    self->capacity_ = n;
+  }
+
+  // Sets the length without constructing or dropping anything. The first n
+  // elements must be initialized and n must not exceed capacity().
+  void set_len(self^, size_type n) noexcept {
+    self->size_ = n;
+  }
+
+  // Gives up the buffer without dropping the elements, as (pointer, size,
+  // capacity). Free the pointer with ::operator delete.
+  (value_type*, size_type, size_type) into_raw_parts(self) noexcept safe {
+    auto parts = (self^.data(), self.size(), self.capacity());
+    forget(rel self);
+    return parts;
+  }
+
+private:
+
+  static
+  void relocate_array(value_type* dst, value_type const* src, size_type n) {
+    // TODO: we should add a relocation check here
+    // this code likely isn't sound for types with non-trivial/non-defaulted
+    // relocation operators
+    std::memcpy(dst, src, n * sizeof(value_type));
+  }
+
+  void grow(self^) safe {
+    self.reserve_additional(1);
+  }
+
+  // Makes room for n more elements, at least doubling the capacity when it
+  // has to grow so repeated appends stay amortized.
+  void reserve_additional(self^, size_type n) safe {
+    size_type const len = self.size();
+    size_type const cap = self.capacity();
+    if (n <= cap - len) return;
+    if (n > max_elements - len) panic("vector capacity overflow");
+
+    size_type ncap = cap > max_elements / 2 ? max_elements : 2 * cap;
+    self.reserve(ncap > len + n ? ncap : len + n);
+  }
+
+  static constexpr size_type max_elements = size_type(-1) / sizeof(value_type);
+
+  value_type* unsafe  p_;
+  size_type capacity_;
+  size_type size_;
+  // value_type __phantom_data;
+};
+
+template<class T>
+impl into_iterator<T>: iterator
+{
+  using item_type = T;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+template<class T>
+impl into_iterator<T>: double_ended_iterator
+{
+  using item_type = T;
+
+  optional<item_type> next_back(self^) safe override {
+    return self.next_back();
+  }
+};
+
+template<class T>
+impl into_iterator<T>: exact_size_iterator
+{
+  std::size_t len(self const^) safe override {
+    return self.len();
+  }
+};
+
+template<class T>
+impl vector<T>: make_iter {
+  using iter_type = slice_iterator<T const>;
+  using iter_mut_type = slice_iterator<T>;
+  using into_iter_type  = into_iterator<T>;
+
+  iter_type iter(self const^) noexcept safe override {
+    return slice_iterator<const T>(self.slice());
+  }
+
+  iter_mut_type iter(self^) noexcept safe override {
+    return slice_iterator<T>(self.slice());
+  }
+
+  into_iter_type iter(self) noexcept safe override {
+    auto p = self^.data();
+    auto len = self.size();
+    forget(rel self);
+    unsafe { return into_iter_type(p, p + len); }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// eytzinger.h
+
+namespace detail
+{
+
+// Writes sorted into tree in Eytzinger order: an in-order walk of the
+// implicit tree rooted at k = 1, whose children are 2k and 2k + 1.
+template<class T>
+void eytzinger_fill(T* tree, T const* sorted, std::size_t n, std::size_t^ i, std::size_t k) noexcept
+{
+  if (k > n) return;
+  eytzinger_fill(tree, sorted, n, i, 2 * k);
+  tree[k - 1] = sorted[(*i)++];
+  eytzinger_fill(tree, sorted, n, i, 2 * k + 1);
+}
+
+} // namespace detail
+
+// A sorted set of keys stored in breadth-first (Eytzinger) order. The first
+// levels of the search share a few cache lines, and the next levels are
+// prefetched while the current one is compared, so lookups in large static
+// arrays miss cache far less than binary search over sorted order does.
+template<class T>
+class eytzinger
+{
+  vector<T> tree_;
+
+public:
+  // sorted must be in ascending order.
+  explicit eytzinger(const [T; dyn]^ sorted) safe
+  requires(T~is_trivially_copyable)
+    : tree_()
+  {
+    mut tree_.extend_from_slice(sorted);
+
+    std::size_t i = 0;
+    unsafe { detail::eytzinger_fill(mut tree_.data(), (*sorted)~as_pointer, (*sorted)~length, ^i, 1); }
+  }
+
+  std::size_t size(self const^) noexcept safe {
+    return self->tree_.size();
+  }
+
+  // The smallest key not less than x.
+  optional<T> lower_bound(self const^, const T^ x) noexcept safe {
+    std::size_t const n = self->tree_.size();
+    T const* tree = self->tree_.data();
+
+    // Sixteen nodes down is four levels, a cache line ahead for 4-byte keys.
+    std::size_t k = 1;
+    while (k <= n) {
+      unsafe { __builtin_prefetch(tree + (16 * k - 1 < n ? 16 * k - 1 : 0)); }
+      unsafe { k = 2 * k + (tree[k - 1] < *x); }
+    }
+
+    // Going right means the node was less than x. Strip those trailing
+    // right turns, plus the left turn before them, to reach the answer.
+    k >>= __builtin_ffsll(static_cast<long long>(~k));
+    if (k == 0) return .none;
+    unsafe { return .some(tree[k - 1]); }
+  }
+
+  bool contains(self const^, const T^ x) noexcept safe {
+    optional<T> y = self.lower_bound(x);
+    return match(y) -> bool {
+      .some(v) => !(*x < v);
+      .none    => false;
+    };
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// bitset.h
+
+namespace detail
+{
+
+inline constexpr std::size_t bit_words(std::size_t nbits) noexcept safe
+{
+  return (nbits + 63) / 64;
+}
+
+// The low n bits set, for 0 < n < 64.
+inline constexpr std::uint64_t low_bits(std::size_t n) noexcept safe
+{
+  return (std::uint64_t(1) << n) - 1;
+}
+
+// Four accumulators keep the popcnt units busy instead of serializing on a
+// single add chain. With AVX-512 VPOPCNTDQ the compiler turns the loop into
+// vpopcntq.
+inline std::size_t popcount_words(const [std::uint64_t; dyn]^ ws) noexcept safe
+{
+  std::uint64_t const* p = (*ws)~as_pointer;
+  std::size_t const n = (*ws)~length;
+
+  std::size_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+  std::size_t i = 0;
+  unsafe {
+    for (; i + 4 <= n; i += 4) {
+      c0 += static_cast<std::size_t>(__builtin_popcountll(p[i]));
+      c1 += static_cast<std::size_t>(__builtin_popcountll(p[i + 1]));
+      c2 += static_cast<std::size_t>(__builtin_popcountll(p[i + 2]));
+      c3 += static_cast<std::size_t>(__builtin_popcountll(p[i + 3]));
+    }
+    for (; i < n; ++i) {
+      c0 += static_cast<std::size_t>(__builtin_popcountll(p[i]));
+    }
+  }
+  return c0 + c1 + c2 + c3;
+}
+
+// Position of the k-th set bit of w, counting from zero. k must be less than
+// popcount(w).
+inline std::size_t select_in_word(std::uint64_t w, std::size_t k) noexcept safe
+{
+#if defined(__BMI2__)
+  unsafe { return static_cast<std::size_t>(__builtin_ctzll(_pdep_u64(std::uint64_t(1) << k, w))); }
+#else
+  for (; k > 0; --k) w &= w - 1;
+  return static_cast<std::size_t>(__builtin_ctzll(w));
+#endif
+}
+
+} // namespace detail
+
+// Yields the index of every set bit in ascending order. Whole zero words
+// are skipped, and each set bit costs one tzcnt.
+class ones_iterator/(a)
+{
+  const [std::uint64_t; dyn]^/a words_;
+  std::size_t w_;
+  std::uint64_t cur_;
+
+public:
+  explicit ones_iterator(const [std::uint64_t; dyn]^/a words) noexcept safe
+    : words_(words), w_(0), cur_((*words)~length ? (*words)[0] : 0)
+  {
+  }
+
+  optional<std::size_t> next(self^) noexcept safe {
+    std::size_t const n = (*self->words_)~length;
+    while (self->cur_ == 0) {
+      if (self->w_ + 1 >= n) {
+        self->w_ = n;
+        return .none;
+      }
+      self->cur_ = (*self->words_)[++self->w_];
+    }
+
+    std::size_t const bit = static_cast<std::size_t>(__builtin_ctzll(self->cur_));
+    self->cur_ &= self->cur_ - 1;
+    return .some(self->w_ * 64 + bit);
+  }
+};
+
+impl ones_iterator: iterator
+{
+  using item_type = std::size_t;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+// A growable sequence of bits packed 64 to a word. Bits past size() in the
+// last word are always zero, so the word-wide operations never need to mask
+// them.
+class bitvec
+{
+  vector<std::uint64_t> words_;
+  std::size_t len_;
+
+  void clear_tail(self^) noexcept safe {
+    std::size_t const r = self->len_ % 64;
+    if (r) (^self->words_)[self->words_.size() - 1] &= detail::low_bits(r);
+  }
+
+  void check_same_size(self const^, bitvec const^ rhs) noexcept safe {
+    if (self->len_ != rhs->len_) panic("bitvec operands differ in size");
+  }
+
+public:
+  bitvec() safe
+    : words_(), len_(0)
+  {
+  }
+
+  // n bits, each set to value.
+  bitvec(std::size_t n, bool value) safe
+    : words_(), len_(n)
+  {
+    std::size_t const nw = detail::bit_words(n);
+    std::uint64_t const word = value ? ~std::uint64_t(0) : 0;
+    mut words_.reserve(nw);
+    for (std::size_t i = 0; i < nw; ++i) {
+      bool const partial = i + 1 == nw && n % 64;
+      mut words_.push_back(partial ? word & detail::low_bits(n % 64) : word);
+    }
+  }
+
+  std::size_t size(self const^) noexcept safe {
+    return self->len_;
+  }
+
+  bool empty(self const^) noexcept safe {
+    return self->len_ == 0;
+  }
+
+  // The packed words, least significant bit first.
+  const [std::uint64_t; dyn]^ words(self const^) noexcept safe {
+    return self->words_.slice();
+  }
+
+  void push_back(self^, bool value) safe {
+    std::size_t const i = self->len_;
+    if (i % 64 == 0) mut self->words_.push_back(0);
+    if (value) (^self->words_)[i / 64] |= std::uint64_t(1) << (i % 64);
+    ++self->len_;
+  }
+
+  optional<bool> pop_back(self^) noexcept safe {
+    if (self->len_ == 0) return .none;
+
+    bool const value = self.test(self->len_ - 1);
+    --self->len_;
+    if (self->len_ % 64 == 0) mut self->words_.pop_back();
+    else mut self.clear_tail();
+    return .some(value);
+  }
+
+  void resize(self^, std::size_t n, bool value = false) safe {
+    std::size_t const nw = detail::bit_words(n);
+    if (n <= self->len_) {
+      while (self->words_.size() > nw) mut self->words_.pop_back();
+      self->len_ = n;
+      mut self.clear_tail();
+      return;
+    }
+
+    std::uint64_t const word = value ? ~std::uint64_t(0) : 0;
+    std::size_t const r = self->len_ % 64;
+    if (r && value) (^self->words_)[self->words_.size() - 1] |= ~detail::low_bits(r);
+    mut self->words_.reserve(nw);
+    while (self->words_.size() < nw) mut self->words_.push_back(word);
+    self->len_ = n;
+    mut self.clear_tail();
+  }
+
+  bool test(self const^, std::size_t i) noexcept safe {
+    if (i >= self->len_) panic_bounds("bitvec index is out-of-bounds");
+    return (self->words_[i / 64] >> (i % 64)) & 1;
+  }
+
+  void set(self^, std::size_t i, bool value = true) noexcept safe {
+    if (i >= self->len_) panic_bounds("bitvec index is out-of-bounds");
+    std::uint64_t const m = std::uint64_t(1) << (i % 64);
+    if (value) (^self->words_)[i / 64] |= m;
+    else (^self->words_)[i / 64] &= ~m;
+  }
+
+  void reset(self^, std::size_t i) noexcept safe {
+    mut self.set(i, false);
+  }
+
+  void flip(self^, std::size_t i) noexcept safe {
+    if (i >= self->len_) panic_bounds("bitvec index is out-of-bounds");
+    (^self->words_)[i / 64] ^= std::uint64_t(1) << (i % 64);
+  }
+
+  // Complements every bit in place.
+  void flip_all(self^) noexcept safe {
+    for (std::uint64_t^ w : mut self->words_.iter()) *w = ~*w;
+    mut self.clear_tail();
+  }
+
+  void fill(self^, bool value) noexcept safe {
+    std::uint64_t const word = value ? ~std::uint64_t(0) : 0;
+    for (std::uint64_t^ w : mut self->words_.iter()) *w = word;
+    mut self.clear_tail();
+  }
+
+  std::size_t count_ones(self const^) noexcept safe {
+    return detail::popcount_words(self->words_.slice());
+  }
+
+  std::size_t count_zeros(self const^) noexcept safe {
+    return self->len_ - self.count_ones();
+  }
+
+  bool any(self const^) noexcept safe {
+    for (std::uint64_t w : self->words_.iter()) {
+      if (w) return true;
+    }
+    return false;
+  }
+
+  bool none(self const^) noexcept safe {
+    return !self.any();
+  }
+
+  bool all(self const^) noexcept safe {
+    return self.count_ones() == self->len_;
+  }
+
+  ones_iterator iter_ones(self const^) noexcept safe {
+    return ones_iterator(self->words_.slice());
+  }
+
+  // Word-parallel and, or and xor. Both operands must be the same size.
+  void operator&=(self^, bitvec const^ rhs) noexcept safe {
+    self.check_same_size(rhs);
+    [std::uint64_t; dyn]^ ws = mut self->words_.slice();
+    for (std::size_t i = 0; i < (*ws)~length; ++i) (*ws)[i] &= rhs->words_[i];
+  }
+
+  void operator|=(self^, bitvec const^ rhs) noexcept safe {
+    self.check_same_size(rhs);
+    [std::uint64_t; dyn]^ ws = mut self->words_.slice();
+    for (std::size_t i = 0; i < (*ws)~length; ++i) (*ws)[i] |= rhs->words_[i];
+  }
+
+  void operator^=(self^, bitvec const^ rhs) noexcept safe {
+    self.check_same_size(rhs);
+    [std::uint64_t; dyn]^ ws = mut self->words_.slice();
+    for (std::size_t i = 0; i < (*ws)~length; ++i) (*ws)[i] ^= rhs->words_[i];
+  }
+
+  bool operator==(self const^, bitvec const^ rhs) noexcept safe {
+    if (self->len_ != rhs->len_) return false;
+    for (std::size_t i = 0; i < self->words_.size(); ++i) {
+      if (self->words_[i] != rhs->words_[i]) return false;
+    }
+    return true;
+  }
+};
+
+// N bits stored inline. Like bitvec, the unused high bits of the last word
+// stay zero.
+template<std::size_t N>
+class bitset
+{
+  static constexpr std::size_t num_words = detail::bit_words(N);
+
+  std::uint64_t words_[num_words ? num_words : 1];
+
+  void clear_tail(self^) noexcept safe {
+    if constexpr (N % 64 != 0) self->words_[num_words - 1] &= detail::low_bits(N % 64);
+  }
+
+public:
+  bitset() noexcept safe
+    : words_{}
+  {
+  }
+
+  static constexpr std::size_t size() noexcept safe {
+    return N;
+  }
+
+  const [std::uint64_t; dyn]^ words(self const^) noexcept safe {
+    unsafe { return slice_from_raw_parts(self->words_, num_words); }
+  }
+
+  bool test(self const^, std::size_t i) noexcept safe {
+    if (i >= N) panic_bounds("bitset index is out-of-bounds");
+    return (self->words_[i / 64] >> (i % 64)) & 1;
+  }
+
+  void set(self^, std::size_t i, bool value = true) noexcept safe {
+    if (i >= N) panic_bounds("bitset index is out-of-bounds");
+    std::uint64_t const m = std::uint64_t(1) << (i % 64);
+    if (value) self->words_[i / 64] |= m;
+    else self->words_[i / 64] &= ~m;
+  }
+
+  void reset(self^, std::size_t i) noexcept safe {
+    mut self.set(i, false);
+  }
+
+  void flip(self^, std::size_t i) noexcept safe {
+    if (i >= N) panic_bounds("bitset index is out-of-bounds");
+    self->words_[i / 64] ^= std::uint64_t(1) << (i % 64);
+  }
+
+  void flip_all(self^) noexcept safe {
+    for (std::size_t i = 0; i < num_words; ++i) self->words_[i] = ~self->words_[i];
+    mut self.clear_tail();
+  }
+
+  void fill(self^, bool value) noexcept safe {
+    std::uint64_t const word = value ? ~std::uint64_t(0) : 0;
+    for (std::size_t i = 0; i < num_words; ++i) self->words_[i] = word;
+    mut self.clear_tail();
+  }
+
+  std::size_t count_ones(self const^) noexcept safe {
+    return detail::popcount_words(self.words());
+  }
+
+  std::size_t count_zeros(self const^) noexcept safe {
+    return N - self.count_ones();
+  }
+
+  bool any(self const^) noexcept safe {
+    for (std::size_t i = 0; i < num_words; ++i) {
+      if (self->words_[i]) return true;
+    }
+    return false;
+  }
+
+  bool none(self const^) noexcept safe {
+    return !self.any();
+  }
+
+  bool all(self const^) noexcept safe {
+    return self.count_ones() == N;
+  }
+
+  ones_iterator iter_ones(self const^) noexcept safe {
+    return ones_iterator(self.words());
+  }
+
+  void operator&=(self^, bitset const^ rhs) noexcept safe {
+    for (std::size_t i = 0; i < num_words; ++i) self->words_[i] &= rhs->words_[i];
+  }
+
+  void operator|=(self^, bitset const^ rhs) noexcept safe {
+    for (std::size_t i = 0; i < num_words; ++i) self->words_[i] |= rhs->words_[i];
+  }
+
+  void operator^=(self^, bitset const^ rhs) noexcept safe {
+    for (std::size_t i = 0; i < num_words; ++i) self->words_[i] ^= rhs->words_[i];
+  }
+
+  bitset operator&(self const^, bitset const^ rhs) noexcept safe {
+    bitset r = cpy *self;
+    mut r &= rhs;
+    return r;
+  }
+
+  bitset operator|(self const^, bitset const^ rhs) noexcept safe {
+    bitset r = cpy *self;
+    mut r |= rhs;
+    return r;
+  }
+
+  bitset operator^(self const^, bitset const^ rhs) noexcept safe {
+    bitset r = cpy *self;
+    mut r ^= rhs;
+    return r;
+  }
+
+  bitset operator~(self const^) noexcept safe {
+    bitset r = cpy *self;
+    mut r.flip_all();
+    return r;
+  }
+
+  bool operator==(self const^, bitset const^ rhs) noexcept safe {
+    for (std::size_t i = 0; i < num_words; ++i) {
+      if (self->words_[i] != rhs->words_[i]) return false;
+    }
+    return true;
+  }
+};
+
+// A read-only bitvec with rank and select in constant and logarithmic time.
+// The directory holds the number of ones before each 512-bit superblock,
+// 12.5% on top of the bits themselves. A rank reads one directory entry and
+// popcounts at most eight words; a select binary-searches the directory and
+// then scans at most eight words.
+class rank_select
+{
+  static constexpr std::size_t words_per_block = 8;
+
+  bitvec bits_;
+  vector<std::uint64_t> blocks_;
+
+public:
+  explicit rank_select(bitvec bits) safe
+    : bits_(rel bits), blocks_()
+  {
+    const [std::uint64_t; dyn]^ ws = bits_.words();
+    std::size_t const nw = (*ws)~length;
+
+    mut blocks_.reserve(nw / words_per_block + 2);
+    std::uint64_t ones = 0;
+    for (std::size_t w = 0; w < nw; ++w) {
+      if (w % words_per_block == 0) mut blocks_.push_back(ones);
+      ones += static_cast<std::uint64_t>(__builtin_popcountll((*ws)[w]));
+    }
+    mut blocks_.push_back(ones);
+  }
+
+  bitvec const^ bits(self const^) noexcept safe {
+    return ^self->bits_;
+  }
+
+  std::size_t size(self const^) noexcept safe {
+    return self->bits_.size();
+  }
+
+  std::size_t count_ones(self const^) noexcept safe {
+    return static_cast<std::size_t>(self->blocks_[self->blocks_.size() - 1]);
+  }
+
+  bool test(self const^, std::size_t i) noexcept safe {
+    return self->bits_.test(i);
+  }
+
+  // The number of set bits in [0, i).
+  std::size_t rank1(self const^, std::size_t i) noexcept safe {
+    if (i > self->bits_.size()) panic_bounds("rank index is out-of-bounds");
+
+    const [std::uint64_t; dyn]^ ws = self->bits_.words();
+    std::size_t const w = i / 64;
+    std::size_t const first = w / words_per_block * words_per_block;
+
+    std::size_t r = static_cast<std::size_t>(self->blocks_[w / words_per_block]);
+    for (std::size_t j = first; j < w; ++j) {
+      r += static_cast<std::size_t>(__builtin_popcountll((*ws)[j]));
+    }
+    if (i % 64) {
+      r += static_cast<std::size_t>(__builtin_popcountll((*ws)[w] & detail::low_bits(i % 64)));
+    }
+    return r;
+  }
+
+  // The number of clear bits in [0, i).
+  std::size_t rank0(self const^, std::size_t i) noexcept safe {
+    return i - self.rank1(i);
+  }
+
+  // The position of the k-th set bit, counting from zero, or none when
+  // there are k or fewer.
+  optional<std::size_t> select1(self const^, std::size_t k) noexcept safe {
+    if (k >= self.count_ones()) return .none;
+
+    // The last block whose running count is at most k holds the answer. The
+    // final entry is the total, which exceeds k, so that block always has
+    // words to scan.
+    const [std::uint64_t; dyn]^ blocks = self->blocks_.slice();
+    std::uint64_t const key = k;
+    std::size_t const b = upper_bound(blocks, ^key) - 1;
+
+    const [std::uint64_t; dyn]^ ws = self->bits_.words();
+    std::size_t left = k - static_cast<std::size_t>((*blocks)[b]);
+    for (std::size_t w = b * words_per_block; ; ++w) {
+      std::uint64_t const word = (*ws)[w];
+      std::size_t const c = static_cast<std::size_t>(__builtin_popcountll(word));
+      if (left < c) return .some(w * 64 + detail::select_in_word(word, left));
+      left -= c;
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// soa_vector.h
+
+namespace detail
+{
+
+template<class T, auto M>
+using soa_field_t = std::remove_reference_t<decltype(std::declval<T&>().*M)>;
+
+template<class M, class P>
+constexpr bool same_member(M m, P p) noexcept
+{
+  if constexpr (std::is_same_v<M, P>) return m == p;
+  else return false;
+}
+
+// The declaration-order index of the data member M, found by comparing it
+// against every member pointer of T.
+template<class T, auto M>
+constexpr std::size_t soa_index() noexcept
+{
+  constexpr bool hits[] { same_member(M, T~member_ptrs)... };
+  for (std::size_t i = 0; i < sizeof(hits); ++i) {
+    if (hits[i]) return i;
+  }
+  return sizeof(hits);
+}
+
+template<class T, auto... Ms>
+constexpr bool soa_distinct() noexcept
+{
+  constexpr std::size_t idx[] { soa_index<T, Ms>()... };
+  for (std::size_t i = 0; i < sizeof...(Ms); ++i) {
+    for (std::size_t j = i + 1; j < sizeof...(Ms); ++j) {
+      if (idx[i] == idx[j]) return false;
+    }
+  }
+  return true;
+}
+
+} // namespace detail
+
+template<class T>
+class soa_vector;
+
+// One row of a soa_vector, seen through a borrow of the whole container.
+// soa_row<const T> reads fields; soa_row<T> can also write them.
+template<class T>
+class soa_row/(a)
+{
+  using value_type = std::remove_const_t<T>;
+  using vector_type = std::conditional_t<std::is_const_v<T>,
+    const soa_vector<value_type>, soa_vector<value_type>>;
+
+  vector_type^/a v_;
+  std::size_t i_;
+
+public:
+  soa_row(vector_type^/a v, std::size_t i) noexcept safe
+    : v_(v), i_(i)
+  {
+  }
+
+  std::size_t index(self const^) noexcept safe {
+    return self->i_;
+  }
+
+  template<auto M>
+  const detail::soa_field_t<value_type, M>^ get(self const^) noexcept safe {
+    return ^(*self->v_->template column<M>())[self->i_];
+  }
+
+  template<auto M>
+  detail::soa_field_t<value_type, M>^ get(self^) noexcept safe
+  requires(!std::is_const_v<T>)
+  {
+    return ^(*mut self->v_->template column<M>())[self->i_];
+  }
+
+  // Gathers the fields back into a T.
+  value_type load(self const^) safe {
+    return self->v_->get(self->i_);
+  }
+};
+
+// A vector of T stored as one column per data member of T, generated from
+// T's member list. Loops that touch a few fields stream through just those
+// columns instead of dragging every field of each element through cache.
+// Elements go in and come out whole; in between, fields are reached through
+// column slices or row proxies.
+template<class T>
+class soa_vector
+{
+  static_assert(std::is_class_v<T> && std::is_aggregate_v<T>,
+    "soa_vector needs an aggregate class type");
+  static_assert(T~member_count > 0, "soa_vector needs at least one data member");
+
+  // One column per data member, in declaration order. Every column holds
+  // len_ elements.
+  vector<T~member_types> ...columns_;
+  std::size_t len_;
+
+public:
+  static constexpr std::size_t num_columns = T~member_count;
+
+  soa_vector() safe
+    : columns_()..., len_(0)
+  {
+  }
+
+  std::size_t size(self const^) noexcept safe {
+    return self->len_;
+  }
+
+  bool empty(self const^) noexcept safe {
+    return self->len_ == 0;
+  }
+
+  void reserve(self^, std::size_t n) safe {
+    (mut self->columns_.reserve(n), ...);
+  }
+
+  // Scatters t's fields across the columns. Every column makes room for the
+  // new element before any is written, so a failed allocation can't leave
+  // the columns with different lengths. Capacity doubles, as in vector, to
+  // keep repeated pushes amortized.
+  void push_back(self^, T t) safe {
+    std::size_t const len = self->len_;
+    std::size_t const grown = len > 0 ? 2 * len : 1;
+    ((self->columns_.capacity() > len ? void() : mut self->columns_.reserve(grown)), ...);
+
+    (mut self->columns_.push_back(rel t~member_values), ...);
+    ++self->len_;
+  }
+
+  optional<T> pop_back(self^) noexcept safe {
+    if (self->len_ == 0) return .none;
+    --self->len_;
+    return .some(T{ mut self->columns_.pop_back().unwrap() ... });
+  }
+
+  // A copy of the element at i.
+  T get(self const^, std::size_t i) safe {
+    if (i >= self->len_) panic_bounds("soa_vector index is out-of-bounds");
+    return T{ cpy self->columns_[i] ... };
+  }
+
+  soa_row<const T> row(self const^, std::size_t i) noexcept safe {
+    if (i >= self->len_) panic_bounds("soa_vector index is out-of-bounds");
+    return soa_row<const T>(self, i);
+  }
+
+  soa_row<T> row(self^, std::size_t i) noexcept safe {
+    if (i >= self->len_) panic_bounds("soa_vector index is out-of-bounds");
+    return soa_row<T>(self, i);
+  }
+
+  // The column holding data member M, e.g. column<&particle::x>().
+  template<auto M>
+  const [detail::soa_field_t<T, M>; dyn]^ column(self const^) noexcept safe {
+    constexpr std::size_t i = detail::soa_index<T, M>();
+    static_assert(i < num_columns, "M is not a data member of T");
+    return self->columns_...[i].slice();
+  }
+
+  template<auto M>
+  [detail::soa_field_t<T, M>; dyn]^ column(self^) noexcept safe {
+    constexpr std::size_t i = detail::soa_index<T, M>();
+    static_assert(i < num_columns, "M is not a data member of T");
+    return mut self->columns_...[i].slice();
+  }
+
+  // Mutable slices of several distinct columns at once. A borrow of one
+  // column holds the whole container, so this is how a loop reads some
+  // columns while writing others.
+  template<auto... Ms>
+  tuple<[detail::soa_field_t<T, Ms>; dyn]^...> columns(self^) noexcept safe {
+    static_assert(detail::soa_distinct<T, Ms...>(), "columns must be distinct");
+    static_assert(((detail::soa_index<T, Ms>() < num_columns) && ...),
+      "each of Ms must be a data member of T");
+
+    std::size_t const n = self->len_;
+    unsafe {
+      return tuple<[detail::soa_field_t<T, Ms>; dyn]^...>{
+        slice_from_raw_parts(mut self->columns_...[detail::soa_index<T, Ms>()].data(), n) ...
+      };
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// radix_sort.h
+
+namespace detail
+{
+
+// Maps a key to an unsigned integer of the same width whose order matches
+// the key's. Signed integers flip the sign bit. Floats flip every bit when
+// negative and only the sign bit otherwise, which gives IEEE totalOrder:
+// -NaN < -inf < ... < -0 < +0 < ... < +inf < +NaN.
+template<class T>
+auto radix_key(T x) noexcept safe
+{
+  if constexpr (std::is_floating_point_v<T>) {
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8, "radix_sort supports float and double");
+    using U = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+
+    U u = 0;
+    unsafe { std::memcpy(addr u, addr x, sizeof(T)); }
+    U const sign = U(1) << (sizeof(T) * 8 - 1);
+    return (u & sign) ? U(~u) : U(u | sign);
+  } else if constexpr (std::is_signed_v<T>) {
+    using U = std::make_unsigned_t<T>;
+    return U(U(x) ^ (U(1) << (sizeof(T) * 8 - 1)));
+  } else {
+    return x;
+  }
+}
+
+template<class T>
+unsigned radix_digit(T x, std::size_t pass) noexcept safe
+{
+  return static_cast<unsigned>((radix_key(x) >> (8 * pass)) & 0xff);
+}
+
+template<class T>
+struct radix_less
+{
+  bool operator()(self const^, T const^ a, T const^ b) noexcept safe {
+    return radix_key(*a) < radix_key(*b);
+  }
+};
+
+// Below this a comparison sort beats paying for the histograms.
+inline constexpr std::size_t radix_cutoff = 256;
+
+// LSD radix sort on bytes, ping-ponging between v and buf. All histograms
+// come from one read of the input, and a pass whose byte is the same for
+// every key is skipped.
+template<class T>
+void radix_sort_lsd(T* v, std::size_t n, T* buf) noexcept
+{
+  std::size_t const passes = sizeof(T);
+  std::size_t counts[passes][256] = {};
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t p = 0; p < passes; ++p) {
+      ++counts[p][radix_digit(v[i], p)];
+    }
+  }
+
+  T* src = v;
+  T* dst = buf;
+  for (std::size_t p = 0; p < passes; ++p) {
+    std::size_t* c = counts[p];
+    if (c[radix_digit(src[0], p)] == n) continue;
+
+    std::size_t offsets[256];
+    std::size_t sum = 0;
+    for (std::size_t d = 0; d < 256; ++d) {
+      offsets[d] = sum;
+      sum += c[d];
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+      dst[offsets[radix_digit(src[i], p)]++] = src[i];
+    }
+
+    T* t = src;
+    src = dst;
+    dst = t;
+  }
+
+  if (src != v) std::memcpy(static_cast<void*>(v), static_cast<void const*>(src), n * sizeof(T));
+}
+
+// Scatters v by its most significant byte, leaving it grouped by that byte
+// in ascending order.
+template<class T>
+void radix_scatter_top(T* v, std::size_t n, T* buf) noexcept
+{
+  std::size_t const top = sizeof(T) - 1;
+  std::size_t offsets[256] = {};
+  for (std::size_t i = 0; i < n; ++i) ++offsets[radix_digit(v[i], top)];
+
+  std::size_t sum = 0;
+  for (std::size_t d = 0; d < 256; ++d) {
+    std::size_t const c = offsets[d];
+    offsets[d] = sum;
+    sum += c;
+  }
+
+  for (std::size_t i = 0; i < n; ++i) {
+    buf[offsets[radix_digit(v[i], top)]++] = v[i];
+  }
+  std::memcpy(static_cast<void*>(v), static_cast<void const*>(buf), n * sizeof(T));
+}
+
+template<class S>
+str radix_view(S const& s) noexcept
+{
+  if constexpr (std::is_same_v<S, str>) {
+    return s;
+  } else {
+    return s.str();
+  }
+}
+
+// The byte at depth plus one, or 0 once the string has ended, so shorter
+// strings sort first.
+inline unsigned radix_byte(str s, std::size_t depth) noexcept
+{
+  return depth < s.size() ? 1u + static_cast<unsigned char>(s.data()[depth]) : 0u;
+}
+
+// Orders strings that share their first depth bytes by the rest.
+struct radix_tail_less
+{
+  std::size_t depth;
+
+  template<class S>
+  bool operator()(self const^, S const^ a, S const^ b) noexcept safe {
+    unsafe { str x = radix_view(*a); }
+    unsafe { str y = radix_view(*b); }
+    std::size_t const lx = x.size() - self->depth;
+    std::size_t const ly = y.size() - self->depth;
+    unsafe { int c = std::memcmp(x.data() + self->depth, y.data() + self->depth, lx < ly ? lx : ly); }
+    return c < 0 || (c == 0 && lx < ly);
+  }
+};
+
+// MSD radix sort on bytes. Elements are moved bitwise through buf. Runs of
+// a shared byte advance the depth without moving anything, and the largest
+// bucket is handled by the loop instead of recursion, so the stack depth
+// stays logarithmic.
+template<class S>
+void radix_sort_msd(S* v, std::size_t n, S* buf, std::size_t depth) noexcept
+{
+  std::size_t const small = 32;
+
+  while (n > 1) {
+    if (n < small) {
+      radix_tail_less less{ depth };
+      insertion_sort(v, n, less);
+      return;
+    }
+
+    std::size_t counts[257] = {};
+    for (std::size_t i = 0; i < n; ++i) ++counts[radix_byte(radix_view(v[i]), depth)];
+
+    // Every string has ended: they're all equal.
+    if (counts[0] == n) return;
+
+    std::size_t largest = 1;
+    for (std::size_t d = 2; d < 257; ++d) {
+      if (counts[d] > counts[largest]) largest = d;
+    }
+    if (counts[largest] == n) {
+      ++depth;
+      continue;
+    }
+
+    std::size_t starts[257];
+    std::size_t sum = 0;
+    for (std::size_t d = 0; d < 257; ++d) {
+      starts[d] = sum;
+      sum += counts[d];
+    }
+
+    std::size_t offsets[257];
+    std::memcpy(offsets, starts, sizeof(starts));
+    for (std::size_t i = 0; i < n; ++i) {
+      relocate_one(buf + offsets[radix_byte(radix_view(v[i]), depth)]++, v + i);
+    }
+    std::memcpy(static_cast<void*>(v), static_cast<void const*>(buf), n * sizeof(S));
+
+    for (std::size_t d = 1; d < 257; ++d) {
+      if (d != largest && counts[d] > 1) {
+        radix_sort_msd(v + starts[d], counts[d], buf, depth + 1);
+      }
+    }
+
+    v += starts[largest];
+    n = counts[largest];
+    ++depth;
+  }
+}
+
+template<class S>
+void radix_sort_strings([S; dyn]^ s) safe
+{
+  std::size_t const n = (*s)~length;
+  if (n < 2) return;
+
+  // Only the storage is used. The vector never owns what passes through it.
+  vector<S> scratch = {};
+  mut scratch.reserve(n);
+  unsafe { radix_sort_msd((*s)~as_pointer, n, mut scratch.data(), 0); }
+}
+
+template<class T>
+void par_radix_split([T; dyn]^ s, std::size_t threads) safe;
+
+template<class T>
+struct par_radix_task/(a)
+{
+  [T; dyn]^/a s;
+  std::size_t threads;
+
+  void operator()(self^) safe {
+    detail::par_radix_split(self->s, self->threads);
+  }
+};
+
+// Below this a slice isn't worth handing to another thread.
+inline constexpr std::size_t par_radix_grain = std::size_t(1) << 16;
+
+} // namespace detail
+
+// LSD radix sort for integers and floats, in O(n) passes over the data with
+// a scratch buffer the size of s. Floats follow IEEE totalOrder, so -0
+// sorts before +0 and NaNs go to the ends instead of breaking the order.
+template<class T>
+void radix_sort([T; dyn]^ s) safe
+requires(std::is_integral_v<T> || std::is_floating_point_v<T>)
+{
+  std::size_t const n = (*s)~length;
+  if (n < detail::radix_cutoff) {
+    sort_unstable_by(s, detail::radix_less<T>{});
+    return;
+  }
+
+  vector<T> scratch = {};
+  mut scratch.reserve(n);
+  unsafe { detail::radix_sort_lsd((*s)~as_pointer, n, mut scratch.data()); }
+}
+
+// MSD radix sort for strings, ordering them bytewise like memcmp.
+inline void radix_sort([str; dyn]^ s) safe
+{
+  detail::radix_sort_strings(s);
+}
+
+inline void radix_sort([string; dyn]^ s) safe
+{
+  detail::radix_sort_strings(s);
+}
+
+namespace detail
+{
+
+// s is grouped by its top byte, so a split at a bucket boundary leaves two
+// halves that can be sorted independently.
+template<class T>
+void par_radix_split([T; dyn]^ s, std::size_t threads) safe
+{
+  std::size_t const n = (*s)~length;
+  std::size_t const top = sizeof(T) - 1;
+  if (threads < 2 || n < par_radix_grain) {
+    radix_sort(s);
+    return;
+  }
+
+  unsigned const pivot = radix_digit((*s)[n / 2], top);
+
+  std::size_t lo = 0;
+  std::size_t hi = n;
+  while (lo < hi) {
+    std::size_t const m = lo + (hi - lo) / 2;
+    if (radix_digit((*s)[m], top) < pivot) lo = m + 1;
+    else hi = m;
+  }
+
+  if (lo == 0) {
+    hi = n;
+    while (lo < hi) {
+      std::size_t const m = lo + (hi - lo) / 2;
+      if (radix_digit((*s)[m], top) <= pivot) lo = m + 1;
+      else hi = m;
+    }
+  }
+
+  // A single bucket: nothing to split on.
+  if (lo == n) {
+    radix_sort(s);
+    return;
+  }
+
+  auto halves = split_at_mut(s, lo);
+  join(
+    par_radix_task<T>{ rel halves.0, threads / 2 },
+    par_radix_task<T>{ rel halves.1, threads - threads / 2 });
+}
+
+} // namespace detail
+
+// radix_sort spread over up to threads threads. One scatter by the top byte
+// splits s into independent buckets, which are then sorted in parallel.
+template<class T>
+void par_radix_sort([T; dyn]^ s, std::size_t threads) safe
+requires(std::is_integral_v<T> || std::is_floating_point_v<T>)
+{
+  std::size_t const n = (*s)~length;
+  if (threads < 2 || n < detail::par_radix_grain) {
+    radix_sort(s);
+    return;
+  }
+
+  {
+    vector<T> scratch = {};
+    mut scratch.reserve(n);
+    unsafe { detail::radix_scatter_top((*s)~as_pointer, n, mut scratch.data()); }
+  }
+  detail::par_radix_split(s, threads);
+}
+
+template<class T>
+void par_radix_sort([T; dyn]^ s) safe
+requires(std::is_integral_v<T> || std::is_floating_point_v<T>)
+{
+  par_radix_sort(s, available_parallelism());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// iterator/adaptors.h
+
+// Adaptors and consumers over the iterator interface. Every adaptor holds
+// its source and callables by value and forwards next() without any
+// type erasure, so a chain of them inlines down to the underlying loop.
+
+namespace iter
+{
+
+template<class I>
+using item_t = typename impl<I, iterator>::item_type;
+
+template<class O>
+struct optional_value;
+
+template<class T>
+struct optional_value<optional<T>>
+{
+  using type = T;
+};
+
+template<class B>
+struct borrow_value;
+
+template<class T>
+struct borrow_value<T^>
+{
+  using type = std::remove_const_t<T>;
+};
+
+inline
+size_hint_type exact_hint(std::size_t n) safe
+{
+  optional<std::size_t> upper = .some(n);
+  return (n, rel upper);
+}
+
+// Combines the bounds of two iterators that run side by side, or one after
+// the other. Bounds saturate rather than overflow.
+inline
+size_hint_type min_hint(size_hint_type a, size_hint_type b) safe
+{
+  std::size_t const lower = a.0 < b.0 ? a.0 : b.0;
+  optional<std::size_t> upper = match(a.1) -> optional<std::size_t> {
+    .some(x) => match(b.1) -> optional<std::size_t> {
+      .some(y) => .some(x < y ? x : y);
+      .none    => .some(x);
+    };
+    .none => b.1;
+  };
+  return (lower, rel upper);
+}
+
+inline
+size_hint_type add_hint(size_hint_type a, size_hint_type b) safe
+{
+  std::size_t const max = static_cast<std::size_t>(-1);
+  std::size_t const lower = a.0 > max - b.0 ? max : a.0 + b.0;
+  optional<std::size_t> upper = .none;
+  if (a.1.is_some() && b.1.is_some()) {
+    std::size_t const x = (cpy a.1).unwrap();
+    std::size_t const y = (cpy b.1).unwrap();
+    if (x <= max - y) upper = .some(x + y);
+  }
+  return (lower, rel upper);
+}
+
+//------------------------------------------------------------------------------
+// internal iteration
+
+template<class I+, class B+, class F+>
+B fold(I it, B init, F f) safe
+requires impl<I, iterator>;
+
+template<class I, class B+, class F+>
+call_result_t<F, B, item_t<I>> try_fold(I^ it, B init, F f) safe
+requires impl<I, iterator>;
+
+// Adaptors fold by wrapping the caller's function in one of these and
+// folding their source, so an override at the bottom of a chain, such as
+// slice_iterator's pointer loop, drives the whole chain.
+
+template<class F+, class G+>
+struct map_folder
+{
+  F f;
+  G g;
+
+  template<class B+, class X+>
+  B operator()(self^, B acc, X x) safe {
+    return mut self->g(rel acc, mut self->f(rel x));
+  }
+};
+
+template<class G+>
+struct copied_folder
+{
+  G g;
+
+  template<class B+, class X>
+  B operator()(self^, B acc, X x) safe {
+    return mut self->g(rel acc, cpy *x);
+  }
+};
+
+template<class P+, class G+>
+struct filter_folder
+{
+  P p;
+  G g;
+
+  template<class B+, class X+>
+  B operator()(self^, B acc, X x) safe {
+    if (mut self->p(^const x)) return mut self->g(rel acc, rel x);
+    return rel acc;
+  }
+};
+
+template<class F+, class G+>
+struct filter_map_folder
+{
+  F f;
+  G g;
+
+  template<class B+, class X+>
+  B operator()(self^, B acc, X x) safe {
+    call_result_t<F, X> y = mut self->f(rel x);
+    if (y.is_none()) return rel acc;
+    return mut self->g(rel acc, y rel.unwrap());
+  }
+};
+
+template<class G+>
+struct enumerate_folder
+{
+  std::size_t count;
+  G g;
+
+  template<class B+, class X+>
+  B operator()(self^, B acc, X x) safe {
+    return mut self->g(rel acc, (self->count++, rel x));
+  }
+};
+
+// try_fold only borrows the adaptor, so these borrow its state instead of
+// taking it, and pass g's expected<B, E> straight through.
+
+template<class F+, class G+>
+struct map_try_folder/(a)
+{
+  F^/a f;
+  G g;
+
+  template<class B+, class X+>
+  call_result_t<G, B, call_result_t<F, X>> operator()(self^, B acc, X x) safe {
+    return mut self->g(rel acc, mut (*self->f)(rel x));
+  }
+};
+
+template<class G+>
+struct copied_try_folder
+{
+  G g;
+
+  template<class B+, class X>
+  call_result_t<G, B, typename borrow_value<X>::type> operator()(self^, B acc, X x) safe {
+    return mut self->g(rel acc, cpy *x);
+  }
+};
+
+template<class P+, class G+>
+struct filter_try_folder/(a)
+{
+  P^/a p;
+  G g;
+
+  template<class B+, class X+>
+  call_result_t<G, B, X> operator()(self^, B acc, X x) safe {
+    if (mut (*self->p)(^const x)) return mut self->g(rel acc, rel x);
+    return .ok(rel acc);
+  }
+};
+
+template<class F+, class G+>
+struct filter_map_try_folder/(a)
+{
+  F^/a f;
+  G g;
+
+  template<class B+, class X+>
+  call_result_t<G, B, typename optional_value<call_result_t<F, X>>::type>
+  operator()(self^, B acc, X x) safe {
+    call_result_t<F, X> y = mut (*self->f)(rel x);
+    if (y.is_none()) return .ok(rel acc);
+    return mut self->g(rel acc, y rel.unwrap());
+  }
+};
+
+template<class G+>
+struct enumerate_try_folder/(a)
+{
+  std::size_t^/a count;
+  G g;
+
+  template<class B+, class X+>
+  call_result_t<G, B, (std::size_t, X)> operator()(self^, B acc, X x) safe {
+    return mut self->g(rel acc, ((*self->count)++, rel x));
+  }
+};
+
+//------------------------------------------------------------------------------
+// map
+
+template<class I+, class F+>
+class map_iterator
+{
+  I it_;
+  F f_;
+
+public:
+  using item_type = call_result_t<F, item_t<I>>;
+
+  map_iterator(I it, F f) noexcept safe
+    : it_(rel it)
+    , f_(rel f)
+  {
+  }
+
+  optional<item_type> next(self^) safe {
+    return match(mut self->it_.std2::iterator::next()) -> optional<item_type> {
+      .some(x) => .some(mut self->f_(rel x));
+      .none    => .none;
+    };
+  }
+
+  iter::size_hint_type size_hint(self const^) safe {
+    return iter::size_hint(self->it_);
+  }
+
+  template<class B+, class G+>
+  B fold(self, B init, G g) safe {
+    return iter::fold(rel self.it_, rel init, map_folder<F, G>{ rel self.f_, rel g });
+  }
+
+  template<class B+, class G+>
+  call_result_t<G, B, item_type> try_fold(self^, B init, G g) safe {
+    return iter::try_fold(^self->it_, rel init, map_try_folder<F, G>{ ^self->f_, rel g });
+  }
+};
+
+template<class I, class F>
+impl map_iterator<I, F>: iterator
+{
+  using item_type = typename map_iterator<I, F>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+template<class I+, class F+>
+map_iterator<I, F> map(I it, F f) noexcept safe
+requires impl<I, iterator>
+{
+  return map_iterator<I, F>(rel it, rel f);
+}
+
+//------------------------------------------------------------------------------
+// copied
+
+// Turns an iterator over borrows into an iterator over copies.
+template<class I+>
+class copied_iterator
+{
+  I it_;
+
+public:
+  using item_type = typename borrow_value<item_t<I>>::type;
+
+  explicit copied_iterator(I it) noexcept safe
+    : it_(rel it)
+  {
+  }
+
+  optional<item_type> next(self^) safe {
+    return match(mut self->it_.std2::iterator::next()) -> optional<item_type> {
+      .some(x) => .some(cpy *x);
+      .none    => .none;
+    };
+  }
+
+  iter::size_hint_type size_hint(self const^) safe {
+    return iter::size_hint(self->it_);
+  }
+
+  template<class B+, class G+>
+  B fold(self, B init, G g) safe {
+    return iter::fold(rel self.it_, rel init, copied_folder<G>{ rel g });
+  }
+
+  template<class B+, class G+>
+  call_result_t<G, B, item_type> try_fold(self^, B init, G g) safe {
+    return iter::try_fold(^self->it_, rel init, copied_try_folder<G>{ rel g });
+  }
+};
+
+template<class I>
+impl copied_iterator<I>: iterator
+{
+  using item_type = typename copied_iterator<I>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+template<class I+>
+copied_iterator<I> copied(I it) noexcept safe
+requires impl<I, iterator>
+{
+  return copied_iterator<I>(rel it);
+}
+
+//------------------------------------------------------------------------------
+// filter
+
+template<class I+, class P+>
+class filter_iterator
+{
+  I it_;
+  P p_;
+
+public:
+  using item_type = item_t<I>;
+
+  filter_iterator(I it, P p) noexcept safe
+    : it_(rel it)
+    , p_(rel p)
+  {
+  }
+
+  optional<item_type> next(self^) safe {
+    while (true) {
+      optional<item_type> m_x = mut self->it_.std2::iterator::next();
+      if (m_x.is_none()) return .none;
+
+      item_type x = m_x rel.unwrap();
+      if (mut self->p_(^const x)) return .some(rel x);
+    }
+  }
+
+  // Any number of items may be rejected.
+  iter::size_hint_type size_hint(self const^) safe {
+    optional<std::size_t> upper = iter::size_hint(self->it_).1;
+    return (std::size_t(0), rel upper);
+  }
+
+  template<class B+, class G+>
+  B fold(self, B init, G g) safe {
+    return iter::fold(rel self.it_, rel init, filter_folder<P, G>{ rel self.p_, rel g });
+  }
+
+  template<class B+, class G+>
+  call_result_t<G, B, item_type> try_fold(self^, B init, G g) safe {
+    return iter::try_fold(^self->it_, rel init, filter_try_folder<P, G>{ ^self->p_, rel g });
+  }
+};
+
+template<class I, class P>
+impl filter_iterator<I, P>: iterator
+{
+  using item_type = typename filter_iterator<I, P>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+// The predicate sees each item through a const borrow.
+template<class I+, class P+>
+filter_iterator<I, P> filter(I it, P p) noexcept safe
+requires impl<I, iterator>
+{
+  return filter_iterator<I, P>(rel it, rel p);
+}
+
+//------------------------------------------------------------------------------
+// filter_map
+
+template<class I+, class F+>
+class filter_map_iterator
+{
+  I it_;
+  F f_;
+
+public:
+  using item_type = typename optional_value<call_result_t<F, item_t<I>>>::type;
+
+  filter_map_iterator(I it, F f) noexcept safe
+    : it_(rel it)
+    , f_(rel f)
+  {
+  }
+
+  optional<item_type> next(self^) safe {
+    while (true) {
+      optional<item_t<I>> m_x = mut self->it_.std2::iterator::next();
+      if (m_x.is_none()) return .none;
+
+      optional<item_type> y = mut self->f_(m_x rel.unwrap());
+      if (y.is_some()) return rel y;
+    }
+  }
+
+  // Any number of items may be rejected.
+  iter::size_hint_type size_hint(self const^) safe {
+    optional<std::size_t> upper = iter::size_hint(self->it_).1;
+    return (std::size_t(0), rel upper);
+  }
+
+  template<class B+, class G+>
+  B fold(self, B init, G g) safe {
+    return iter::fold(rel self.it_, rel init, filter_map_folder<F, G>{ rel self.f_, rel g });
+  }
+
+  template<class B+, class G+>
+  call_result_t<G, B, item_type> try_fold(self^, B init, G g) safe {
+    return iter::try_fold(^self->it_, rel init, filter_map_try_folder<F, G>{ ^self->f_, rel g });
+  }
+};
+
+template<class I, class F>
+impl filter_map_iterator<I, F>: iterator
+{
+  using item_type = typename filter_map_iterator<I, F>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+// f returns an optional; the none results are skipped.
+template<class I+, class F+>
+filter_map_iterator<I, F> filter_map(I it, F f) noexcept safe
+requires impl<I, iterator>
+{
+  return filter_map_iterator<I, F>(rel it, rel f);
+}
+
+//------------------------------------------------------------------------------
+// enumerate
+
+template<class I+>
+class enumerate_iterator
+{
+  I it_;
+  std::size_t count_;
+
+public:
+  using item_type = (std::size_t, item_t<I>);
+
+  explicit enumerate_iterator(I it) noexcept safe
+    : it_(rel it)
+    , count_(0)
+  {
+  }
+
+  optional<item_type> next(self^) safe {
+    return match(mut self->it_.std2::iterator::next()) -> optional<item_type> {
+      .some(x) => .some((self->count_++, rel x));
+      .none    => .none;
+    };
+  }
+
+  iter::size_hint_type size_hint(self const^) safe {
+    return iter::size_hint(self->it_);
+  }
+
+  template<class B+, class G+>
+  B fold(self, B init, G g) safe {
+    return iter::fold(rel self.it_, rel init, enumerate_folder<G>{ self.count_, rel g });
+  }
+
+  template<class B+, class G+>
+  call_result_t<G, B, item_type> try_fold(self^, B init, G g) safe {
+    return iter::try_fold(^self->it_, rel init, enumerate_try_folder<G>{ ^self->count_, rel g });
+  }
+};
+
+template<class I>
+impl enumerate_iterator<I>: iterator
+{
+  using item_type = typename enumerate_iterator<I>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+template<class I+>
+enumerate_iterator<I> enumerate(I it) noexcept safe
+requires impl<I, iterator>
+{
+  return enumerate_iterator<I>(rel it);
+}
+
+//------------------------------------------------------------------------------
+// zip
+
+template<class A+, class B+>
+class zip_iterator
+{
+  A a_;
+  B b_;
+
+public:
+  using item_type = (item_t<A>, item_t<B>);
+
+  zip_iterator(A a, B b) noexcept safe
+    : a_(rel a)
+    , b_(rel b)
+  {
+  }
+
+  optional<item_type> next(self^) safe {
+    optional<item_t<A>> a = mut self->a_.std2::iterator::next();
+    if (a.is_none()) return .none;
+
+    optional<item_t<B>> b = mut self->b_.std2::iterator::next();
+    if (b.is_none()) return .none;
+
+    return .some((a rel.unwrap(), b rel.unwrap()));
+  }
+
+  iter::size_hint_type size_hint(self const^) safe {
+    return min_hint(iter::size_hint(self->a_), iter::size_hint(self->b_));
+  }
+};
+
+template<class A, class B>
+impl zip_iterator<A, B>: iterator
+{
+  using item_type = typename zip_iterator<A, B>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+// Stops as soon as either side runs out.
+template<class A+, class B+>
+zip_iterator<A, B> zip(A a, B b) noexcept safe
+requires impl<A, iterator> && impl<B, iterator>
+{
+  return zip_iterator<A, B>(rel a, rel b);
+}
+
+//------------------------------------------------------------------------------
+// chain
+
+template<class A+, class B+>
+class chain_iterator
+{
+  A a_;
+  B b_;
+  bool front_done_;
+
+public:
+  using item_type = item_t<A>;
+
+  chain_iterator(A a, B b) noexcept safe
+    : a_(rel a)
+    , b_(rel b)
+    , front_done_(false)
+  {
+  }
+
+  optional<item_type> next(self^) safe {
+    if (!self->front_done_) {
+      optional<item_type> x = mut self->a_.std2::iterator::next();
+      if (x.is_some()) return rel x;
+      self->front_done_ = true;
+    }
+    return mut self->b_.std2::iterator::next();
+  }
+
+  iter::size_hint_type size_hint(self const^) safe {
+    iter::size_hint_type b = iter::size_hint(self->b_);
+    if (self->front_done_) return rel b;
+    return add_hint(iter::size_hint(self->a_), rel b);
+  }
+};
+
+template<class A, class B>
+impl chain_iterator<A, B>: iterator
+{
+  using item_type = typename chain_iterator<A, B>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+template<class A+, class B+>
+chain_iterator<A, B> chain(A a, B b) noexcept safe
+requires impl<A, iterator> && impl<B, iterator> && std::is_same_v<item_t<A>, item_t<B>>
+{
+  return chain_iterator<A, B>(rel a, rel b);
+}
+
+//------------------------------------------------------------------------------
+// take / skip / step_by
+
+template<class I+>
+class take_iterator
+{
+  I it_;
+  std::size_t remaining_;
+
+public:
+  using item_type = item_t<I>;
+
+  take_iterator(I it, std::size_t n) noexcept safe
+    : it_(rel it)
+    , remaining_(n)
+  {
+  }
+
+  optional<item_type> next(self^) safe {
+    if (self->remaining_ == 0) return .none;
+    --self->remaining_;
+    return mut self->it_.std2::iterator::next();
+  }
+
+  iter::size_hint_type size_hint(self const^) safe {
+    std::size_t const n = self->remaining_;
+    return min_hint(iter::size_hint(self->it_), exact_hint(n));
+  }
+};
+
+template<class I>
+impl take_iterator<I>: iterator
+{
+  using item_type = typename take_iterator<I>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+template<class I+>
+take_iterator<I> take(I it, std::size_t n) noexcept safe
+requires impl<I, iterator>
+{
+  return take_iterator<I>(rel it, n);
+}
+
+template<class I+>
+class skip_iterator
+{
+  I it_;
+  std::size_t skip_;
+
+public:
+  using item_type = item_t<I>;
+
+  skip_iterator(I it, std::size_t n) noexcept safe
+    : it_(rel it)
+    , skip_(n)
+  {
+  }
+
+  optional<item_type> next(self^) safe {
+    while (self->skip_ > 0) {
+      --self->skip_;
+      if ((mut self->it_.std2::iterator::next()).is_none()) return .none;
+    }
+    return mut self->it_.std2::iterator::next();
+  }
+
+  iter::size_hint_type size_hint(self const^) safe {
+    iter::size_hint_type h = iter::size_hint(self->it_);
+    std::size_t const n = self->skip_;
+    std::size_t const lower = h.0 > n ? h.0 - n : 0;
+    optional<std::size_t> upper = match(h.1) -> optional<std::size_t> {
+      .some(u) => .some(u > n ? u - n : 0);
+      .none    => .none;
+    };
+    return (lower, rel upper);
+  }
+};
+
+template<class I>
+impl skip_iterator<I>: iterator
+{
+  using item_type = typename skip_iterator<I>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+template<class I+>
+skip_iterator<I> skip(I it, std::size_t n) noexcept safe
+requires impl<I, iterator>
+{
+  return skip_iterator<I>(rel it, n);
+}
+
+template<class I+>
+class step_by_iterator
+{
+  I it_;
+  std::size_t step_;
+  bool first_;
+
+public:
+  using item_type = item_t<I>;
+
+  step_by_iterator(I it, std::size_t step) noexcept safe
+    : it_(rel it)
+    , step_(step)
+    , first_(true)
+  {
+    if (step == 0) panic("step_by requires a non-zero step");
+  }
+
+  optional<item_type> next(self^) safe {
+    if (!self->first_) {
+      for (std::size_t i = 1; i < self->step_; ++i) {
+        if ((mut self->it_.std2::iterator::next()).is_none()) return .none;
+      }
+    }
+    self->first_ = false;
+    return mut self->it_.std2::iterator::next();
+  }
+
+  iter::size_hint_type size_hint(self const^) safe {
+    iter::size_hint_type h = iter::size_hint(self->it_);
+    std::size_t const lower = self.steps(h.0);
+    optional<std::size_t> upper = match(h.1) -> optional<std::size_t> {
+      .some(u) => .some(self.steps(u));
+      .none    => .none;
+    };
+    return (lower, rel upper);
+  }
+
+private:
+  // How many items come out of n remaining source items.
+  std::size_t steps(self const^, std::size_t n) noexcept safe {
+    if (self->first_) return n == 0 ? 0 : 1 + (n - 1) / self->step_;
+    return n / self->step_;
+  }
+};
+
+template<class I>
+impl step_by_iterator<I>: iterator
+{
+  using item_type = typename step_by_iterator<I>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+// Yields the first item and then every step-th item after it.
+template<class I+>
+step_by_iterator<I> step_by(I it, std::size_t step) noexcept safe
+requires impl<I, iterator>
+{
+  return step_by_iterator<I>(rel it, step);
+}
+
+//------------------------------------------------------------------------------
+// take_while
+
+template<class I+, class P+>
+class take_while_iterator
+{
+  I it_;
+  P p_;
+  bool done_;
+
+public:
+  using item_type = item_t<I>;
+
+  take_while_iterator(I it, P p) noexcept safe
+    : it_(rel it)
+    , p_(rel p)
+    , done_(false)
+  {
+  }
+
+  optional<item_type> next(self^) safe {
+    if (self->done_) return .none;
+
+    optional<item_type> m_x = mut self->it_.std2::iterator::next();
+    if (m_x.is_none()) return .none;
+
+    item_type x = m_x rel.unwrap();
+    if (mut self->p_(^const x)) return .some(rel x);
+
+    self->done_ = true;
+    return .none;
+  }
+
+  iter::size_hint_type size_hint(self const^) safe {
+    if (self->done_) return exact_hint(0);
+    optional<std::size_t> upper = iter::size_hint(self->it_).1;
+    return (std::size_t(0), rel upper);
+  }
+};
+
+template<class I, class P>
+impl take_while_iterator<I, P>: iterator
+{
+  using item_type = typename take_while_iterator<I, P>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+// The predicate sees each item through a const borrow. The first item it
+// rejects is consumed and dropped.
+template<class I+, class P+>
+take_while_iterator<I, P> take_while(I it, P p) noexcept safe
+requires impl<I, iterator>
+{
+  return take_while_iterator<I, P>(rel it, rel p);
+}
+
+//------------------------------------------------------------------------------
+// flat_map
+
+template<class I+, class F+>
+class flat_map_iterator
+{
+  using inner_type = call_result_t<F, item_t<I>>;
+
+  I it_;
+  F f_;
+  optional<inner_type> inner_;
+
+public:
+  using item_type = item_t<inner_type>;
+
+  flat_map_iterator(I it, F f) noexcept safe
+    : it_(rel it)
+    , f_(rel f)
+    , inner_(.none)
+  {
+  }
+
+  optional<item_type> next(self^) safe {
+    while (true) {
+      optional<item_type> y = match(self->inner_) -> optional<item_type> {
+        .some(^inner) => mut inner.std2::iterator::next();
+        .none         => .none;
+      };
+      if (y.is_some()) return rel y;
+
+      optional<item_t<I>> m_x = mut self->it_.std2::iterator::next();
+      if (m_x.is_none()) return .none;
+      self->inner_ = .some(mut self->f_(m_x rel.unwrap()));
+    }
+  }
+
+  // Nothing is known about inner iterators that haven't been made yet.
+  iter::size_hint_type size_hint(self const^) safe {
+    optional<std::size_t> upper = .none;
+    return (std::size_t(0), rel upper);
+  }
+};
+
+template<class I, class F>
+impl flat_map_iterator<I, F>: iterator
+{
+  using item_type = typename flat_map_iterator<I, F>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+// f maps each item to an iterator whose items are yielded in turn.
+template<class I+, class F+>
+flat_map_iterator<I, F> flat_map(I it, F f) noexcept safe
+requires impl<I, iterator>
+{
+  return flat_map_iterator<I, F>(rel it, rel f);
+}
+
+//------------------------------------------------------------------------------
+// rev
+
+template<class I+>
+class rev_iterator
+{
+  I it_;
+
+public:
+  using item_type = item_t<I>;
+
+  explicit rev_iterator(I it) noexcept safe
+    : it_(rel it)
+  {
+  }
+
+  optional<item_type> next(self^) safe {
+    return mut self->it_.std2::double_ended_iterator::next_back();
+  }
+
+  optional<item_type> next_back(self^) safe {
+    return mut self->it_.std2::iterator::next();
+  }
+
+  iter::size_hint_type size_hint(self const^) safe {
+    return iter::size_hint(self->it_);
+  }
+};
+
+template<class I>
+impl rev_iterator<I>: iterator
+{
+  using item_type = typename rev_iterator<I>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+template<class I>
+impl rev_iterator<I>: double_ended_iterator
+{
+  using item_type = typename rev_iterator<I>::item_type;
+
+  optional<item_type> next_back(self^) safe override {
+    return self.next_back();
+  }
+};
+
+// Walks a double-ended iterator from the back.
+template<class I+>
+rev_iterator<I> rev(I it) noexcept safe
+requires impl<I, double_ended_iterator>
+{
+  return rev_iterator<I>(rel it);
+}
+
+//------------------------------------------------------------------------------
+// peekable
+
+template<class I+>
+class peekable_iterator
+{
+  using inner_item = item_t<I>;
+
+  I it_;
+  optional<optional<inner_item>> peeked_;
+
+public:
+  using item_type = inner_item;
+
+  explicit peekable_iterator(I it) noexcept safe
+    : it_(rel it)
+    , peeked_(.none)
+  {
+  }
+
+  // Looks at the next item without consuming it.
+  optional<item_type const^> peek(self^) safe {
+    if (self->peeked_.is_none()) {
+      self->peeked_ = .some(mut self->it_.std2::iterator::next());
+    }
+
+    return match(self->peeked_) -> optional<item_type const^> {
+      .some(^slot) => match(*slot) -> optional<item_type const^> {
+        .some(^x) => .some(x);
+        .none     => .none;
+      };
+      .none => .none;
+    };
+  }
+
+  optional<item_type> next(self^) safe {
+    optional<optional<item_type>> p = mut self->peeked_.take();
+    if (p.is_some()) return p rel.unwrap();
+    return mut self->it_.std2::iterator::next();
+  }
+
+  iter::size_hint_type size_hint(self const^) safe {
+    return match(self->peeked_) -> iter::size_hint_type {
+      .some(.none)    => exact_hint(0);
+      .some(.some(_)) => add_hint(exact_hint(1), iter::size_hint(self->it_));
+      .none           => iter::size_hint(self->it_);
+    };
+  }
+};
+
+template<class I>
+impl peekable_iterator<I>: iterator
+{
+  using item_type = typename peekable_iterator<I>::item_type;
+
+  optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+template<class I+>
+peekable_iterator<I> peekable(I it) noexcept safe
+requires impl<I, iterator>
+{
+  return peekable_iterator<I>(rel it);
+}
+
+//------------------------------------------------------------------------------
+// consumers
+
+// Iterators with internal iteration provide fold() and try_fold() members.
+// The consumers below forward to them when they exist and fall back to
+// calling next() otherwise.
+template<class I, class B, class F>
+concept has_fold = requires
+{
+  std::declval<I>().fold(std::declval<B>(), std::declval<F>());
+};
+
+template<class I, class B, class F>
+concept has_try_fold = requires
+{
+  std::declval<I&>().try_fold(std::declval<B>(), std::declval<F>());
+};
+
+template<class I+, class B+, class F+>
+B fold(I it, B init, F f) safe
+requires impl<I, iterator>
+{
+  if constexpr (has_fold<I, B, F>) {
+    return it rel.fold(rel init, rel f);
+  } else {
+    B acc = rel init;
+    while (true) {
+      optional<item_t<I>> x = mut it.std2::iterator::next();
+      if (x.is_none()) return rel acc;
+      acc = mut f(rel acc, x rel.unwrap());
+    }
+  }
+}
+
+// f returns an expected<B, E>. Folding stops at the first error, which is
+// returned, and it is left positioned after the item that caused it.
+template<class I, class B+, class F+>
+call_result_t<F, B, item_t<I>> try_fold(I^ it, B init, F f) safe
+requires impl<I, iterator>
+{
+  if constexpr (has_try_fold<I, B, F>) {
+    return mut it.try_fold(rel init, rel f);
+  } else {
+    B acc = rel init;
+    while (true) {
+      optional<item_t<I>> x = mut it.std2::iterator::next();
+      if (x.is_none()) return .ok(rel acc);
+
+      call_result_t<F, B, item_t<I>> r = mut f(rel acc, x rel.unwrap());
+      if (r.is_err()) return rel r;
+      acc = r rel.unwrap();
+    }
+  }
+}
+
+template<class I>
+concept has_advance_by = requires
+{
+  std::declval<I&>().advance_by(std::size_t(0));
+};
+
+// Skips up to n items and returns how many were skipped. Slice and vector
+// iterators do this in constant time.
+template<class I>
+std::size_t advance_by(I^ it, std::size_t n) safe
+requires impl<I, iterator>
+{
+  if constexpr (has_advance_by<I>) {
+    return mut it.advance_by(n);
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      if ((mut it.std2::iterator::next()).is_none()) return i;
+    }
+    return n;
+  }
+}
+
+// Consumes n items and returns the one after them.
+template<class I>
+optional<item_t<I>> nth(I^ it, std::size_t n) safe
+requires impl<I, iterator>
+{
+  if (advance_by(it, n) < n) return .none;
+  return mut it.std2::iterator::next();
+}
+
+template<class F+>
+struct for_each_folder
+{
+  F f;
+
+  template<class X+>
+  unit operator()(self^, unit acc, X x) safe {
+    mut self->f(rel x);
+    return acc;
+  }
+};
+
+struct sum_folder
+{
+  template<class B, class X>
+  B operator()(self^, B acc, X x) safe {
+    return acc + x;
+  }
+};
+
+struct count_folder
+{
+  template<class X+>
+  std::size_t operator()(self^, std::size_t n, X x) safe {
+    return n + 1;
+  }
+};
+
+struct min_folder
+{
+  template<class X+>
+  X operator()(self^, X best, X x) safe {
+    if (x < best) return rel x;
+    return rel best;
+  }
+};
+
+struct max_folder
+{
+  template<class X+>
+  X operator()(self^, X best, X x) safe {
+    if (x < best) return rel best;
+    return rel x;
+  }
+};
+
+template<class P+>
+struct any_folder
+{
+  P p;
+
+  template<class X+>
+  expected<unit, unit> operator()(self^, unit acc, X x) safe {
+    if (mut self->p(rel x)) return .err(unit{});
+    return .ok(acc);
+  }
+};
+
+template<class P+>
+struct all_folder
+{
+  P p;
+
+  template<class X+>
+  expected<unit, unit> operator()(self^, unit acc, X x) safe {
+    if (mut self->p(rel x)) return .ok(acc);
+    return .err(unit{});
+  }
+};
+
+template<class P+, class X+>
+struct find_folder
+{
+  P p;
+
+  expected<unit, X> operator()(self^, unit acc, X x) safe {
+    if (mut self->p(^const x)) return .err(rel x);
+    return .ok(acc);
+  }
+};
+
+// Calls f on every item.
+template<class I+, class F+>
+void for_each(I it, F f) safe
+requires impl<I, iterator>
+{
+  fold(rel it, unit{}, for_each_folder<F>{ rel f });
+}
+
+template<class I+>
+item_t<I> sum(I it) safe
+requires impl<I, iterator>
+{
+  return fold(rel it, item_t<I>{}, sum_folder{});
+}
+
+template<class I+>
+std::size_t count(I it) safe
+requires impl<I, iterator>
+{
+  return fold(rel it, std::size_t(0), count_folder{});
+}
+
+template<class I+, class P+>
+bool any(I it, P p) safe
+requires impl<I, iterator>
+{
+  return try_fold(^it, unit{}, any_folder<P>{ rel p }).is_err();
+}
+
+template<class I+, class P+>
+bool all(I it, P p) safe
+requires impl<I, iterator>
+{
+  return try_fold(^it, unit{}, all_folder<P>{ rel p }).is_ok();
+}
+
+// The predicate sees each item through a const borrow.
+template<class I+, class P+>
+optional<item_t<I>> find(I it, P p) safe
+requires impl<I, iterator>
+{
+  expected<unit, item_t<I>> r = try_fold(^it, unit{}, find_folder<P, item_t<I>>{ rel p });
+  if (r.is_ok()) return .none;
+  return .some(r rel.unwrap_err());
+}
+
+// Returns the first of several equal minima.
+template<class I+>
+optional<item_t<I>> min(I it) safe
+requires impl<I, iterator>
+{
+  optional<item_t<I>> first = mut it.std2::iterator::next();
+  if (first.is_none()) return .none;
+  return .some(fold(rel it, first rel.unwrap(), min_folder{}));
+}
+
+// Returns the last of several equal maxima.
+template<class I+>
+optional<item_t<I>> max(I it) safe
+requires impl<I, iterator>
+{
+  optional<item_t<I>> first = mut it.std2::iterator::next();
+  if (first.is_none()) return .none;
+  return .some(fold(rel it, first rel.unwrap(), max_folder{}));
+}
+
+// Appends every item to v, reserving for the iterator's size hint first.
+template<class T+, class I+>
+void extend(vector<T>^ v, I it) safe
+requires impl<I, iterator> && std::is_same_v<item_t<I>, T>
+{
+  mut v.extend(rel it);
+}
+
+template<class I+>
+vector<item_t<I>> collect(I it) safe
+requires impl<I, iterator>
+{
+  vector<item_t<I>> v = {};
+  extend(^v, rel it);
+  return v;
+}
+
+// Concatenates string or string view items. They are already valid UTF,
+// so nothing is checked again.
+template<class I+>
+string collect_string(I it) safe
+requires impl<I, iterator>
+{
+  string s = {};
+  while (true) {
+    optional<item_t<I>> x = mut it.std2::iterator::next();
+    if (x.is_none()) return s;
+    mut s.append(x rel.unwrap());
+  }
+}
+
+} // namespace iter
+
+////////////////////////////////////////////////////////////////////////////////
+// flat_map.h
+
+namespace detail
+{
+
+struct entry_key_less
+{
+  template<class E>
+  bool operator()(self^, E const^ a, E const^ b) safe { return (*a).0 < (*b).0; }
+};
+
+// Sorts entries by key and keeps one entry per key. The sort is stable, so
+// among equal keys the last entry wins, as if they'd been inserted in order.
+template<class K, class V>
+(vector<K>, vector<V>) sorted_unique_entries(vector<(K, V)> entries) safe
+{
+  sort_by(mut entries.slice(), entry_key_less{});
+
+  vector<K> keys = {};
+  vector<V> values = {};
+  mut keys.reserve(entries.size());
+  mut values.reserve(entries.size());
+  for ((K, V) e : entries rel.iter()) {
+    std::size_t const n = keys.size();
+    if (n > 0 && !(keys[n - 1] < e.0)) {
+      (^values)[n - 1] = rel e.1;
+      continue;
+    }
+    mut keys.push_back(rel e.0);
+    mut values.push_back(rel e.1);
+  }
+  return (rel keys, rel values);
+}
+
+template<class K>
+vector<K> sorted_unique_keys(vector<K> keys) safe
+{
+  sort_unstable(mut keys.slice());
+
+  vector<K> out = {};
+  mut out.reserve(keys.size());
+  for (K k : keys rel.iter()) {
+    std::size_t const n = out.size();
+    if (n > 0 && !(out[n - 1] < k)) continue;
+    mut out.push_back(rel k);
+  }
+  return out;
+}
+
+// Makes room for one more element ahead of a push, doubling the capacity
+// as push_back would, so a container that pushes into several vectors can
+// allocate before it changes any of them.
+template<class T>
+void reserve_one_more(vector<T>^ v) safe
+{
+  std::size_t const n = v.size();
+  if (v.capacity() > n) return;
+  mut v.reserve(n > 0 ? 2 * n : 1);
+}
+
+} // namespace detail
+
+// A sorted map over two parallel vectors, one of keys and one of values.
+// Searches touch only the densely packed keys and run the branchless
+// lower_bound, so small tables that change rarely beat node-based maps on
+// lookups. Single inserts and removes shift the tail and cost O(n); build
+// the map in bulk or use insert_range for many entries at once.
+template<class K, class V>
+class flat_map
+{
+  vector<K> keys_;
+  vector<V> values_;
+
+  optional<std::size_t> position(self const^, const K^ k) noexcept safe {
+    std::size_t const i = lower_bound(self->keys_.slice(), k);
+    if (i < self->keys_.size() && !(*k < self->keys_[i])) return .some(i);
+    return .none;
+  }
+
+public:
+  flat_map() safe
+    : keys_(), values_()
+  {
+  }
+
+  // Sorts and deduplicates entries. For a repeated key the last entry wins.
+  explicit flat_map(vector<(K, V)> entries) safe
+    : keys_(), values_()
+  {
+    auto parts = detail::sorted_unique_entries(rel entries);
+    keys_ = rel parts.0;
+    values_ = rel parts.1;
+  }
+
+  std::size_t size(self const^) noexcept safe {
+    return self->keys_.size();
+  }
+
+  bool empty(self const^) noexcept safe {
+    return self->keys_.empty();
+  }
+
+  // The keys in ascending order.
+  const [K; dyn]^ keys(self const^) noexcept safe {
+    return self->keys_.slice();
+  }
+
+  // The values, in the order of their keys.
+  const [V; dyn]^ values(self const^) noexcept safe {
+    return self->values_.slice();
+  }
+
+  [V; dyn]^ values(self^) noexcept safe {
+    return mut self->values_.slice();
+  }
+
+  iter::zip_iterator<slice_iterator<const K>, slice_iterator<const V>>
+  iter(self const^) noexcept safe {
+    return iter::zip(self->keys_.iter(), self->values_.iter());
+  }
+
+  iter::zip_iterator<slice_iterator<const K>, slice_iterator<V>>
+  iter(self^) noexcept safe {
+    return iter::zip(self->keys_.iter(), mut self->values_.iter());
+  }
+
+  bool contains(self const^, const K^ k) noexcept safe {
+    return self.position(k).is_some();
+  }
+
+  optional<const V^> get(self const^, const K^ k) noexcept safe {
+    optional<std::size_t> m_i = self.position(k);
+    return match(m_i) -> optional<const V^> {
+      .some(i) => .some(self->values_[i]);
+      .none    => .none;
+    };
+  }
+
+  optional<V^> get(self^, const K^ k) noexcept safe {
+    optional<std::size_t> m_i = self.position(k);
+    return match(m_i) -> optional<V^> {
+      .some(i) => .some((^self->values_)[i]);
+      .none    => .none;
+    };
+  }
+
+  // Returns the previous value when k was already present.
+  optional<V> insert(self^, K k, V v) safe {
+    std::size_t const i = lower_bound(self->keys_.slice(), ^k);
+    if (i < self->keys_.size() && !(k < self->keys_[i])) {
+      return .some(replace<V>((^self->values_)[i], rel v));
+    }
+
+    // Both vectors allocate up front so a failure leaves them the same
+    // length.
+    detail::reserve_one_more(^self->keys_);
+    detail::reserve_one_more(^self->values_);
+    mut self->keys_.push_back(rel k);
+    mut self->values_.push_back(rel v);
+    rotate_right(split_at_mut(mut self->keys_.slice(), i).1, 1);
+    rotate_right(split_at_mut(mut self->values_.slice(), i).1, 1);
+    return .none;
+  }
+
+  optional<V> remove(self^, const K^ k) safe {
+    optional<std::size_t> m_i = self.position(k);
+    if (m_i.is_none()) return .none;
+
+    std::size_t const i = m_i.unwrap();
+    rotate_left(split_at_mut(mut self->keys_.slice(), i).1, 1);
+    rotate_left(split_at_mut(mut self->values_.slice(), i).1, 1);
+    mut self->keys_.pop_back();
+    return mut self->values_.pop_back();
+  }
+
+  // Adds entries, replacing the values of keys already present. The
+  // entries are sorted and deduplicated on their own, then merged with the
+  // map in one linear pass from the back.
+  void insert_range(self^, vector<(K, V)> entries) safe {
+    auto incoming = detail::sorted_unique_entries(rel entries);
+    vector<K> b_keys = rel incoming.0;
+    vector<V> b_values = rel incoming.1;
+
+    // The output is allocated before the map's contents are moved out, so
+    // a failed allocation leaves the map as it was.
+    std::size_t const n = self->keys_.size() + b_keys.size();
+    vector<K> keys = {};
+    mut keys.reserve(n);
+    vector<V> values = {};
+    mut values.reserve(n);
+    vector<K> a_keys = replace<vector<K>>(^self->keys_, rel keys);
+    vector<V> a_values = replace<vector<V>>(^self->values_, rel values);
+
+    // Takes the larger back element each step, so the output comes out
+    // descending and is reversed at the end.
+    while (!a_keys.empty() || !b_keys.empty()) {
+      std::size_t const na = a_keys.size();
+      std::size_t const nb = b_keys.size();
+      bool const take_a = nb == 0 || (na > 0 && b_keys[nb - 1] < a_keys[na - 1]);
+
+      if (take_a) {
+        mut self->keys_.push_back(mut a_keys.pop_back().unwrap());
+        mut self->values_.push_back(mut a_values.pop_back().unwrap());
+        continue;
+      }
+
+      // On equal keys the incoming entry replaces the old one.
+      if (na > 0 && !(a_keys[na - 1] < b_keys[nb - 1])) {
+        mut a_keys.pop_back();
+        mut a_values.pop_back();
+      }
+      mut self->keys_.push_back(mut b_keys.pop_back().unwrap());
+      mut self->values_.push_back(mut b_values.pop_back().unwrap());
+    }
+
+    reverse(mut self->keys_.slice());
+    reverse(mut self->values_.slice());
+  }
+};
+
+// A sorted set of unique keys in one vector, with the same trade-offs as
+// flat_map.
+template<class K>
+class flat_set
+{
+  vector<K> keys_;
+
+public:
+  flat_set() safe
+    : keys_()
+  {
+  }
+
+  // Sorts and deduplicates keys.
+  explicit flat_set(vector<K> keys) safe
+    : keys_(detail::sorted_unique_keys(rel keys))
+  {
+  }
+
+  std::size_t size(self const^) noexcept safe {
+    return self->keys_.size();
+  }
+
+  bool empty(self const^) noexcept safe {
+    return self->keys_.empty();
+  }
+
+  const [K; dyn]^ keys(self const^) noexcept safe {
+    return self->keys_.slice();
+  }
+
+  slice_iterator<const K> iter(self const^) noexcept safe {
+    return self->keys_.iter();
+  }
+
+  bool contains(self const^, const K^ k) noexcept safe {
+    std::size_t const i = lower_bound(self->keys_.slice(), k);
+    return i < self->keys_.size() && !(*k < self->keys_[i]);
+  }
+
+  // Returns false when k was already present.
+  bool insert(self^, K k) safe {
+    std::size_t const i = lower_bound(self->keys_.slice(), ^k);
+    if (i < self->keys_.size() && !(k < self->keys_[i])) return false;
+
+    mut self->keys_.push_back(rel k);
+    rotate_right(split_at_mut(mut self->keys_.slice(), i).1, 1);
+    return true;
+  }
+
+  bool remove(self^, const K^ k) safe {
+    if (!self.contains(k)) return false;
+
+    std::size_t const i = lower_bound(self->keys_.slice(), k);
+    rotate_left(split_at_mut(mut self->keys_.slice(), i).1, 1);
+    mut self->keys_.pop_back();
+    return true;
+  }
+
+  void insert_range(self^, vector<K> keys) safe {
+    vector<K> b = detail::sorted_unique_keys(rel keys);
+    vector<K> out = {};
+    mut out.reserve(self->keys_.size() + b.size());
+    vector<K> a = replace<vector<K>>(^self->keys_, rel out);
+
+    while (!a.empty() || !b.empty()) {
+      std::size_t const na = a.size();
+      std::size_t const nb = b.size();
+      if (nb == 0 || (na > 0 && b[nb - 1] < a[na - 1])) {
+        mut self->keys_.push_back(mut a.pop_back().unwrap());
+        continue;
+      }
+      if (na > 0 && !(a[na - 1] < b[nb - 1])) mut a.pop_back();
+      mut self->keys_.push_back(mut b.pop_back().unwrap());
+    }
+
+    reverse(mut self->keys_.slice());
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// future.h
+
+template<class T+>
+choice poll_result
+{
+  [[safety::unwrap]] ready(T),
+  pending;
+
+  T unwrap(self) noexcept safe {
+    return match(self) -> T {
+      .ready(t) => rel t;
+      .pending  => panic("{} is pending".format(poll_result~string));
+    };
+  }
+
+  bool is_ready(self const^) noexcept safe {
+    return match(*self) {
+      .ready(_) => true;
+      .pending  => false;
+    };
+  }
+
+  bool is_pending(self const^) noexcept safe {
+    return !self.is_ready();
+  }
+};
+
+// Wakers reschedule a task on the executor that owns it. The executor is
+// single-threaded, so the run queue is an rc and wakers are not send.
+class [[unsafe::send(false)]] waker
+{
+  rc<ref_cell<vector<std::size_t>>> ready_;
+  std::size_t task_;
+
+public:
+  waker(rc<ref_cell<vector<std::size_t>>> ready, std::size_t task) noexcept safe
+    : ready_(rel ready)
+    , task_(task)
+  {
+  }
+
+  waker(waker const^ rhs) safe
+    : ready_(cpy rhs->ready_)
+    , task_(rhs->task_)
+  {
+  }
+
+  void wake(self const^) safe {
+    auto q = self->ready_->borrow_mut();
+    mut (*q).push_back(self->task_);
+  }
+};
+
+class context/(a)
+{
+  waker const^/a waker_;
+
+public:
+  explicit context(waker const^/a w) noexcept safe
+    : waker_(w)
+  {
+  }
+
+  waker const^/a get_waker(self const^) noexcept safe {
+    return self->waker_;
+  }
+};
+
+// A future is a state machine driven by an executor. poll() either produces
+// the output or returns pending, in which case the future has arranged for
+// the context's waker to be woken once it can make progress.
+interface future {
+  typename output_type;
+  poll_result<output_type> poll(self^, context^ cx) safe;
+};
+
+template<class T+>
+class ready_future
+{
+  optional<T> value_;
+
+public:
+  explicit ready_future(T t) noexcept safe
+    : value_(.some(rel t))
+  {
+  }
+
+  poll_result<T> poll(self^, context^ cx) noexcept safe {
+    return .ready((mut self->value_.take()).expect("ready_future polled after completion"));
+  }
+};
+
+template<class T>
+impl ready_future<T>: future
+{
+  using output_type = T;
+
+  poll_result<output_type> poll(self^, context^ cx) safe override {
+    return self.poll(cx);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// executor.h
+
+template<class T+>
+struct join_state
+{
+  optional<T> value;
+  optional<waker> waiter;
+};
+
+// Resolves to the output of a spawned future.
+template<class T+>
+class [[unsafe::send(false)]] join_handle
+{
+  rc<ref_cell<join_state<T>>> state_;
+
+public:
+  explicit join_handle(rc<ref_cell<join_state<T>>> state) noexcept safe
+    : state_(rel state)
+  {
+  }
+
+  poll_result<T> poll(self^, context^ cx) safe {
+    auto s = self->state_->borrow_mut();
+    join_state<T>^ st = mut *s;
+
+    optional<T> v = mut st->value.take();
+    if (v.is_some()) return .ready(v rel.unwrap());
+
+    st->waiter = .some(cpy *cx.get_waker());
+    return .pending;
+  }
+};
+
+template<class T>
+impl join_handle<T>: future
+{
+  using output_type = T;
+
+  poll_result<output_type> poll(self^, context^ cx) safe override {
+    return self.poll(cx);
+  }
+};
+
+// Owns a spawned future and forwards its output to the join_handle.
+template<class F+>
+class [[unsafe::send(false)]] spawned_future
+{
+  using output_type = typename impl<F, future>::output_type;
+
+  F fut_;
+  rc<ref_cell<join_state<output_type>>> state_;
+
+public:
+  spawned_future(F f, rc<ref_cell<join_state<output_type>>> state) noexcept safe
+    : fut_(rel f)
+    , state_(rel state)
+  {
+  }
+
+  // Returns true once the future has completed.
+  bool poll_task(self^, context^ cx) safe {
+    poll_result<output_type> r = mut self->fut_.std2::future::poll(cx);
+    if (r.is_pending()) return false;
+
+    optional<waker> waiter = .none;
+    {
+      auto s = self->state_->borrow_mut();
+      join_state<output_type>^ st = mut *s;
+      st->value = .some(r rel.unwrap());
+      waiter = mut st->waiter.take();
+    }
+
+    if (waiter.is_some()) waiter rel.unwrap().wake();
+    return true;
+  }
+};
+
+// A type-erased spawned_future. The future is destroyed as soon as it
+// completes, the slot itself is recycled by the executor.
+class [[unsafe::send(false)]] local_task
+{
+  void* unsafe p_;
+  bool (*poll_)(void*, waker const*);
+  void (*drop_)(void*);
+
+  template<class F>
+  static bool poll_impl(void* p, waker const* w) {
+    context cx(*w);
+    return mut static_cast<F*>(p)->poll_task(^cx);
+  }
+
+  template<class F>
+  static void drop_impl(void* p) {
+    delete static_cast<F*>(p);
+  }
+
+public:
+  template<class F+>
+  explicit local_task(box<spawned_future<F>> p) noexcept safe
+    : p_(p rel.leak())
+    , unsafe poll_(&poll_impl<spawned_future<F>>)
+    , unsafe drop_(&drop_impl<spawned_future<F>>)
+  {
+  }
+
+  local_task(local_task const^) = delete;
+
+  ~local_task() safe {
+    if (p_)
+      unsafe { drop_(p_); }
+  }
+
+  bool is_done(self const^) noexcept safe {
+    return !self->p_;
+  }
+
+  bool poll(self^, waker const^ w) safe {
+    if (!self->p_) return true;
+
+    unsafe { bool done = self->poll_(self->p_, addr *w); }
+    if (done) {
+      unsafe { self->drop_(self->p_); }
+      self->p_ = nullptr;
+    }
+    return done;
+  }
+};
+
+// A handle for spawning tasks onto a local_executor, including from inside
+// futures the executor is currently polling.
+class [[unsafe::send(false)]] spawner
+{
+  friend class local_executor;
+
+  rc<ref_cell<vector<local_task>>> incoming_;
+
+  explicit spawner(rc<ref_cell<vector<local_task>>> incoming) noexcept safe
+    : incoming_(rel incoming)
+  {
+  }
+
+public:
+  spawner(spawner const^ rhs) safe
+    : incoming_(cpy rhs->incoming_)
+  {
+  }
+
+  template<class F+>
+  join_handle<typename impl<F, future>::output_type> spawn/(where F: static)(self const^, F f) safe
+  requires impl<F, future>
+  {
+    using output_type = typename impl<F, future>::output_type;
+    using state_type = ref_cell<join_state<output_type>>;
+
+    rc<state_type> state{state_type(join_state<output_type>{.none, .none})};
+    box<spawned_future<F>> p{spawned_future<F>(rel f, cpy state)};
+
+    {
+      auto q = self->incoming_->borrow_mut();
+      mut (*q).push_back(local_task(rel p));
+    }
+
+    return join_handle<output_type>(rel state);
+  }
+};
+
+// Blocks the executor's thread until some task may have been woken by an
+// event source outside the executor, such as an I/O reactor.
+interface parker {
+  void park(self const^) safe;
+};
+
+struct no_parker
+{
+  void park(self const^) safe {
+    panic("block_on future can never complete");
+  }
+};
+
+impl no_parker: parker
+{
+  void park(self const^) safe override {
+    self.park();
+  }
+};
+
+// A single-threaded executor. Futures spawned on it need not be send, and
+// their wakers only ever touch this thread's run queue. They must be
+// static, though: a task can outlive the scope that spawned it.
+class [[unsafe::send(false)]] local_executor
+{
+  static constexpr std::size_t main_task = std::size_t(-1);
+
+  vector<local_task> tasks_;
+  vector<std::size_t> free_;
+  rc<ref_cell<vector<std::size_t>>> ready_;
+  spawner spawner_;
+
+  // Moves newly spawned tasks into task slots and schedules them.
+  void admit(self^) safe {
+    vector<local_task> incoming = {};
+    {
+      auto q = self->spawner_.incoming_->borrow_mut();
+      incoming = replace<vector<local_task>>(mut *q, vector<local_task>{});
+    }
+
+    for (local_task t : rel incoming) {
+      std::size_t id = self->tasks_.size();
+      optional<std::size_t> slot = mut self->free_.pop_back();
+      if (slot.is_some()) {
+        id = slot rel.unwrap();
+        (^self->tasks_)[id] = rel t;
+      } else {
+        mut self->tasks_.push_back(rel t);
+      }
+
+      auto q = self->ready_->borrow_mut();
+      mut (*q).push_back(id);
+    }
+  }
+
+public:
+  local_executor() safe
+    : tasks_{}
+    , free_{}
+    , ready_(ref_cell<vector<std::size_t>>(vector<std::size_t>{}))
+    , spawner_(rc<ref_cell<vector<local_task>>>(ref_cell<vector<local_task>>(vector<local_task>{})))
+  {
+  }
+
+  local_executor(local_executor const^) = delete;
+
+  spawner get_spawner(self const^) safe {
+    return cpy self->spawner_;
+  }
+
+  template<class F+>
+  join_handle<typename impl<F, future>::output_type> spawn/(where F: static)(self const^, F f) safe
+  requires impl<F, future>
+  {
+    return self->spawner_.spawn(rel f);
+  }
+
+  // True if no task has been woken or spawned since the last poll_ready.
+  bool is_idle(self const^) safe {
+    return (*self->ready_->borrow()).empty() && (*self->spawner_.incoming_->borrow()).empty();
+  }
+
+  // Polls every task woken since the last call. Returns true if the future
+  // passed to block_on was woken.
+  bool poll_ready(self^) safe {
+    mut self.admit();
+
+    vector<std::size_t> ready = {};
+    {
+      auto q = self->ready_->borrow_mut();
+      ready = replace<vector<std::size_t>>(mut *q, vector<std::size_t>{});
+    }
+
+    bool main_woken = false;
+    for (std::size_t id : ready.iter()) {
+      if (id == main_task) {
+        main_woken = true;
+        continue;
+      }
+
+      waker w(cpy self->ready_, id);
+      local_task^ t = (^self->tasks_)[id];
+      if (t.is_done()) continue;
+
+      if (mut t.poll(w)) {
+        mut self->free_.push_back(id);
+      }
+    }
+
+    return main_woken;
+  }
+
+  // Runs spawned tasks until none of them can make progress.
+  void run(self^) safe {
+    while (!self.is_idle()) {
+      mut self.poll_ready();
+    }
+  }
+
+  // Drives f to completion on the current thread, polling spawned tasks
+  // whenever f is pending.
+  template<class F+>
+  typename impl<F, future>::output_type block_on(self^, F f) safe
+  requires impl<F, future>
+  {
+    return mut self.block_on(rel f, no_parker{});
+  }
+
+  // As above, but when every task is waiting on an external event the
+  // executor blocks in p.park() rather than giving up.
+  template<class F+, class P>
+  typename impl<F, future>::output_type block_on(self^, F f, P const^ p) safe
+  requires impl<F, future> && impl<P, parker>
+  {
+    using output_type = typename impl<F, future>::output_type;
+
+    waker w(cpy self->ready_, main_task);
+    while (true) {
+      {
+        context cx(w);
+        poll_result<output_type> r = mut f.std2::future::poll(^cx);
+        if (r.is_ready()) return r rel.unwrap();
+      }
+
+      while (!mut self.poll_ready()) {
+        if (self.is_idle()) p.std2::parker::park();
+      }
+    }
+  }
+};
+
+#if defined(__linux__)
+
+////////////////////////////////////////////////////////////////////////////////
+// io/error.h
+
+using u8 = std::uint8_t;
+
+namespace io
+{
+
+// An errno value captured from a failed system call.
+class error
+{
+  int code_;
+
+public:
+  explicit error(int code) noexcept safe
+    : code_(code)
+  {
+  }
+
+  static error last_os_error() noexcept safe {
+    unsafe { return error(errno); }
+  }
+
+  int raw_os_error(self const^) noexcept safe {
+    return self->code_;
+  }
+
+  bool is_would_block(self const^) noexcept safe {
+    return self->code_ == EAGAIN || self->code_ == EWOULDBLOCK;
+  }
+
+  bool is_interrupted(self const^) noexcept safe {
+    return self->code_ == EINTR;
+  }
+
+  str message(self const^) noexcept safe {
+    unsafe { char const* msg = strerror(self->code_); }
+    unsafe { return str(slice_from_raw_parts(msg, std::strlen(msg)), str::no_utf_check{}); }
+  }
+};
+
+template<class T+>
+using result = expected<T, error>;
+
+template<class T>
+bool is_would_block(result<T> const^ r) noexcept safe {
+  return match(*r) {
+    .ok(_)  => false;
+    .err(e) => e.is_would_block();
+  };
+}
+
+// Gather and scatter calls take at most this many buffers. Longer lists
+// are cut short and the caller sees a short count, as with any other
+// partial read or write.
+inline constexpr std::size_t max_iovecs = 64;
+
+template<class B>
+std::size_t to_iovecs(const [B; dyn]^ bufs, iovec* out) noexcept
+{
+  std::size_t n = (*bufs)~length;
+  if (n > max_iovecs) n = max_iovecs;
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i].iov_base = const_cast<u8*>(static_cast<u8 const*>((*(*bufs)[i])~as_pointer));
+    out[i].iov_len = (*(*bufs)[i])~length;
+  }
+  return n;
+}
+
+} // namespace io
+
+////////////////////////////////////////////////////////////////////////////////
+// net.h
+
+namespace net
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// net/reactor.h
+
+// An epoll-based readiness reactor for use with local_executor. Sockets stay
+// out of the epoll set until a task is actually blocked on them, and then are
+// armed one-shot for whichever directions have a waiting task, which keeps
+// registrations correct when file descriptors are closed and reused.
+class [[unsafe::send(false)]] reactor
+{
+  struct waiters
+  {
+    optional<waker> read;
+    optional<waker> write;
+  };
+
+  struct reactor_inner
+  {
+    int epfd_;
+    ref_cell<vector<waiters>> waiters_;
+
+    explicit reactor_inner(int epfd) noexcept safe
+      : epfd_(epfd)
+      , waiters_(vector<waiters>{})
+    {
+    }
+
+    ~reactor_inner() safe {
+      unsafe { ::close(epfd_); }
+    }
+  };
+
+  rc<reactor_inner> p_;
+
+  explicit reactor(rc<reactor_inner> p) noexcept safe
+    : p_(rel p)
+  {
+  }
+
+  void arm(self const^, int fd, bool read, bool write) safe {
+    std::uint32_t events = EPOLLONESHOT | EPOLLRDHUP;
+    if (read) events |= EPOLLIN;
+    if (write) events |= EPOLLOUT;
+
+    unsafe { epoll_event ev{}; }
+    unsafe { ev.events = events; }
+    unsafe { ev.data.fd = fd; }
+
+    unsafe { int r = ::epoll_ctl(self->p_->epfd_, EPOLL_CTL_MOD, fd, addr ev); }
+    if (r < 0 && io::error::last_os_error().raw_os_error() == ENOENT) {
+      unsafe { r = ::epoll_ctl(self->p_->epfd_, EPOLL_CTL_ADD, fd, addr ev); }
+    }
+    if (r < 0) panic("epoll_ctl failed to register a file descriptor");
+  }
+
+  void watch(self const^, int fd, waker w, bool write) safe {
+    bool want_read = false;
+    bool want_write = false;
+    {
+      auto b = self->p_->waiters_.borrow_mut();
+      vector<waiters>^ ws = mut *b;
+
+      std::size_t const idx = static_cast<std::size_t>(fd);
+      while (ws.size() <= idx) {
+        mut ws.push_back(waiters{.none, .none});
+      }
+
+      waiters^ slot = mut ws[idx];
+      if (write) slot->write = .some(rel w);
+      else slot->read = .some(rel w);
+
+      want_read = slot->read.is_some();
+      want_write = slot->write.is_some();
+    }
+    self.arm(fd, want_read, want_write);
+  }
+
+public:
+  static io::result<reactor> create() safe {
+    unsafe { int epfd = ::epoll_create1(EPOLL_CLOEXEC); }
+    if (epfd < 0) return .err(io::error::last_os_error());
+    return .ok(reactor(rc<reactor_inner>(reactor_inner(epfd))));
+  }
+
+  reactor(reactor const^ rhs) safe
+    : p_(cpy rhs->p_)
+  {
+  }
+
+  void watch_read(self const^, int fd, waker w) safe {
+    self.watch(fd, rel w, false);
+  }
+
+  void watch_write(self const^, int fd, waker w) safe {
+    self.watch(fd, rel w, true);
+  }
+
+  // Waits up to timeout_ms (-1 blocks indefinitely) for readiness events and
+  // wakes the tasks blocked on them. Returns the number of tasks woken.
+  std::size_t turn(self const^, int timeout_ms) safe {
+    static constexpr int max_events = 64;
+    unsafe { epoll_event events[max_events]; }
+
+    int n = -1;
+    while (n < 0) {
+      unsafe { n = ::epoll_wait(self->p_->epfd_, events, max_events, timeout_ms); }
+      if (n < 0 && !io::error::last_os_error().is_interrupted()) panic("epoll_wait failed");
+    }
+
+    vector<waker> woken = {};
+    for (int i = 0; i < n; ++i) {
+      unsafe { std::uint32_t const ev = events[i].events; }
+      unsafe { int const fd = events[i].data.fd; }
+
+      bool const readable = ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR);
+      bool const writable = ev & (EPOLLOUT | EPOLLHUP | EPOLLERR);
+
+      bool rearm_read = false;
+      bool rearm_write = false;
+      {
+        auto b = self->p_->waiters_.borrow_mut();
+        vector<waiters>^ ws = mut *b;
+        waiters^ slot = mut ws[static_cast<std::size_t>(fd)];
+
+        if (readable) {
+          optional<waker> w = mut slot->read.take();
+          if (w.is_some()) mut woken.push_back(w rel.unwrap());
+        }
+        if (writable) {
+          optional<waker> w = mut slot->write.take();
+          if (w.is_some()) mut woken.push_back(w rel.unwrap());
+        }
+
+        rearm_read = slot->read.is_some();
+        rearm_write = slot->write.is_some();
+      }
+
+      // One-shot disarmed the fd; re-arm for a direction still waiting.
+      if (rearm_read || rearm_write) self.arm(fd, rearm_read, rearm_write);
+    }
+
+    std::size_t const count = woken.size();
+    for (waker w : rel woken) {
+      w.wake();
+    }
+    return count;
   }
+};
 
-  T* get(self const^) noexcept safe {
-    return self->p_;
+impl reactor: parker
+{
+  void park(self const^) safe override {
+    self.turn(-1);
   }
+};
 
-  T* leak(self) noexcept safe {
-    auto p = self.p_;
-    forget(rel self);
-    return p;
+class socket_address
+{
+  sockaddr_storage unsafe storage_;
+  socklen_t len_;
+
+  socket_address() noexcept safe
+    : unsafe storage_()
+    , len_(0)
+  {
   }
 
-  T into_inner(self) noexcept safe {
-    unsafe { T t = __rel_read(self.p_); }
-    unsafe { ::operator delete(self.p_); }
-    return rel t;
+  friend class tcp_listener;
+  friend class tcp_stream;
+  friend class udp_socket;
+
+public:
+  static socket_address v4(u8 a, u8 b, u8 c, u8 d, std::uint16_t port) noexcept safe {
+    socket_address sa{};
+    unsafe {
+      sockaddr_in* sin = reinterpret_cast<sockaddr_in*>(addr sa.storage_);
+      sin->sin_family = AF_INET;
+      sin->sin_port = htons(port);
+      sin->sin_addr.s_addr = htonl(
+        (std::uint32_t(a) << 24) | (std::uint32_t(b) << 16) |
+        (std::uint32_t(c) << 8) | std::uint32_t(d));
+    }
+    sa.len_ = sizeof(sockaddr_in);
+    return sa;
   }
-};
 
-////////////////////////////////////////////////////////////////////////////////
-// unique_ptr.h
+  static socket_address loopback_v4(std::uint16_t port) noexcept safe {
+    return v4(127, 0, 0, 1, port);
+  }
 
-template<class T+>
-using unique_ptr = optional<box<T>>;
+  std::uint16_t port(self const^) noexcept safe {
+    unsafe {
+      if (self->storage_.ss_family == AF_INET6)
+        return ntohs(reinterpret_cast<sockaddr_in6 const*>(addr self->storage_)->sin6_port);
+      return ntohs(reinterpret_cast<sockaddr_in const*>(addr self->storage_)->sin_port);
+    }
+  }
 
-////////////////////////////////////////////////////////////////////////////////
-// cell.h
+  int family(self const^) noexcept safe {
+    unsafe { return self->storage_.ss_family; }
+  }
 
-template<class T+>
-class [[unsafe::sync(false)]] cell
-{
-  unsafe_cell<T> t_;
+  sockaddr const* as_ptr(self const^) noexcept safe {
+    unsafe { return reinterpret_cast<sockaddr const*>(addr self->storage_); }
+  }
 
-  public:
+  socklen_t size(self const^) noexcept safe {
+    return self->len_;
+  }
+};
 
-  explicit cell(T t) noexcept safe
-    requires(T~is_trivially_copyable && T~is_trivially_destructible)
-    : t_(rel t)
+// Shared by the socket types: an owned file descriptor.
+class socket_fd
+{
+  int fd_;
+
+public:
+  explicit socket_fd(int fd) noexcept
+    : fd_(fd)
   {
   }
 
-  T get(self const^) safe {
-    // rely on implicit copy operator erroring out for types with non-trivial
-    // destructors or types that have user-defined copy constructors
-    unsafe { return cpy *self->t_.get(); }
+  socket_fd(socket_fd const^) = delete;
+
+  ~socket_fd() safe {
+    if (fd_ >= 0)
+      unsafe { ::close(fd_); }
   }
 
-  void set(self const^, T t) safe {
-    unsafe { *self->t_.get() = rel t; }
+  static io::result<socket_fd> open(int family, int type) safe {
+    unsafe { int fd = ::socket(family, type | SOCK_CLOEXEC, 0); }
+    if (fd < 0) return .err(io::error::last_os_error());
+    unsafe { return .ok(socket_fd(fd)); }
   }
 
-  T replace(self const^, T t) noexcept safe {
-    unsafe { auto old = __rel_read(self->t_.get()); }
-    unsafe { __rel_write(self->t_.get(), rel t); }
-    return old;
+  int get(self const^) noexcept safe {
+    return self->fd_;
+  }
+
+  io::result<unit> set_nonblocking(self const^, bool nonblocking) safe {
+    unsafe { int flags = ::fcntl(self->fd_, F_GETFL); }
+    if (flags < 0) return .err(io::error::last_os_error());
+
+    flags = nonblocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    unsafe { int r = ::fcntl(self->fd_, F_SETFL, flags); }
+    if (r < 0) return .err(io::error::last_os_error());
+    return .ok(unit{});
+  }
+
+  io::result<unit> set_option(self const^, int level, int name, int value) safe {
+    unsafe { int r = ::setsockopt(self->fd_, level, name, addr value, sizeof(value)); }
+    if (r < 0) return .err(io::error::last_os_error());
+    return .ok(unit{});
+  }
+
+  // A connect interrupted by a signal keeps going in the kernel, and
+  // calling connect again would only report EALREADY or EISCONN. Wait for
+  // the socket to become writable and read the outcome from SO_ERROR
+  // instead.
+  io::result<unit> connect(self const^, socket_address const^ address) safe {
+    unsafe { int r = ::connect(self->fd_, address.as_ptr(), address.size()); }
+    if (r == 0) return .ok(unit{});
+
+    auto e = io::error::last_os_error();
+    if (!e.is_interrupted()) return .err(e);
+
+    pollfd p{};
+    p.fd = self->fd_;
+    p.events = POLLOUT;
+    while (true) {
+      unsafe { int n = ::poll(addr p, 1, -1); }
+      if (n >= 0) break;
+
+      auto pe = io::error::last_os_error();
+      if (!pe.is_interrupted()) return .err(pe);
+    }
+
+    int so_error = 0;
+    socklen_t len = sizeof(so_error);
+    unsafe { int g = ::getsockopt(self->fd_, SOL_SOCKET, SO_ERROR, addr so_error, addr len); }
+    if (g < 0) return .err(io::error::last_os_error());
+    if (so_error != 0) return .err(io::error(so_error));
+    return .ok(unit{});
+  }
+
+  io::result<socket_address> local_addr(self const^) safe {
+    socket_address a{};
+    a.len_ = sizeof(sockaddr_storage);
+    unsafe { int r = ::getsockname(self->fd_, reinterpret_cast<sockaddr*>(addr a.storage_), addr a.len_); }
+    if (r < 0) return .err(io::error::last_os_error());
+    return .ok(rel a);
+  }
+
+  io::result<socket_address> peer_addr(self const^) safe {
+    socket_address a{};
+    a.len_ = sizeof(sockaddr_storage);
+    unsafe { int r = ::getpeername(self->fd_, reinterpret_cast<sockaddr*>(addr a.storage_), addr a.len_); }
+    if (r < 0) return .err(io::error::last_os_error());
+    return .ok(rel a);
+  }
+
+  io::result<std::size_t> recv(self const^, [u8; dyn]^ buf, int flags) safe {
+    while (true) {
+      unsafe { auto n = ::recv(self->fd_, (*buf)~as_pointer, (*buf)~length, flags); }
+      if (n >= 0) return .ok(static_cast<std::size_t>(n));
+
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
+    }
+  }
+
+  io::result<std::size_t> send(self const^, const [u8; dyn]^ buf, int flags) safe {
+    while (true) {
+      unsafe { auto n = ::send(self->fd_, (*buf)~as_pointer, (*buf)~length, flags | MSG_NOSIGNAL); }
+      if (n >= 0) return .ok(static_cast<std::size_t>(n));
+
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
+    }
+  }
+
+  io::result<std::size_t> recv_vectored(self const^, [[u8; dyn]^; dyn]^ bufs) safe {
+    unsafe {
+      iovec iov[io::max_iovecs];
+      msghdr msg{};
+      msg.msg_iov = iov;
+      msg.msg_iovlen = io::to_iovecs(bufs, iov);
+    }
+    while (true) {
+      unsafe { auto n = ::recvmsg(self->fd_, addr msg, 0); }
+      if (n >= 0) return .ok(static_cast<std::size_t>(n));
+
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
+    }
+  }
+
+  // sendmsg rather than writev, so a closed peer is an EPIPE error instead
+  // of SIGPIPE.
+  io::result<std::size_t> send_vectored(self const^, const [const [u8; dyn]^; dyn]^ bufs) safe {
+    unsafe {
+      iovec iov[io::max_iovecs];
+      msghdr msg{};
+      msg.msg_iov = iov;
+      msg.msg_iovlen = io::to_iovecs(bufs, iov);
+    }
+    while (true) {
+      unsafe { auto n = ::sendmsg(self->fd_, addr msg, MSG_NOSIGNAL); }
+      if (n >= 0) return .ok(static_cast<std::size_t>(n));
+
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
+    }
   }
 };
 
-////////////////////////////////////////////////////////////////////////////////
-// initializer_list.h
+class tcp_stream
+{
+  friend class tcp_listener;
 
-template<class T+>
-class initializer_list/(a) {
-  // Point to byte data on the stack.
-  T* unsafe _cur;
-  T* _end;
-  T^/a __phantom_data;
+  socket_fd fd_;
 
-  explicit
-  initializer_list([T; dyn]^/a data) noexcept safe :
-    _cur((*data)~as_pointer),
-    unsafe _end((*data)~as_pointer + (*data)~length) { }
+  explicit tcp_stream(socket_fd fd) noexcept safe
+    : fd_(rel fd)
+  {
+  }
 
 public:
-  // compiler-provided
-  // must live in namespace std2
+  // Connects in blocking mode. Call set_nonblocking afterwards to use the
+  // stream with a reactor.
+  static io::result<tcp_stream> connect(socket_address const^ address) safe {
+    io::result<socket_fd> m_fd = socket_fd::open(address.family(), SOCK_STREAM);
+    if (!m_fd.is_ok()) return .err(m_fd rel.unwrap_err());
+    socket_fd fd = m_fd rel.unwrap();
 
-  initializer_list() noexcept safe : _cur(nullptr), _end(nullptr) { }
-  initializer_list(const initializer_list&) = delete;
-  initializer_list& operator=(const initializer_list&) = delete;
+    io::result<unit> r = fd.connect(address);
+    if (!r.is_ok()) return .err(r rel.unwrap_err());
+    return .ok(tcp_stream(rel fd));
+  }
 
-  ~initializer_list() safe requires(T~is_trivially_destructible) = default;
+  int as_raw_fd(self const^) noexcept safe {
+    return self->fd_.get();
+  }
 
-  [[unsafe::drop_only(T)]]
-  ~initializer_list() safe requires(!T~is_trivially_destructible) {
-    std::destroy_n(_cur, _end - _cur);
+  io::result<std::size_t> read(self^, [u8; dyn]^ buf) safe {
+    return self->fd_.recv(buf, 0);
   }
 
-  [T; dyn]^ slice(self^) noexcept safe {
-    return slice_from_raw_parts(self->_cur, self->size());
+  io::result<std::size_t> write(self^, const [u8; dyn]^ buf) safe {
+    return self->fd_.send(buf, 0);
   }
 
-  const [T; dyn]^ slice(const self^) noexcept safe {
-    return slice_from_raw_parts(self->_cur, self->size());
+  io::result<std::size_t> read_vectored(self^, [[u8; dyn]^; dyn]^ bufs) safe {
+    return self->fd_.recv_vectored(bufs);
   }
 
-  optional<T> next(self^) noexcept safe {
-    if(self->_cur != self->_end)
-      return .some(__rel_read(self->_cur++));
-    else
-      return .none;
+  io::result<std::size_t> write_vectored(self^, const [const [u8; dyn]^; dyn]^ bufs) safe {
+    return self->fd_.send_vectored(bufs);
   }
 
-  T* data(self^) noexcept safe {
-    return self->_cur;
+  // Writes the whole buffer, looping over short writes.
+  io::result<unit> write_all(self^, const [u8; dyn]^ buf) safe {
+    std::size_t pos = 0;
+    std::size_t const len = (*buf)~length;
+    while (pos < len) {
+      unsafe { auto rest = slice_from_raw_parts((*buf)~as_pointer + pos, len - pos); }
+      io::result<std::size_t> r = mut self.write(rest);
+      if (!r.is_ok()) return .err(r rel.unwrap_err());
+      pos += r rel.unwrap();
+    }
+    return .ok(unit{});
   }
 
-  const T* data(const self^) noexcept safe {
-    return self->_cur;
+  io::result<unit> shutdown_write(self const^) safe {
+    unsafe { int r = ::shutdown(self->fd_.get(), SHUT_WR); }
+    if (r < 0) return .err(io::error::last_os_error());
+    return .ok(unit{});
   }
 
-  std::size_t size(const self^) noexcept safe {
-    return (std::size_t)(self->_end - self->_cur);
+  io::result<unit> set_nonblocking(self const^, bool nonblocking) safe {
+    return self->fd_.set_nonblocking(nonblocking);
   }
 
-  // Unsafe call to advance. Use this after relocating data out of
-  // data().
-  void advance(self^, std::size_t size) noexcept {
-    self->_cur += static_cast<std::ptrdiff_t>(size);
+  io::result<unit> set_nodelay(self const^, bool nodelay) safe {
+    return self->fd_.set_option(IPPROTO_TCP, TCP_NODELAY, nodelay ? 1 : 0);
   }
-};
 
-////////////////////////////////////////////////////////////////////////////////
-// string.h
+  io::result<socket_address> local_addr(self const^) safe {
+    return self->fd_.local_addr();
+  }
 
-template<class CharT>
-class basic_string;
+  io::result<socket_address> peer_addr(self const^) safe {
+    return self->fd_.peer_addr();
+  }
 
-using string    = basic_string<char>;
-using wstring   = basic_string<wchar_t>;
-using u8string  = basic_string<char8_t>;
-using u16string = basic_string<char16_t>;
-using u32string = basic_string<char32_t>;
+  // Async mode: the stream must be non-blocking. Returns pending and
+  // registers the task with r if the read would block.
+  poll_result<io::result<std::size_t>>
+  poll_read(self^, context^ cx, reactor const^ r, [u8; dyn]^ buf) safe {
+    io::result<std::size_t> res = mut self.read(buf);
+    if (io::is_would_block(res)) {
+      r.watch_read(self.as_raw_fd(), cpy *cx.get_waker());
+      return .pending;
+    }
+    return .ready(rel res);
+  }
 
-template<class CharT>
-class [[unsafe::send, unsafe::sync]]
-  __attribute__((preferred_name(string)))
-  __attribute__((preferred_name(wstring)))
-  __attribute__((preferred_name(u8string)))
-  __attribute__((preferred_name(u16string)))
-  __attribute__((preferred_name(u32string)))
-basic_string
+  poll_result<io::result<std::size_t>>
+  poll_write(self^, context^ cx, reactor const^ r, const [u8; dyn]^ buf) safe {
+    io::result<std::size_t> res = mut self.write(buf);
+    if (io::is_would_block(res)) {
+      r.watch_write(self.as_raw_fd(), cpy *cx.get_waker());
+      return .pending;
+    }
+    return .ready(rel res);
+  }
+};
+
+class tcp_listener
 {
-  public:
+  socket_fd fd_;
 
-  using value_type = CharT;
-  using size_type = std::size_t;
+  explicit tcp_listener(socket_fd fd) noexcept safe
+    : fd_(rel fd)
+  {
+  }
 
-  static_assert(value_type~is_trivially_destructible);
+public:
+  static io::result<tcp_listener> bind(socket_address const^ address, int backlog = 128) safe {
+    io::result<socket_fd> m_fd = socket_fd::open(address.family(), SOCK_STREAM);
+    if (!m_fd.is_ok()) return .err(m_fd rel.unwrap_err());
+    socket_fd fd = m_fd rel.unwrap();
 
-  basic_string() safe
-    : p_(nullptr)
-    , size_{0}
-    , capacity_{0}
-  {
+    io::result<unit> o = fd.set_option(SOL_SOCKET, SO_REUSEADDR, 1);
+    if (!o.is_ok()) return .err(o rel.unwrap_err());
+
+    unsafe { int r = ::bind(fd.get(), address.as_ptr(), address.size()); }
+    if (r < 0) return .err(io::error::last_os_error());
+
+    unsafe { r = ::listen(fd.get(), backlog); }
+    if (r < 0) return .err(io::error::last_os_error());
+
+    return .ok(tcp_listener(rel fd));
   }
 
-  // Make expensive converting ctors explicit.
-  // The user should know they're doing a heap allocation.
-  explicit
-  basic_string(string_constant<value_type> sc) safe
-    : basic_string(basic_string_view<value_type>(sc))
-  {
+  int as_raw_fd(self const^) noexcept safe {
+    return self->fd_.get();
   }
 
-  explicit
-  basic_string(basic_string_view<value_type> sv) safe
-    : basic_string()
-  {
-    if (sv.empty()) return;
+  io::result<tcp_stream> accept(self const^) safe {
+    while (true) {
+      unsafe { int fd = ::accept4(self->fd_.get(), nullptr, nullptr, SOCK_CLOEXEC); }
+      if (fd >= 0) {
+        unsafe { return .ok(tcp_stream(socket_fd(fd))); }
+      }
 
-    auto n = sv.size() * sizeof(value_type);
-    unsafe { p_ = static_cast<value_type*>(::operator new(n)); }
-    unsafe { std::memcpy(p_, sv.data(), n); }
-    size_ = sv.size();
-    capacity_ = sv.size();
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
+    }
   }
 
-  explicit
-  basic_string(const [value_type; dyn]^ init) safe
-    : basic_string(basic_string_view<value_type>(init))
-  {
+  io::result<unit> set_nonblocking(self const^, bool nonblocking) safe {
+    return self->fd_.set_nonblocking(nonblocking);
   }
 
-  basic_string(basic_string const^ rhs) safe :
-    basic_string(rhs.str())
-  {
+  io::result<socket_address> local_addr(self const^) safe {
+    return self->fd_.local_addr();
   }
 
-  ~basic_string() safe {
-    if (p_)
-      unsafe { operator delete(p_); }
+  // Async mode: accepted streams are returned in blocking mode.
+  poll_result<io::result<tcp_stream>>
+  poll_accept(self const^, context^ cx, reactor const^ r) safe {
+    io::result<tcp_stream> res = self.accept();
+    if (io::is_would_block(res)) {
+      r.watch_read(self.as_raw_fd(), cpy *cx.get_waker());
+      return .pending;
+    }
+    return .ready(rel res);
   }
+};
 
-  const [value_type; dyn]^ slice(self const^) noexcept safe {
-    unsafe { return slice_from_raw_parts(self.data(), self.size()); }
+class udp_socket
+{
+  socket_fd fd_;
+
+  explicit udp_socket(socket_fd fd) noexcept safe
+    : fd_(rel fd)
+  {
   }
 
-  basic_string_view<value_type> str(self const^) noexcept safe {
-    using no_utf_check = typename basic_string_view<value_type>::no_utf_check;
-    unsafe { return basic_string_view<value_type>(self.slice(), no_utf_check{}); }
+public:
+  static io::result<udp_socket> bind(socket_address const^ address) safe {
+    io::result<socket_fd> m_fd = socket_fd::open(address.family(), SOCK_DGRAM);
+    if (!m_fd.is_ok()) return .err(m_fd rel.unwrap_err());
+    socket_fd fd = m_fd rel.unwrap();
+
+    unsafe { int r = ::bind(fd.get(), address.as_ptr(), address.size()); }
+    if (r < 0) return .err(io::error::last_os_error());
+
+    return .ok(udp_socket(rel fd));
   }
 
-  operator basic_string_view<value_type>(self const^) noexcept safe {
-    return self.str();
+  int as_raw_fd(self const^) noexcept safe {
+    return self->fd_.get();
   }
 
-  value_type const* data(self const^) noexcept safe {
-    return self->p_;
+  // Sets the default destination for send and the only source for recv.
+  io::result<unit> connect(self const^, socket_address const^ address) safe {
+    return self->fd_.connect(address);
   }
 
-  size_type size(self const^) noexcept safe {
-    return self->size_;
+  io::result<std::size_t> send(self const^, const [u8; dyn]^ buf) safe {
+    return self->fd_.send(buf, 0);
   }
 
-  size_type capacity(self const^) noexcept safe {
-    return self->capacity_;
+  io::result<std::size_t> recv(self const^, [u8; dyn]^ buf) safe {
+    return self->fd_.recv(buf, 0);
   }
 
-  void append(self^, basic_string_view<value_type> rhs) safe {
-    if (auto len = self.size() + rhs.size(); len > self.capacity()) {
-      unsafe { auto p = static_cast<value_type*>(::operator new(len * sizeof(value_type))); }
-      unsafe { std::memcpy(p, self.data(), self.size() * sizeof(value_type)); }
-      unsafe { ::operator delete(self->p_); }
+  io::result<std::size_t> send_to(self const^, const [u8; dyn]^ buf, socket_address const^ address) safe {
+    while (true) {
+      unsafe {
+        auto n = ::sendto(
+          self->fd_.get(), (*buf)~as_pointer, (*buf)~length, MSG_NOSIGNAL,
+          address.as_ptr(), address.size());
+      }
+      if (n >= 0) return .ok(static_cast<std::size_t>(n));
 
-      self->p_ = p;
-      self->capacity_ = len;
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
     }
+  }
 
-    unsafe { std::memcpy(self->p_ + self.size(), rhs.data(), rhs.size() * sizeof(value_type)); };
-    self->size_ += rhs.size();
+  io::result<(std::size_t, socket_address)> recv_from(self const^, [u8; dyn]^ buf) safe {
+    while (true) {
+      socket_address from{};
+      from.len_ = sizeof(sockaddr_storage);
+      unsafe {
+        auto n = ::recvfrom(
+          self->fd_.get(), (*buf)~as_pointer, (*buf)~length, 0,
+          reinterpret_cast<sockaddr*>(addr from.storage_), addr from.len_);
+      }
+      if (n >= 0) return .ok((static_cast<std::size_t>(n), rel from));
+
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
+    }
+  }
+
+  io::result<unit> set_nonblocking(self const^, bool nonblocking) safe {
+    return self->fd_.set_nonblocking(nonblocking);
+  }
+
+  io::result<socket_address> local_addr(self const^) safe {
+    return self->fd_.local_addr();
+  }
+
+  poll_result<io::result<std::size_t>>
+  poll_recv(self const^, context^ cx, reactor const^ r, [u8; dyn]^ buf) safe {
+    io::result<std::size_t> res = self.recv(buf);
+    if (io::is_would_block(res)) {
+      r.watch_read(self.as_raw_fd(), cpy *cx.get_waker());
+      return .pending;
+    }
+    return .ready(rel res);
   }
 
-  basic_string operator+(self const^, basic_string_view<value_type> rhs) safe {
-    basic_string s = cpy self;
-    mut s.append(rhs);
-    drp self;
-    return rel s;
+  poll_result<io::result<std::size_t>>
+  poll_send(self const^, context^ cx, reactor const^ r, const [u8; dyn]^ buf) safe {
+    io::result<std::size_t> res = self.send(buf);
+    if (io::is_would_block(res)) {
+      r.watch_write(self.as_raw_fd(), cpy *cx.get_waker());
+      return .pending;
+    }
+    return .ready(rel res);
   }
-
-  private:
-  value_type* unsafe p_;
-  size_type size_;
-  size_type capacity_;
 };
 
-namespace literals
-{
-namespace string_literals
-{
+} // namespace net
 
-inline
-auto operator""s2(char const* p, std::size_t len) noexcept safe -> string
+////////////////////////////////////////////////////////////////////////////////
+// io/uring.h
+
+namespace io
 {
-  unsafe { return string(slice_from_raw_parts(p, len)); }
-}
 
-inline
-auto operator""s2(char8_t const* p, std::size_t len) noexcept safe -> u8string
+// Names a file descriptor previously passed to uring::register_files.
+struct fixed_file
 {
-  unsafe { return u8string(slice_from_raw_parts(p, len)); }
-}
+  std::uint32_t index;
+};
 
-inline
-auto operator""s2(char16_t const* p, std::size_t len) noexcept safe -> u16string
+// The result of one operation submitted to a uring. Buffers moved into the
+// ring with an operation are handed back here once the kernel is done with
+// them.
+struct completion
 {
-  unsafe { return u16string(slice_from_raw_parts(p, len)); }
-}
+  std::uint64_t user_data;
+  result<std::size_t> res;
+  optional<vector<u8>> buffer;
+};
 
-inline
-auto operator""s2(char32_t const* p, std::size_t len) noexcept safe -> u32string
+// Returned when an operation on an owned buffer couldn't be queued. The
+// kernel never saw the buffer, so it goes back to the caller, who can retry
+// once the ring has drained.
+struct queue_error
 {
-  unsafe { return u32string(slice_from_raw_parts(p, len)); }
-}
+  error err;
+  vector<u8> buffer;
+};
 
-inline
-auto operator""s2(wchar_t const* p, std::size_t len) noexcept safe -> wstring
+// A submission/completion queue pair over io_uring(7).
+//
+// Operations on caller-owned memory take the buffer by value: the vector is
+// owned by the ring while the kernel may touch it and comes back in the
+// matching completion, so no borrow of it can be alive during the I/O.
+// Registered buffers stay owned by the ring for as long as they are
+// registered and can only be borrowed while no operation is using them.
+//
+// If the kernel doesn't support io_uring, or it's disallowed by seccomp, the
+// ring falls back to performing each operation synchronously with the
+// blocking system calls and queueing the completions.
+class [[unsafe::send, unsafe::sync(false)]] uring
 {
-  unsafe { return wstring(slice_from_raw_parts(p, len)); }
-}
+  struct op_slot
+  {
+    std::uint64_t user_data;
+    optional<vector<u8>> buffer;
+    std::size_t fixed_buffer;
+  };
 
-} // namespace string_literals
-} // namespace literals
+  static constexpr std::size_t no_fixed_buffer = std::size_t(-1);
+
+  int fd_;
+
+  void* unsafe sq_ptr_;
+  std::size_t sq_len_;
+  void* unsafe cq_ptr_;
+  std::size_t cq_len_;
+  io_uring_sqe* unsafe sqes_;
+  std::size_t sqes_len_;
+
+  unsigned* unsafe sq_head_;
+  unsigned* unsafe sq_tail_;
+  unsigned* unsafe sq_array_;
+  unsigned sq_mask_;
+  unsigned sq_entries_;
+  unsigned* unsafe cq_head_;
+  unsigned* unsafe cq_tail_;
+  io_uring_cqe* unsafe cqes_;
+  unsigned cq_mask_;
+
+  // SQEs written to the ring but not yet passed to io_uring_enter.
+  unsigned unsubmitted_;
+
+  vector<optional<op_slot>> slots_;
+  vector<std::size_t> free_slots_;
+  std::size_t inflight_;
+
+  vector<optional<completion>> fallback_;
+  std::size_t fallback_head_;
+  vector<int> files_;
+  vector<vector<u8>> buffers_;
+  vector<std::size_t> buffer_users_;
+
+  uring() noexcept safe
+    : fd_(-1)
+    , sq_ptr_(nullptr), sq_len_(0)
+    , cq_ptr_(nullptr), cq_len_(0)
+    , sqes_(nullptr), sqes_len_(0)
+    , sq_head_(nullptr), sq_tail_(nullptr), sq_array_(nullptr)
+    , sq_mask_(0), sq_entries_(0)
+    , cq_head_(nullptr), cq_tail_(nullptr), cqes_(nullptr), cq_mask_(0)
+    , unsubmitted_(0)
+    , slots_{}, free_slots_{}, inflight_(0)
+    , fallback_{}, fallback_head_(0), files_{}, buffers_{}, buffer_users_{}
+  {
+  }
 
-////////////////////////////////////////////////////////////////////////////////
-// io.h
+  static int sys_setup(unsigned entries, io_uring_params* p) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+  }
 
-inline void println(string_view sv) noexcept safe
-{
-  unsafe { printf("%.*s\n", sv.size(), sv.data()); }
-}
+  static int sys_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) noexcept {
+    return static_cast<int>(
+      ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+  }
 
-inline void println(string_constant<char> sc) noexcept safe
-{
-  println(sc.text());
-}
+  static int sys_register(int fd, unsigned opcode, void const* arg, unsigned nr_args) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+  }
 
-inline void println(const std::string^ s) noexcept safe {
-  unsafe { printf("%s\n", s->c_str()); }
-}
+  // Maps the rings. Returns false and leaves the ring in fallback mode on
+  // any failure.
+  bool setup(self^, std::uint32_t entries) safe {
+    unsafe { io_uring_params p{}; }
+    unsafe { int fd = sys_setup(entries, addr p); }
+    if (fd < 0) return false;
 
-inline void println(signed char x) noexcept safe
-{
-  unsafe { printf("%hhd\n", x); }
-}
+    unsafe {
+      self->sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+      self->cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+      bool const single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+      if (single_mmap) {
+        self->sq_len_ = std::max(self->sq_len_, self->cq_len_);
+        self->cq_len_ = self->sq_len_;
+      }
 
-inline void println(short x) noexcept safe
-{
-  unsafe { printf("%hd\n", x); }
-}
+      void* sq = ::mmap(nullptr, self->sq_len_, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+      if (sq == MAP_FAILED) {
+        ::close(fd);
+        return false;
+      }
 
-inline void println(int x) noexcept safe
-{
-  unsafe { printf("%d\n", x); }
-}
+      void* cq = sq;
+      if (!single_mmap) {
+        cq = ::mmap(nullptr, self->cq_len_, PROT_READ | PROT_WRITE,
+          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+          ::munmap(sq, self->sq_len_);
+          ::close(fd);
+          return false;
+        }
+      }
 
-inline void println(long int x) noexcept safe
-{
-  unsafe { printf("%ld\n", x); }
-}
+      self->sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+      void* sqes = ::mmap(nullptr, self->sqes_len_, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+      if (sqes == MAP_FAILED) {
+        if (cq != sq) ::munmap(cq, self->cq_len_);
+        ::munmap(sq, self->sq_len_);
+        ::close(fd);
+        return false;
+      }
 
-inline void println(long long int x) noexcept safe
-{
-  unsafe { printf("%lld\n", x); }
-}
+      char* sqb = static_cast<char*>(sq);
+      char* cqb = static_cast<char*>(cq);
+
+      self->fd_ = fd;
+      self->sq_ptr_ = sq;
+      self->cq_ptr_ = (cq == sq) ? nullptr : cq;
+      self->sqes_ = static_cast<io_uring_sqe*>(sqes);
+      self->sq_head_ = reinterpret_cast<unsigned*>(sqb + p.sq_off.head);
+      self->sq_tail_ = reinterpret_cast<unsigned*>(sqb + p.sq_off.tail);
+      self->sq_array_ = reinterpret_cast<unsigned*>(sqb + p.sq_off.array);
+      self->sq_mask_ = *reinterpret_cast<unsigned*>(sqb + p.sq_off.ring_mask);
+      self->sq_entries_ = *reinterpret_cast<unsigned*>(sqb + p.sq_off.ring_entries);
+      self->cq_head_ = reinterpret_cast<unsigned*>(cqb + p.cq_off.head);
+      self->cq_tail_ = reinterpret_cast<unsigned*>(cqb + p.cq_off.tail);
+      self->cqes_ = reinterpret_cast<io_uring_cqe*>(cqb + p.cq_off.cqes);
+      self->cq_mask_ = *reinterpret_cast<unsigned*>(cqb + p.cq_off.ring_mask);
+    }
+    return true;
+  }
 
-inline void println(unsigned char x) noexcept safe
-{
-  unsafe { printf("%hhu\n", x); }
-}
+  std::size_t alloc_slot(self^, std::uint64_t user_data, optional<vector<u8>> buffer,
+    std::size_t fixed_buffer) safe
+  {
+    op_slot slot{user_data, rel buffer, fixed_buffer};
+    ++self->inflight_;
+
+    optional<std::size_t> m_id = mut self->free_slots_.pop_back();
+    if (m_id.is_some()) {
+      std::size_t id = m_id rel.unwrap();
+      (^self->slots_)[id] = .some(rel slot);
+      return id;
+    }
 
-inline void println(unsigned short x) noexcept safe
-{
-  unsafe { printf("%hu\n", x); }
-}
+    mut self->slots_.push_back(.some(rel slot));
+    return self->slots_.size() - 1;
+  }
 
-inline void println(unsigned int x) noexcept safe
-{
-  unsafe { printf("%u\n", x); }
-}
+  completion release_slot(self^, std::size_t id, result<std::size_t> res) safe {
+    op_slot slot = (mut self->slots_[id].take()).expect("uring completion for an unknown slot");
+    mut self->free_slots_.push_back(id);
+    --self->inflight_;
 
-inline void println(long unsigned int x) noexcept safe
-{
-  unsafe { printf("%lu\n", x); }
-}
+    if (slot.fixed_buffer != no_fixed_buffer) {
+      mut self->buffer_users_[slot.fixed_buffer] -= 1;
+    }
+    return completion{slot.user_data, rel res, rel slot.buffer};
+  }
 
-inline void println(long long unsigned int x) noexcept safe
-{
-  unsafe { printf("%llu\n", x); }
-}
+  // Makes room for one SQE, submitting the queued ones if the ring is full.
+  // Errors from io_uring_enter, including transient ones such as EAGAIN and
+  // EBUSY, go back to the caller.
+  result<unit> reserve_sqe(self^) safe {
+    if (self.is_fallback()) return .ok(unit{});
 
-inline void println(float x) noexcept safe {
-  unsafe { printf("%f\n", x); }
-}
+    while (true) {
+      unsafe { unsigned tail = *self->sq_tail_; }
+      unsafe { unsigned head = __atomic_load_n(self->sq_head_, __ATOMIC_ACQUIRE); }
+      if (tail - head < self->sq_entries_) return .ok(unit{});
 
-inline void println(double x) noexcept safe {
-  unsafe { printf("%f\n", x); }
-}
+      result<std::size_t> r = mut self.submit();
+      if (r.is_err()) return .err(r rel.unwrap_err());
+    }
+  }
 
-inline void println(long double x) noexcept safe {
-  unsafe { printf("%Lf\n", x); }
-}
+  // Writes one SQE. reserve_sqe must have made room for it.
+  void push_sqe(self^, std::uint8_t opcode, int fd, std::uint8_t flags, void const* ptr,
+    std::size_t len, std::uint64_t offset, std::size_t slot, std::uint16_t buf_index) safe
+  {
+    unsafe { unsigned tail = *self->sq_tail_; }
+    unsigned const idx = tail & self->sq_mask_;
+    unsafe {
+      io_uring_sqe* sqe = self->sqes_ + idx;
+      std::memset(sqe, 0, sizeof(io_uring_sqe));
+      sqe->opcode = opcode;
+      sqe->flags = flags;
+      sqe->fd = fd;
+      sqe->off = offset;
+      sqe->addr = reinterpret_cast<std::uint64_t>(ptr);
+      sqe->len = static_cast<std::uint32_t>(len);
+      sqe->buf_index = buf_index;
+      sqe->user_data = slot;
+
+      self->sq_array_[idx] = idx;
+      __atomic_store_n(self->sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    }
+    ++self->unsubmitted_;
+  }
 
-////////////////////////////////////////////////////////////////////////////////
-// mutex.h
+  int resolve_fd(self const^, fixed_file f) safe {
+    if (f.index >= self->files_.size()) panic_bounds("fixed file index is out-of-bounds");
+    return self->files_[f.index];
+  }
 
-template<class T+>
-class
-[[unsafe::send(T~is_send), unsafe::sync(T~is_send)]]
-mutex
-{
-  using mutex_type = unsafe_cell<std::mutex>;
+  // Synchronous execution used in fallback mode.
+  static result<std::size_t> run_blocking(std::uint8_t opcode, int fd, void const* ptr,
+    std::size_t len, std::uint64_t offset) noexcept
+  {
+    while (true) {
+      ssize_t n = -1;
+      switch (opcode) {
+        case IORING_OP_READ:
+        case IORING_OP_READ_FIXED:
+          n = ::pread(fd, const_cast<void*>(ptr), len, static_cast<off_t>(offset));
+          break;
+        case IORING_OP_WRITE:
+        case IORING_OP_WRITE_FIXED:
+          n = ::pwrite(fd, ptr, len, static_cast<off_t>(offset));
+          break;
+        case IORING_OP_RECV:
+          n = ::recv(fd, const_cast<void*>(ptr), len, 0);
+          break;
+        case IORING_OP_SEND:
+          n = ::send(fd, ptr, len, MSG_NOSIGNAL);
+          break;
+        case IORING_OP_FSYNC:
+          n = ::fsync(fd);
+          break;
+      }
+      if (n >= 0) return .ok(static_cast<std::size_t>(n));
 
-  unsafe_cell<T> data_;
-  box<mutex_type> mtx_;
+      auto e = error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
+    }
+  }
 
+  // Queues one operation, or runs it in fallback mode. reserve_sqe must have
+  // made room for it.
+  void queue(self^, std::uint8_t opcode, int fd, bool fixed_fd, void const* ptr,
+    std::size_t len, std::uint64_t offset, std::uint64_t user_data,
+    optional<vector<u8>> buffer, std::size_t fixed_buffer) safe
+  {
+    if (self.is_fallback()) {
+      unsafe { result<std::size_t> res = run_blocking(opcode, fd, ptr, len, offset); }
+      mut self->fallback_.push_back(.some(completion{user_data, rel res, rel buffer}));
+      return;
+    }
 
-public:
-  class lock_guard/(a)
+    std::size_t slot = mut self.alloc_slot(user_data, rel buffer, fixed_buffer);
+    std::uint8_t const flags = fixed_fd ? IOSQE_FIXED_FILE : 0;
+    std::uint16_t const buf_index =
+      fixed_buffer == no_fixed_buffer ? 0 : static_cast<std::uint16_t>(fixed_buffer);
+    mut self.push_sqe(opcode, fd, flags, ptr, len, offset, slot, buf_index);
+  }
+
+  expected<unit, queue_error> queue_owned(self^, std::uint8_t opcode, int fd, bool fixed_fd,
+    vector<u8> buf, std::uint64_t offset, std::uint64_t user_data) safe
   {
-    friend class mutex;
+    result<unit> room = mut self.reserve_sqe();
+    if (room.is_err()) return .err(queue_error{room rel.unwrap_err(), rel buf});
 
-    mutex const^/a m_;
+    u8* p = mut buf.data();
+    std::size_t const len = buf.size();
+    mut self.queue(opcode, fd, fixed_fd, p, len, offset, user_data, .some(rel buf), no_fixed_buffer);
+    return .ok(unit{});
+  }
 
-    lock_guard(mutex const^/a m) noexcept safe
-      : m_(m)
-    {
+  result<unit> queue_fixed(self^, std::uint8_t opcode, int fd, bool fixed_fd, std::size_t buf_index,
+    std::size_t len, std::uint64_t offset, std::uint64_t user_data) safe
+  {
+    if (buf_index >= self->buffers_.size()) panic_bounds("registered buffer index is out-of-bounds");
+    if (len > self->buffers_[buf_index].size()) panic_bounds("length exceeds the registered buffer");
+
+    result<unit> room = mut self.reserve_sqe();
+    if (room.is_err()) return rel room;
+
+    u8* p = mut self->buffers_[buf_index].data();
+    bool const fallback = self.is_fallback();
+    mut self.queue(opcode, fd, fixed_fd, p, len, offset, user_data, .none,
+      fallback ? no_fixed_buffer : buf_index);
+    if (!fallback) {
+      mut self->buffer_users_[buf_index] += 1;
     }
+    return .ok(unit{});
+  }
 
-    public:
-    ~lock_guard() safe {
-      unsafe { mut m_->mtx_->get()->unlock(); }
+public:
+  static uring create(std::uint32_t entries) safe {
+    uring r{};
+    mut r.setup(entries);
+    return rel r;
+  }
+
+  // Always performs operations with blocking system calls.
+  static uring create_fallback() safe {
+    return uring{};
+  }
+
+  uring(uring const^) = delete;
+
+  ~uring() safe {
+    // The kernel may still be writing into buffers we own. Wait for every
+    // outstanding operation before releasing them. submit_and_wait retries
+    // EINTR itself; if waiting fails any other way, leak the buffers rather
+    // than free memory the kernel may still write into.
+    while (inflight_ > 0) {
+      if (!mut self.submit_and_wait(1).is_ok()) {
+        forget(replace<vector<optional<op_slot>>>(^self->slots_, vector<optional<op_slot>>{}));
+        forget(replace<vector<vector<u8>>>(^self->buffers_, vector<vector<u8>>{}));
+        break;
+      }
+      while (mut self.next_completion().is_some()) { }
     }
 
-    T const^ borrow(self const^) noexcept safe {
-      unsafe { return ^*self->m_->data_.get(); }
+    if (fd_ < 0) return;
+    unsafe {
+      ::munmap(sqes_, sqes_len_);
+      if (cq_ptr_) ::munmap(cq_ptr_, cq_len_);
+      ::munmap(sq_ptr_, sq_len_);
+      ::close(fd_);
     }
+  }
 
-    T^ borrow(self^) noexcept safe {
-      unsafe { return ^*self->m_->data_.get(); }
+  bool is_fallback(self const^) noexcept safe {
+    return self->fd_ < 0;
+  }
+
+  std::size_t inflight(self const^) noexcept safe {
+    return self->inflight_;
+  }
+
+  // Registers fds for use with fixed_file. Replaces any earlier set.
+  result<unit> register_files(self^, const [int; dyn]^ fds) safe {
+    if (!self.is_fallback() && !self->files_.empty()) {
+      unsafe { sys_register(self->fd_, IORING_UNREGISTER_FILES, nullptr, 0); }
     }
 
-    T^ operator*(self^) noexcept safe {
-      return self.borrow();
+    self->files_ = vector<int>{};
+    for (int fd : slice_iterator<const int>(fds)) {
+      mut self->files_.push_back(fd);
     }
 
-    T const^ operator*(self const^) noexcept safe {
-      return self.borrow();
+    if (self.is_fallback()) return .ok(unit{});
+
+    unsafe {
+      int r = sys_register(self->fd_, IORING_REGISTER_FILES,
+        (*fds)~as_pointer, static_cast<unsigned>((*fds)~length));
     }
-  };
+    if (r < 0) return .err(error::last_os_error());
+    return .ok(unit{});
+  }
 
-  explicit mutex(T data) noexcept safe
-    : data_(rel data)
-    , unsafe mtx_(box<mutex_type>::make_default())
-  {
+  // Moves buffers into the ring and pins them with the kernel.
+  result<unit> register_buffers(self^, vector<vector<u8>> bufs) safe {
+    if (self->inflight_ > 0) panic("cannot register buffers with operations in flight");
+    mut self.unregister_buffers();
+
+    if (!self.is_fallback() && !bufs.empty()) {
+      vector<iovec> iovs = {};
+      for (vector<u8>^ b : mut bufs.iter()) {
+        mut iovs.push_back(iovec{mut b.data(), b.size()});
+      }
+      unsafe {
+        int r = sys_register(self->fd_, IORING_REGISTER_BUFFERS,
+          iovs.data(), static_cast<unsigned>(iovs.size()));
+      }
+      if (r < 0) return .err(error::last_os_error());
+    }
+
+    self->buffer_users_ = vector<std::size_t>{};
+    for (std::size_t i = 0; i < bufs.size(); ++i) {
+      mut self->buffer_users_.push_back(0);
+    }
+    self->buffers_ = rel bufs;
+    return .ok(unit{});
   }
 
-  mutex(mutex const^) = delete;
+  // Gives the registered buffers back to the caller.
+  vector<vector<u8>> unregister_buffers(self^) safe {
+    if (self->inflight_ > 0) panic("cannot unregister buffers with operations in flight");
+    if (!self.is_fallback() && !self->buffers_.empty()) {
+      unsafe { sys_register(self->fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0); }
+    }
+    self->buffer_users_ = vector<std::size_t>{};
+    return replace<vector<vector<u8>>>(^self->buffers_, vector<vector<u8>>{});
+  }
 
-  lock_guard lock(self const^) safe {
-    unsafe { mut self->mtx_->get()->lock();}
-    return lock_guard(self);
+  // Borrows a registered buffer, provided no queued operation is using it.
+  optional<[u8; dyn]^> registered_buffer(self^, std::size_t index) safe {
+    if (self->buffer_users_[index] != 0) return .none;
+    return .some(mut self->buffers_[index].slice());
   }
-};
 
-////////////////////////////////////////////////////////////////////////////////
-// rc.h
+  // Each operation returns an error without queueing anything if the ring
+  // is full and io_uring_enter fails while making room. Owned buffers come
+  // back inside the queue_error in that case.
+  expected<unit, queue_error> read(self^, int fd, vector<u8> buf, std::uint64_t offset, std::uint64_t user_data) safe {
+    return mut self.queue_owned(IORING_OP_READ, fd, false, rel buf, offset, user_data);
+  }
 
-template<class T+>
-class [[unsafe::send(false)]] rc
-{
-  struct rc_inner;
+  expected<unit, queue_error> read(self^, fixed_file f, vector<u8> buf, std::uint64_t offset, std::uint64_t user_data) safe {
+    int const fd = self.is_fallback() ? self.resolve_fd(f) : static_cast<int>(f.index);
+    return mut self.queue_owned(IORING_OP_READ, fd, !self.is_fallback(), rel buf, offset, user_data);
+  }
 
-  rc_inner* unsafe p_;
+  expected<unit, queue_error> write(self^, int fd, vector<u8> buf, std::uint64_t offset, std::uint64_t user_data) safe {
+    return mut self.queue_owned(IORING_OP_WRITE, fd, false, rel buf, offset, user_data);
+  }
 
-  struct rc_inner
-  {
-    manually_drop<T> data_;
-    std::size_t strong_;
-    std::size_t weak_;
+  expected<unit, queue_error> write(self^, fixed_file f, vector<u8> buf, std::uint64_t offset, std::uint64_t user_data) safe {
+    int const fd = self.is_fallback() ? self.resolve_fd(f) : static_cast<int>(f.index);
+    return mut self.queue_owned(IORING_OP_WRITE, fd, !self.is_fallback(), rel buf, offset, user_data);
+  }
 
-    explicit
-    rc_inner(T data) noexcept safe
-      : data_(rel data)
-      , strong_(1)
-      , weak_(1)
-    {
-    }
-  };
+  expected<unit, queue_error> recv(self^, int fd, vector<u8> buf, std::uint64_t user_data) safe {
+    return mut self.queue_owned(IORING_OP_RECV, fd, false, rel buf, 0, user_data);
+  }
 
-  public:
+  expected<unit, queue_error> send(self^, int fd, vector<u8> buf, std::uint64_t user_data) safe {
+    return mut self.queue_owned(IORING_OP_SEND, fd, false, rel buf, 0, user_data);
+  }
 
-  explicit
-  rc(T t) safe
-    : p_(new(std::nothrow) rc_inner(rel t))
+  result<unit> read_fixed(self^, fixed_file f, std::size_t buf_index, std::size_t len,
+    std::uint64_t offset, std::uint64_t user_data) safe
   {
+    int const fd = self.is_fallback() ? self.resolve_fd(f) : static_cast<int>(f.index);
+    return mut self.queue_fixed(IORING_OP_READ_FIXED, fd, !self.is_fallback(), buf_index, len, offset, user_data);
   }
 
-  rc(rc const^ rhs) safe
-    : p_(rhs->p_)
+  result<unit> write_fixed(self^, fixed_file f, std::size_t buf_index, std::size_t len,
+    std::uint64_t offset, std::uint64_t user_data) safe
   {
-    ++p_->strong_;
+    int const fd = self.is_fallback() ? self.resolve_fd(f) : static_cast<int>(f.index);
+    return mut self.queue_fixed(IORING_OP_WRITE_FIXED, fd, !self.is_fallback(), buf_index, len, offset, user_data);
   }
 
-  [[unsafe::drop_only(T)]]
-  ~rc() safe
-  {
-    std::size_t s = --p_->strong_;
-    if (s == 0) {
-      unsafe { mut p_->data_.destroy(); }
+  result<unit> fsync(self^, int fd, std::uint64_t user_data) safe {
+    result<unit> room = mut self.reserve_sqe();
+    if (room.is_err()) return rel room;
 
-      std::size_t w = --p_->weak_;
-      if (w == 0) {
-        delete p_;
+    mut self.queue(IORING_OP_FSYNC, fd, false, nullptr, 0, 0, user_data, .none, no_fixed_buffer);
+    return .ok(unit{});
+  }
+
+  // Hands every queued operation to the kernel in a single system call.
+  result<std::size_t> submit(self^) safe {
+    return mut self.submit_and_wait(0);
+  }
+
+  result<std::size_t> submit_and_wait(self^, std::uint32_t min_complete) safe {
+    if (self.is_fallback()) return .ok(0);
+
+    unsigned const flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    while (true) {
+      unsafe { int r = sys_enter(self->fd_, self->unsubmitted_, min_complete, flags); }
+      if (r >= 0) {
+        self->unsubmitted_ -= static_cast<unsigned>(r);
+        return .ok(static_cast<std::size_t>(r));
       }
+
+      auto e = error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
     }
   }
 
-  T const^ operator->(self const^) noexcept safe {
-    return *self->p_->data_.get();
+  // Reaps one completion without blocking.
+  optional<completion> next_completion(self^) safe {
+    if (self.is_fallback()) {
+      if (self->fallback_head_ == self->fallback_.size()) {
+        self->fallback_ = vector<optional<completion>>{};
+        self->fallback_head_ = 0;
+        return .none;
+      }
+      return mut self->fallback_[self->fallback_head_++].take();
+    }
+
+    unsafe { unsigned head = *self->cq_head_; }
+    unsafe { unsigned tail = __atomic_load_n(self->cq_tail_, __ATOMIC_ACQUIRE); }
+    if (head == tail) return .none;
+
+    unsafe { io_uring_cqe const cqe = self->cqes_[head & self->cq_mask_]; }
+    unsafe { __atomic_store_n(self->cq_head_, head + 1, __ATOMIC_RELEASE); }
+
+    result<std::size_t> res = .ok(0);
+    if (cqe.res < 0) res = .err(error(-cqe.res));
+    else res = .ok(static_cast<std::size_t>(cqe.res));
+
+    return .some(mut self.release_slot(static_cast<std::size_t>(cqe.user_data), rel res));
   }
 
-  T const^ operator*(self const^) noexcept safe {
-    return *self->p_->data_.get();
+  // Blocks until at least one completion is available, then reaps it.
+  result<completion> wait_completion(self^) safe {
+    while (true) {
+      optional<completion> c = mut self.next_completion();
+      if (c.is_some()) return .ok(c rel.unwrap());
+      if (self.is_fallback()) panic("wait_completion with nothing queued");
+
+      result<std::size_t> r = mut self.submit_and_wait(1);
+      if (r.is_err()) return .err(r rel.unwrap_err());
+    }
   }
 };
 
+} // namespace io
 
 ////////////////////////////////////////////////////////////////////////////////
-// ref_cell.h
+// io/traits.h
 
-template<class T+>
-class ref_cell
+namespace io
 {
-  unsafe_cell<T> t_;
-  cell<int> borrow_count_;
 
-  public:
+interface reader {
+  result<std::size_t> read(self^, [u8; dyn]^ buf) safe;
+};
 
-  class ref/(a)
-  {
-    friend class ref_cell;
+interface writer {
+  result<std::size_t> write(self^, const [u8; dyn]^ buf) safe;
+  result<unit> flush(self^) safe;
+};
 
-    T* value_;
-    cell<int> const^/a borrow_;
+// Endpoints backed by a file descriptor, which lets copy() keep the data
+// in the kernel.
+interface raw_fd {
+  int as_raw_fd(self const^) safe;
+};
 
-    ref(T* value, cell<int> const^/a borrow) noexcept safe
-      : value_(value)
-      , borrow_(borrow)
-    {
-      borrow_.set(borrow_.get() + 1);
-    }
+// Writers that can gather several buffers into one system call.
+interface vectored_writer {
+  result<std::size_t> write_vectored(self^, const [const [u8; dyn]^; dyn]^ bufs) safe;
+};
 
-    public:
+// Writes the whole buffer, looping over short writes.
+template<class W>
+result<unit> write_all(W^ w, const [u8; dyn]^ buf) safe
+requires impl<W, writer>
+{
+  std::size_t pos = 0;
+  std::size_t const len = (*buf)~length;
+  while (pos < len) {
+    unsafe { auto rest = slice_from_raw_parts((*buf)~as_pointer + pos, len - pos); }
+    result<std::size_t> r = mut w.std2::io::writer::write(rest);
+    if (r.is_err()) return .err(r rel.unwrap_err());
+
+    std::size_t n = r rel.unwrap();
+    if (n == 0) return .err(error(EIO));
+    pos += n;
+  }
+  return .ok(unit{});
+}
 
-    ref(ref const^ rhs) safe
-      : ref(rhs.value_, rhs.borrow_)
-    {
+// Writes every buffer in order, issuing as few gather calls as short writes
+// allow.
+template<class W>
+result<unit> write_all_vectored(W^ w, const [const [u8; dyn]^; dyn]^ bufs) safe
+requires impl<W, writer> && impl<W, vectored_writer>
+{
+  std::size_t idx = 0;
+  std::size_t const count = (*bufs)~length;
+  while (true) {
+    while (idx < count && (*(*bufs)[idx])~length == 0) ++idx;
+    if (idx == count) return .ok(unit{});
+
+    unsafe { auto rest = slice_from_raw_parts((*bufs)~as_pointer + idx, count - idx); }
+    result<std::size_t> r = mut w.std2::io::vectored_writer::write_vectored(rest);
+    if (r.is_err()) return .err(r rel.unwrap_err());
+
+    std::size_t n = r rel.unwrap();
+    if (n == 0) return .err(error(EIO));
+
+    while (idx < count && n >= (*(*bufs)[idx])~length) {
+      n -= (*(*bufs)[idx])~length;
+      ++idx;
     }
 
-    ~ref() safe {
-      auto b = borrow_.get();
-      borrow_.set(b - 1);
+    // Finish a partially written buffer on its own before gathering again.
+    if (n > 0) {
+      const [u8; dyn]^ b = (*bufs)[idx];
+      unsafe { auto tail = slice_from_raw_parts((*b)~as_pointer + n, (*b)~length - n); }
+      result<unit> t = write_all(w, tail);
+      if (t.is_err()) return rel t;
+      ++idx;
     }
+  }
+}
 
-    T const^ operator*(self const^) noexcept safe {
-      unsafe { return *self->value_; }
+// Reads until end of input, appending to out. Returns the number of bytes
+// read.
+//
+// Reads land directly in out's spare capacity. The reader may look at the
+// buffer it's given, so spare bytes are zeroed once before their first use;
+// initialized marks how far that reaches. When out is full, which is common
+// after reserving an exact file size, a small probe read checks for end of
+// input before growing.
+template<class R>
+result<std::size_t> read_to_end(R^ r, vector<u8>^ out) safe
+requires impl<R, reader>
+{
+  std::size_t const start = out.size();
+  std::size_t initialized = start;
+  while (true) {
+    std::size_t const len = out.size();
+    if (len == out.capacity()) {
+      u8 probe[32] {};
+      result<std::size_t> p = mut r.std2::io::reader::read(^probe);
+      if (p.is_err()) return .err(p rel.unwrap_err());
+
+      std::size_t const n = p rel.unwrap();
+      if (n == 0) return .ok(len - start);
+
+      // Grows geometrically, and the old spare bytes don't move with it.
+      unsafe { mut out.extend_from_slice(slice_from_raw_parts(probe + 0, n)); }
+      initialized = out.size();
+      continue;
     }
-  };
 
-  class ref_mut/(a)
-  {
-    friend class ref_cell;
+    std::size_t const cap = out.capacity();
+    u8* base = mut out.data();
+    if (initialized < cap) {
+      unsafe { std::memset(base + initialized, 0, cap - initialized); }
+      initialized = cap;
+    }
 
-    T* value_;
-    cell<int> const^/a borrow_;
-    // T^/a __phantom_data;
+    unsafe { auto spare = slice_from_raw_parts(base + len, cap - len); }
+    result<std::size_t> res = mut r.std2::io::reader::read(spare);
+    if (res.is_err()) return .err(res rel.unwrap_err());
 
-    ref_mut(T* value, cell<int> const^/a borrow) noexcept safe
-      : value_(value)
-      , borrow_(borrow)
-    {
-      borrow_.set(borrow_.get() - 1);
-    }
+    std::size_t const n = res rel.unwrap();
+    if (n == 0) return .ok(len - start);
+    if (n > cap - len) panic("reader returned more bytes than it was given room for");
+    unsafe { mut out.set_len(len + n); }
+  }
+}
 
-    public:
+// Validates bytes as UTF-8 in a single pass and copies them into a string.
+inline
+result<string> bytes_to_string(const [u8; dyn]^ bytes) safe
+{
+  unsafe {
+    auto chars = slice_from_raw_parts(
+      reinterpret_cast<char const*>((*bytes)~as_pointer), (*bytes)~length);
+  }
+  if (!str::is_valid_utf(chars)) return .err(error(EILSEQ));
+  unsafe { return .ok(string(str(chars, str::no_utf_check{}))); }
+}
 
-    ~ref_mut() safe {
-      auto b = borrow_.get();
-      borrow_.set(b + 1);
-    }
+// Validates bytes as UTF-8 and hands their buffer to the string without
+// copying.
+inline
+result<string> bytes_into_string(vector<u8> bytes) safe
+{
+  unsafe {
+    auto chars = slice_from_raw_parts(
+      reinterpret_cast<char const*>(bytes.data()), bytes.size());
+  }
+  if (!str::is_valid_utf(chars)) return .err(error(EILSEQ));
 
-    T const^ operator*(self const^) noexcept safe {
-      unsafe { return *self->value_; }
-    }
+  auto parts = bytes rel.into_raw_parts();
+  unsafe { return .ok(string::from_raw_parts(reinterpret_cast<char*>(parts.0), parts.1, parts.2)); }
+}
 
-    T^ operator*(self^) noexcept safe {
-      unsafe { return ^*self->value_; }
-    }
-  };
+} // namespace io
 
-  explicit
-  ref_cell(T t) noexcept safe
-    : t_(rel t)
-    , borrow_count_{0}
-  {
-  }
+////////////////////////////////////////////////////////////////////////////////
+// fs.h
 
-  ref_cell(ref_cell const^) = delete;
+namespace fs
+{
 
-  optional<ref> try_borrow(self const^) noexcept safe
+struct open_options
+{
+  bool read = false;
+  bool write = false;
+  bool append = false;
+  bool create = false;
+  bool truncate = false;
+};
+
+class file
+{
+  int fd_;
+
+  explicit file(int fd) noexcept safe
+    : fd_(fd)
   {
-    auto b = self->borrow_count_.get();
-    if (b < 0) return .none;
-    return .some(ref{self->t_.get(), self->borrow_count_});
   }
 
-  ref borrow(self const^) noexcept safe {
-    auto opt = self.try_borrow();
-    return match(rel opt) {
-      .some(b) => rel b;
-      .none => panic("ref_cell failed to acquire const borrow");
-    };
+public:
+  static io::result<file> open_with(str path, open_options const^ opts) safe {
+    int flags = O_CLOEXEC;
+    if (opts->read && (opts->write || opts->append)) flags |= O_RDWR;
+    else if (opts->write || opts->append) flags |= O_WRONLY;
+    else flags |= O_RDONLY;
+
+    if (opts->append) flags |= O_APPEND;
+    if (opts->create) flags |= O_CREAT;
+    if (opts->truncate) flags |= O_TRUNC;
+
+    // The path must be NUL-terminated for the system call, so one with a
+    // NUL inside it can't be passed through.
+    unsafe { void const* nul = std::memchr(path.data(), '\0', path.size()); }
+    if (nul) return .err(io::error(EINVAL));
+
+    unsafe { std::string p(path.data(), path.size()); }
+    while (true) {
+      unsafe { int fd = ::open(p.c_str(), flags, 0666); }
+      if (fd >= 0) return .ok(file(fd));
+
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
+    }
   }
 
-  optional<ref_mut> try_borrow_mut(self const^) noexcept safe
-  {
-    auto b = self->borrow_count_.get();
-    if (b > 0) return .none;
-    if (b == -1) return .none;
-    return .some(ref_mut{self->t_.get(), self->borrow_count_});
+  // Opens an existing file for reading.
+  static io::result<file> open(str path) safe {
+    return open_with(path, open_options{ .read = true });
   }
 
-  ref_mut borrow_mut(self const^) noexcept safe {
-    auto opt = self.try_borrow_mut();
-    return match(rel opt) {
-      .some(b) => rel b;
-      .none => panic("ref_cell failed to acquire const borrow");
-    };
+  // Opens a file for writing, creating it or truncating an existing file.
+  static io::result<file> create(str path) safe {
+    return open_with(path, open_options{ .write = true, .create = true, .truncate = true });
   }
 
-  T^ get_mut(self^) noexcept safe {
-    unsafe { return ^*self->t_.get(); }
+  file(file const^) = delete;
+
+  ~file() safe {
+    if (fd_ >= 0)
+      unsafe { ::close(fd_); }
   }
-};
 
-////////////////////////////////////////////////////////////////////////////////
+  int as_raw_fd(self const^) noexcept safe {
+    return self->fd_;
+  }
 
-template<class T+>
-class
-[[unsafe::send(T~is_send), unsafe::sync(T~is_send)]]
-shared_mutex
-{
-  using mutex_type = unsafe_cell<std::shared_mutex>;
+  io::result<std::size_t> read(self^, [u8; dyn]^ buf) safe {
+    while (true) {
+      unsafe { auto n = ::read(self->fd_, (*buf)~as_pointer, (*buf)~length); }
+      if (n >= 0) return .ok(static_cast<std::size_t>(n));
 
-  unsafe_cell<T> data_;
-  box<mutex_type> mtx_;
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
+    }
+  }
 
-public:
-  class lock_guard/(a)
-  {
-    friend class shared_mutex;
+  io::result<std::size_t> write(self^, const [u8; dyn]^ buf) safe {
+    while (true) {
+      unsafe { auto n = ::write(self->fd_, (*buf)~as_pointer, (*buf)~length); }
+      if (n >= 0) return .ok(static_cast<std::size_t>(n));
 
-    shared_mutex const^/a m_;
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
+    }
+  }
 
-    lock_guard(shared_mutex const^/a m) noexcept safe
-      : m_(m)
-    {
+  io::result<std::size_t> read_vectored(self^, [[u8; dyn]^; dyn]^ bufs) safe {
+    unsafe {
+      iovec iov[io::max_iovecs];
+      int const cnt = static_cast<int>(io::to_iovecs(bufs, iov));
     }
+    while (true) {
+      unsafe { auto n = ::readv(self->fd_, iov, cnt); }
+      if (n >= 0) return .ok(static_cast<std::size_t>(n));
 
-    public:
-    ~lock_guard() safe {
-      unsafe { m_->mtx_->get()&->unlock(); }
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
     }
+  }
 
-    T const^ borrow(self const^) noexcept safe {
-      unsafe { return ^*self->m_->data_.get(); }
+  io::result<std::size_t> write_vectored(self^, const [const [u8; dyn]^; dyn]^ bufs) safe {
+    unsafe {
+      iovec iov[io::max_iovecs];
+      int const cnt = static_cast<int>(io::to_iovecs(bufs, iov));
     }
+    while (true) {
+      unsafe { auto n = ::writev(self->fd_, iov, cnt); }
+      if (n >= 0) return .ok(static_cast<std::size_t>(n));
 
-    T^ borrow(self^) noexcept safe {
-      unsafe { return ^*self->m_->data_.get(); }
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
     }
+  }
 
-    T^ operator*(self^) noexcept safe {
-      return self.borrow();
+  // Positional reads and writes don't move the file offset, so they only
+  // need a shared borrow.
+  io::result<std::size_t> pread(self const^, [u8; dyn]^ buf, std::uint64_t offset) safe {
+    while (true) {
+      unsafe {
+        auto n = ::pread(self->fd_, (*buf)~as_pointer, (*buf)~length, static_cast<off_t>(offset));
+      }
+      if (n >= 0) return .ok(static_cast<std::size_t>(n));
+
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
     }
+  }
 
-    T const^ operator*(self const^) noexcept safe {
-      return self.borrow();
+  io::result<std::size_t> pwrite(self const^, const [u8; dyn]^ buf, std::uint64_t offset) safe {
+    while (true) {
+      unsafe {
+        auto n = ::pwrite(self->fd_, (*buf)~as_pointer, (*buf)~length, static_cast<off_t>(offset));
+      }
+      if (n >= 0) return .ok(static_cast<std::size_t>(n));
+
+      auto e = io::error::last_os_error();
+      if (!e.is_interrupted()) return .err(e);
     }
-  };
+  }
 
-  class shared_lock_guard/(a)
-  {
-    friend class shared_mutex;
+  io::result<unit> sync_all(self const^) safe {
+    unsafe { int r = ::fsync(self->fd_); }
+    if (r < 0) return .err(io::error::last_os_error());
+    return .ok(unit{});
+  }
 
-    shared_mutex const^/a m_;
+  io::result<unit> sync_data(self const^) safe {
+    unsafe { int r = ::fdatasync(self->fd_); }
+    if (r < 0) return .err(io::error::last_os_error());
+    return .ok(unit{});
+  }
 
-    shared_lock_guard(shared_mutex const^/a m) noexcept safe
-      : m_(m)
-    {
-    }
+  io::result<std::uint64_t> size(self const^) safe {
+    unsafe { struct stat st{}; }
+    unsafe { int r = ::fstat(self->fd_, addr st); }
+    if (r < 0) return .err(io::error::last_os_error());
+    unsafe { return .ok(static_cast<std::uint64_t>(st.st_size)); }
+  }
+};
 
-    public:
-    ~shared_lock_guard() safe {
-      // TODO: it seems hard to get implementations to trigger tools like helgrind, drd
-      // here, even with assertions enabled in libstdc++
-      // this was mistakenly a call to `->unlock()` which is incorrect
-      // we need some method of verifying we get a failure here if we call the wrong thing
-      unsafe { m_->mtx_->get()&->unlock_shared(); }
-    }
+} // namespace fs
 
-    T const^ borrow(self const^) noexcept safe {
-      unsafe { return ^*self->m_->data_.get(); }
-    }
+impl fs::file: io::reader
+{
+  io::result<std::size_t> read(self^, [u8; dyn]^ buf) safe override {
+    return self.read(buf);
+  }
+};
 
-    T const^ operator*(self const^) noexcept safe {
-      return self.borrow();
-    }
-  };
+impl fs::file: io::writer
+{
+  io::result<std::size_t> write(self^, const [u8; dyn]^ buf) safe override {
+    return self.write(buf);
+  }
 
-  explicit shared_mutex(T data) noexcept safe
-    : data_(rel data)
-    , unsafe mtx_(box<mutex_type>::make_default())
-  {
+  io::result<unit> flush(self^) safe override {
+    return .ok(unit{});
   }
+};
 
-  shared_mutex(shared_mutex const^) = delete;
+impl fs::file: io::vectored_writer
+{
+  io::result<std::size_t> write_vectored(self^, const [const [u8; dyn]^; dyn]^ bufs) safe override {
+    return self.write_vectored(bufs);
+  }
+};
 
-  lock_guard lock(self const^) safe  {
-    unsafe { self->mtx_->get()&->lock(); }
-    return lock_guard(self);
+impl fs::file: io::raw_fd
+{
+  int as_raw_fd(self const^) safe override {
+    return self.as_raw_fd();
   }
+};
 
-  shared_lock_guard lock_shared(self const^) safe {
-    unsafe { self->mtx_->get()&->lock_shared(); }
-    return shared_lock_guard(self);
+impl net::tcp_stream: io::raw_fd
+{
+  int as_raw_fd(self const^) safe override {
+    return self.as_raw_fd();
   }
 };
 
-////////////////////////////////////////////////////////////////////////////////
-// thread.h
+impl net::tcp_stream: io::reader
+{
+  io::result<std::size_t> read(self^, [u8; dyn]^ buf) safe override {
+    return self.read(buf);
+  }
+};
 
-class thread
+impl net::tcp_stream: io::writer
 {
-  std::thread unsafe t_;
+  io::result<std::size_t> write(self^, const [u8; dyn]^ buf) safe override {
+    return self.write(buf);
+  }
 
-  template<class F, class ...Args>
-  static
-  void call((F, (Args...,))* p_tup) safe
-  {
-    unsafe { box<(F, (Args...,))> p = p_tup; }
+  io::result<unit> flush(self^) safe override {
+    return .ok(unit{});
+  }
+};
 
-    auto tup = p rel.into_inner();
-    mut tup.0 rel.(rel tup.1.[:] ...);
+impl net::tcp_stream: io::vectored_writer
+{
+  io::result<std::size_t> write_vectored(self^, const [const [u8; dyn]^; dyn]^ bufs) safe override {
+    return self.write_vectored(bufs);
   }
+};
 
-public:
+namespace io
+{
 
-  thread() = delete;
-  thread(thread const^) safe = delete;
+// Adds an in-memory buffer to a reader so small reads and line splitting
+// don't each cost a system call.
+template<class R+>
+class buf_reader
+{
+  R inner_;
+  vector<u8> buf_;
+  std::size_t pos_;
+  std::size_t filled_;
 
-  template<class F+, class ...Args+>
-  thread/(where F: static, Args...: static)(F f, Args... args) safe
-  requires(
-    F~is_send &&
-    (Args~is_send && ...) &&
-    safe(mut f(rel args...)))
-    : unsafe t_()
-  {
-    static_assert(!__is_lambda(F), "lambdas in std2::thread not yet supported by toolchain");
-    using tuple_type = (F, (Args...,));
+  result<unit> refill(self^) safe {
+    result<std::size_t> r = mut self->inner_.std2::io::reader::read(mut self->buf_.slice());
+    if (r.is_err()) return .err(r rel.unwrap_err());
 
-    box<tuple_type> p{(rel f, (rel args... ,))};
-    // TODO: have the thread constructor throw here somehow
-    // must catch the case where a clever stdlib dev thinks they can
-    // replace p.get() with `p rel.leak()` here, which causes a memory
-    // leak upon `std::thread::thread` throwing
-    unsafe { t_ = std::thread(&call<F, Args...>, p.get()); }
-    forget(rel p);
+    self->pos_ = 0;
+    self->filled_ = r rel.unwrap();
+    return .ok(unit{});
   }
 
-  ~thread() safe {
-    mut t_.detach();
+public:
+  explicit buf_reader(R inner, std::size_t capacity = 8 * 1024) safe
+    : inner_(rel inner)
+    , buf_{}
+    , pos_(0)
+    , filled_(0)
+  {
+    mut buf_.reserve(capacity);
+    for (std::size_t i = 0; i < capacity; ++i) {
+      mut buf_.push_back(0);
+    }
   }
 
-  void join(self) safe {
-    mut self.t_.join();
+  // Returns the buffered bytes, reading from the inner reader first if the
+  // buffer is empty. An empty slice means end of input. The bytes stay
+  // buffered until consume() is called.
+  result<const [u8; dyn]^> fill_buf(self^) safe {
+    if (self->pos_ == self->filled_) {
+      result<unit> r = mut self.refill();
+      if (r.is_err()) return .err(r rel.unwrap_err());
+    }
 
-    // TODO: this line will someday be _required_ once ABI issues are worked out
-    // and dropping through a relocated function parameter works
-    forget(rel self);
+    unsafe {
+      return .ok(slice_from_raw_parts(self->buf_.data() + self->pos_, self->filled_ - self->pos_));
+    }
   }
-};
 
-////////////////////////////////////////////////////////////////////////////////
-// vector.h
+  void consume(self^, std::size_t n) noexcept safe {
+    std::size_t const avail = self->filled_ - self->pos_;
+    self->pos_ += n < avail ? n : avail;
+  }
 
+  result<std::size_t> read(self^, [u8; dyn]^ out) safe {
+    std::size_t const len = (*out)~length;
 
-template<class T+>
-class vector;
+    // Large reads into an empty buffer bypass it.
+    if (self->pos_ == self->filled_ && len >= self->buf_.size()) {
+      return mut self->inner_.std2::io::reader::read(out);
+    }
 
-template<class T+>
-class into_iterator
-{
-  using value_type = T;
+    result<const [u8; dyn]^> r = mut self.fill_buf();
+    if (r.is_err()) return .err(r rel.unwrap_err());
+
+    const [u8; dyn]^ avail = r rel.unwrap();
+    std::size_t const n = (*avail)~length < len ? (*avail)~length : len;
+    unsafe { std::memcpy((*out)~as_pointer, (*avail)~as_pointer, n); }
+    mut self.consume(n);
+    return .ok(n);
+  }
+
+  // Appends bytes up to and including the next '\n' to out. The line is
+  // validated as UTF-8 as a whole, so multi-byte code points split across
+  // buffer refills are handled. Returns 0 at end of input.
+  result<std::size_t> read_line(self^, string^ out) safe {
+    vector<u8> line = {};
+    bool done = false;
+    while (!done) {
+      if (self->pos_ == self->filled_) {
+        result<unit> r = mut self.refill();
+        if (r.is_err()) return .err(r rel.unwrap_err());
+        if (self->filled_ == 0) break;
+      }
 
-  friend class vector<T>;
+      unsafe { u8 const* start = self->buf_.data() + self->pos_; }
+      std::size_t n = self->filled_ - self->pos_;
+      unsafe { void const* nl = std::memchr(start, '\n', n); }
+      if (nl) {
+        unsafe { n = static_cast<std::size_t>(static_cast<u8 const*>(nl) - start) + 1; }
+        done = true;
+      }
 
-  value_type* unsafe origin_;
-  value_type* unsafe p_;
-  value_type* end_;
+      unsafe { mut line.extend_from_slice(slice_from_raw_parts(start, n)); }
+      self->pos_ += n;
+    }
 
+    result<string> s = bytes_to_string(line.slice());
+    if (s.is_err()) return .err(s rel.unwrap_err());
 
-  public:
-  into_iterator(value_type* p, value_type* end)
-    : origin_(p)
-    , p_(p)
-    , end_(end)
-  {
+    mut out.append(s rel.unwrap().str());
+    return .ok(line.size());
   }
 
-  ~into_iterator() safe {
-    while (p_ < end_) {
-      unsafe { auto t = __rel_read(p_++); }
-      (void)t;
+  // Reads everything that's left and validates it as UTF-8 in one pass.
+  result<std::size_t> read_to_string(self^, string^ out) safe {
+    vector<u8> bytes = {};
+    unsafe {
+      mut bytes.extend_from_slice(
+        slice_from_raw_parts(self->buf_.data() + self->pos_, self->filled_ - self->pos_));
     }
-    unsafe { ::operator delete(origin_); }
+    self->pos_ = self->filled_;
+
+    result<std::size_t> r = read_to_end(^self->inner_, ^bytes);
+    if (r.is_err()) return .err(r rel.unwrap_err());
+
+    std::size_t const n = bytes.size();
+    result<string> m_s = bytes_into_string(rel bytes);
+    if (m_s.is_err()) return .err(m_s rel.unwrap_err());
+
+    string s = m_s rel.unwrap();
+    if (out.size() == 0) *out = rel s;
+    else mut out.append(s.str());
+    return .ok(n);
   }
 
-  optional<value_type> next(self^) noexcept safe {
-    if (self->p_ < self->end_) {
-      unsafe { return .some(__rel_read(self->p_++)); }
-    } else {
-      return .none;
-    }
+  R const^ get_ref(self const^) noexcept safe {
+    return ^self->inner_;
   }
 };
 
-// TODO: make vector conditionally Send/Sync
-template<class T+>
-class vector
+template<class R>
+impl buf_reader<R>: reader
 {
-public:
-  using value_type = T;
-  using size_type = std::size_t;
+  result<std::size_t> read(self^, [u8; dyn]^ buf) safe override {
+    return self.read(buf);
+  }
+};
 
-  vector() safe
-    : p_(nullptr)
-    , capacity_{0}
-    , size_{0}
-  {
+// Coalesces small writes into large ones. Writes at least as large as the
+// buffer go straight to the inner writer once the buffer is flushed. The
+// buffer is flushed on drop, but errors are only observable through flush().
+template<class W+>
+class buf_writer
+{
+  W inner_;
+  vector<u8> buf_;
+  std::size_t filled_;
+
+  // Drops the first n buffered bytes, which have been written, and moves
+  // the rest to the front.
+  void consume(self^, std::size_t n) safe {
+    u8* p = mut self->buf_.data();
+    unsafe { std::memmove(p, p + n, self->filled_ - n); }
+    self->filled_ -= n;
+  }
+
+  // Writes out the buffered bytes. On error the ones not yet written stay
+  // buffered, so a later flush can retry them.
+  result<unit> flush_buf(self^) safe {
+    std::size_t pos = 0;
+    result<unit> r = .ok(unit{});
+    while (pos < self->filled_) {
+      unsafe { auto rest = slice_from_raw_parts(self->buf_.data() + pos, self->filled_ - pos); }
+      result<std::size_t> w = mut self->inner_.std2::io::writer::write(rest);
+      if (w.is_err()) {
+        r = .err(w rel.unwrap_err());
+        break;
+      }
+
+      std::size_t const n = w rel.unwrap();
+      if (n == 0) {
+        r = .err(error(EIO));
+        break;
+      }
+      pos += n;
+    }
+
+    mut self.consume(pos);
+    return rel r;
   }
 
-  vector(initializer_list<value_type> unsafe ilist) safe
-    : vector()
+public:
+  explicit buf_writer(W inner, std::size_t capacity = 64 * 1024) safe
+    : inner_(rel inner)
+    , buf_{}
+    , filled_(0)
   {
-    self^.reserve(ilist.size());
-    unsafe { relocate_array(mut self.data(), ilist.data(), ilist.size()); }
-    self.size_ = ilist.size();
+    mut buf_.reserve(capacity);
+    for (std::size_t i = 0; i < capacity; ++i) {
+      mut buf_.push_back(0);
+    }
+  }
 
-    ilist^.advance(ilist.size());
+  ~buf_writer() safe {
+    if (filled_ > 0) (void)mut self.flush_buf();
   }
 
-  [[unsafe::drop_only(T)]]
-  ~vector() safe {
-    // TODO: std::destroy_n() doesn't seem to like `int^` as a value_type
-    // eventually we should fix this
+  result<std::size_t> write(self^, const [u8; dyn]^ data) safe {
+    std::size_t const len = (*data)~length;
+    std::size_t const cap = self->buf_.size();
 
-    unsafe {
-      auto const* end = self.data() + self.size();
-      auto* pos = self^.data();
+    if (self->filled_ + len > cap) {
+      result<unit> r = mut self.flush_buf();
+      if (r.is_err()) return .err(r rel.unwrap_err());
+    }
 
-      while (pos < end) {
-        auto t = __rel_read(pos);
-        drp t;
-        ++pos;
+    if (len >= cap) {
+      return mut self->inner_.std2::io::writer::write(data);
+    }
+
+    u8* dst = mut self->buf_.data();
+    unsafe { std::memcpy(dst + self->filled_, (*data)~as_pointer, len); }
+    self->filled_ += len;
+    return .ok(len);
+  }
+
+  // Buffers the slices if they fit. Otherwise the buffered bytes and the
+  // slices go out together in gather writes, instead of a flush followed by
+  // a write per slice, until the buffer has drained. The count returned
+  // covers only the slices and may be short, as with any vectored write.
+  // On error the unwritten buffered bytes stay buffered.
+  result<std::size_t> write_vectored(self^, const [const [u8; dyn]^; dyn]^ bufs) safe
+  requires impl<W, vectored_writer>
+  {
+    std::size_t const count = (*bufs)~length;
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      total += (*(*bufs)[i])~length;
+    }
+
+    if (self->filled_ + total <= self->buf_.size()) {
+      u8* dst = mut self->buf_.data();
+      for (std::size_t i = 0; i < count; ++i) {
+        const [u8; dyn]^ b = (*bufs)[i];
+        unsafe { std::memcpy(dst + self->filled_, (*b)~as_pointer, (*b)~length); }
+        self->filled_ += (*b)~length;
       }
+      return .ok(total);
+    }
 
-      ::operator delete(p_);
+    while (true) {
+      vector<const [u8; dyn]^> parts = {};
+      mut parts.reserve(count + 1);
+      unsafe { mut parts.push_back(slice_from_raw_parts(self->buf_.data() + 0, self->filled_)); }
+      for (std::size_t i = 0; i < count; ++i) {
+        mut parts.push_back((*bufs)[i]);
+      }
+
+      result<std::size_t> r = mut self->inner_.std2::io::vectored_writer::write_vectored(parts.slice());
+      if (r.is_err()) return .err(r rel.unwrap_err());
+
+      std::size_t const n = r rel.unwrap();
+      if (n == 0) return .err(error(EIO));
+      if (n > self->filled_) {
+        std::size_t const written = n - self->filled_;
+        self->filled_ = 0;
+        return .ok(written);
+      }
+      mut self.consume(n);
     }
   }
 
-  slice_iterator<const value_type> iter(const self^) noexcept safe {
-    return slice_iterator<const value_type>(self.slice());
+  result<unit> flush(self^) safe {
+    result<unit> r = mut self.flush_buf();
+    if (r.is_err()) return rel r;
+    return mut self->inner_.std2::io::writer::flush();
   }
 
-  slice_iterator<value_type> iter(self^) noexcept safe {
-    return slice_iterator<value_type>(self.slice());
+  std::size_t buffered(self const^) noexcept safe {
+    return self->filled_;
   }
 
-  value_type* data(self^) noexcept safe {
-    return self->p_;
+  W const^ get_ref(self const^) noexcept safe {
+    return ^self->inner_;
   }
+};
 
-  const value_type* data(const self^) noexcept safe {
-    return self->p_;
+template<class W>
+impl buf_writer<W>: writer
+{
+  result<std::size_t> write(self^, const [u8; dyn]^ buf) safe override {
+    return self.write(buf);
   }
 
-  size_type size(const self^) noexcept safe {
-    return self->size_;
+  result<unit> flush(self^) safe override {
+    return self.flush();
   }
+};
 
-  size_type capacity(const self^) noexcept safe {
-    return self->capacity_;
+template<class W>
+requires impl<W, vectored_writer>
+impl buf_writer<W>: vectored_writer
+{
+  result<std::size_t> write_vectored(self^, const [const [u8; dyn]^; dyn]^ bufs) safe override {
+    return self.write_vectored(bufs);
   }
+};
 
-  bool empty(const self^) noexcept safe {
-    return self.size() == 0;
-  }
+} // namespace io
 
-  void push_back(self^, T t) safe {
-    if (self.capacity() == self.size()) { self.grow(); }
+////////////////////////////////////////////////////////////////////////////////
+// io/copy.h
 
-    __rel_write(self->p_ + self->size_, rel t);
-    ++self->size_;
-  }
+namespace io
+{
 
-  [value_type; dyn]^ slice(self^) noexcept safe {
-    unsafe { return slice_from_raw_parts(self.data(), self.size()); }
-  }
+// Errors that mean "this kernel path doesn't handle these descriptors"
+// rather than a failed copy.
+inline
+bool is_unsupported_copy(error const^ e) noexcept safe
+{
+  int const code = e.raw_os_error();
+  return code == EXDEV || code == EINVAL || code == ENOSYS ||
+    code == EOPNOTSUPP || code == EBADF || code == ESPIPE;
+}
 
-  const [value_type; dyn]^ slice(const self^) noexcept safe {
-    unsafe { return slice_from_raw_parts(self.data(), self.size()); }
-  }
+// Copies from in to out at their current offsets, trying copy_file_range,
+// then sendfile, then splice through a pipe. Returns false if none of them
+// supports this pair of descriptors; the offsets have still advanced by
+// *copied bytes, so a buffered copy can pick up where this stopped.
+inline
+result<bool> kernel_copy(int in, int out, std::uint64_t^ copied) safe
+{
+  static constexpr std::size_t chunk_size = std::size_t(1) << 30;
+
+  // File to file. The filesystem may share extents instead of copying.
+  // Files in procfs and sysfs report a size of zero, and copy_file_range
+  // returns 0 on them right away. An immediate 0 therefore can't be trusted
+  // as end of input, so it falls back to the buffered copy, which finds out
+  // by reading.
+  std::uint64_t ranged = 0;
+  while (true) {
+    unsafe { auto n = ::copy_file_range(in, nullptr, out, nullptr, chunk_size, 0); }
+    if (n == 0) return .ok(ranged > 0);
+    if (n > 0) {
+      ranged += static_cast<std::uint64_t>(n);
+      mut *copied += static_cast<std::uint64_t>(n);
+      continue;
+    }
 
-  value_type^ operator[](self^, size_type i) noexcept safe {
-    if (i >= self.size()) panic_bounds("vector subscript is out-of-bounds");
-    unsafe { return ^self.data()[i]; }
-  }
-  value_type^ operator[](self^, size_type i, no_runtime_check) noexcept {
-    return ^self.data()[i];
+    auto e = error::last_os_error();
+    if (e.is_interrupted()) continue;
+    if (!is_unsupported_copy(e)) return .err(e);
+    break;
   }
 
-  const value_type^ operator[](const self^, size_type i) noexcept safe {
-    if (i >= self.size()) panic_bounds("vector subscript is out-of-bounds");
-    unsafe { return ^self.data()[i]; }
-  }
-  const value_type^ operator[](const self^, size_type i, no_runtime_check) noexcept {
-    return ^self.data()[i];
-  }
+  // From anything mmap-able (a regular file) to any descriptor, sockets
+  // included.
+  while (true) {
+    unsafe { auto n = ::sendfile(out, in, nullptr, chunk_size); }
+    if (n == 0) return .ok(true);
+    if (n > 0) {
+      mut *copied += static_cast<std::uint64_t>(n);
+      continue;
+    }
 
-  void reserve(self^, size_type n) safe {
-    if (n <= self.capacity()) return;
+    auto e = error::last_os_error();
+    if (e.is_interrupted()) continue;
+    if (!is_unsupported_copy(e)) return .err(e);
+    break;
+  }
+
+  // Anything else, such as a socket to a file, moves pages through a pipe.
+  unsafe { int pipe_fds[2]; }
+  unsafe { int pr = ::pipe2(pipe_fds, O_CLOEXEC); }
+  if (pr < 0) return .ok(false);
+
+  result<bool> r = .ok(true);
+  bool done = false;
+  while (!done) {
+    unsafe { auto n = ::splice(in, nullptr, pipe_fds[1], nullptr, chunk_size, SPLICE_F_MOVE); }
+    if (n == 0) break;
+    if (n < 0) {
+      auto e = error::last_os_error();
+      if (e.is_interrupted()) continue;
+      if (is_unsupported_copy(e)) r = .ok(false);
+      else r = .err(e);
+      break;
+    }
 
-    value_type* p;
-    unsafe {
-      p = static_cast<value_type*>(::operator new(n * sizeof(value_type)));
-      relocate_array(p, self.data(), self.size());
-      ::operator delete(self->p_);
+    auto pending = n;
+    while (pending > 0) {
+      unsafe { auto m = ::splice(pipe_fds[0], nullptr, out, nullptr, static_cast<std::size_t>(pending), SPLICE_F_MOVE); }
+      if (m > 0) {
+        pending -= m;
+        mut *copied += static_cast<std::uint64_t>(m);
+        continue;
+      }
+
+      // The bytes already in the pipe can't be handed back to a buffered
+      // copy, so any failure here is final.
+      if (m == 0) {
+        r = .err(error(EIO));
+      } else {
+        auto e = error::last_os_error();
+        if (e.is_interrupted()) continue;
+        r = .err(e);
+      }
+      done = true;
+      break;
     }
+  }
 
-    self->p_ = p;
-    self->capacity_ = n;
+  unsafe {
+    ::close(pipe_fds[0]);
+    ::close(pipe_fds[1]);
   }
+  return rel r;
+}
 
-private:
+// Copies everything from r to w and returns the number of bytes moved.
+// When both ends are plain descriptors the data stays in the kernel;
+// otherwise it goes through a buffer.
+template<class R, class W>
+result<std::uint64_t> copy(R^ r, W^ w) safe
+requires impl<R, reader> && impl<W, writer>
+{
+  std::uint64_t copied = 0;
 
-  static
-  void relocate_array(value_type* dst, value_type const* src, size_type n) {
-    // TODO: we should add a relocation check here
-    // this code likely isn't sound for types with non-trivial/non-defaulted
-    // relocation operators
-    std::memcpy(dst, src, n * sizeof(value_type));
+  if constexpr (impl<R, raw_fd> && impl<W, raw_fd>) {
+    result<bool> k = kernel_copy(
+      r.std2::io::raw_fd::as_raw_fd(), w.std2::io::raw_fd::as_raw_fd(), ^copied);
+    if (k.is_err()) return .err(k rel.unwrap_err());
+    if (k rel.unwrap()) return .ok(copied);
   }
 
-  void grow(self^) safe {
-    size_type cap = self.capacity();
-    size_type ncap = cap ? 2 * cap : 1;
-    self.reserve(ncap);
+  static constexpr std::size_t chunk_size = 64 * 1024;
+  u8 chunk[chunk_size] {};
+  while (true) {
+    result<std::size_t> m_n = mut r.std2::io::reader::read(^chunk);
+    if (m_n.is_err()) return .err(m_n rel.unwrap_err());
+
+    std::size_t n = m_n rel.unwrap();
+    if (n == 0) return .ok(copied);
+
+    unsafe { auto data = slice_from_raw_parts(chunk + 0, n); }
+    result<unit> wr = write_all(w, data);
+    if (wr.is_err()) return .err(wr rel.unwrap_err());
+    copied += n;
   }
+}
 
-  value_type* unsafe  p_;
-  size_type capacity_;
-  size_type size_;
-  // value_type __phantom_data;
+} // namespace io
+
+namespace fs
+{
+
+// Reads a whole file and validates it as UTF-8 in one pass.
+inline
+io::result<string> read_to_string(str path) safe
+{
+  io::result<file> m_f = file::open(path);
+  if (m_f.is_err()) return .err(m_f rel.unwrap_err());
+  file f = m_f rel.unwrap();
+
+  vector<u8> bytes = {};
+  io::result<std::uint64_t> size = f.size();
+  if (size.is_ok()) mut bytes.reserve(static_cast<std::size_t>(size rel.unwrap()));
+
+  io::result<std::size_t> r = io::read_to_end(^f, ^bytes);
+  if (r.is_err()) return .err(r rel.unwrap_err());
+
+  return io::bytes_into_string(rel bytes);
+}
+
+inline
+io::result<unit> write(str path, const [u8; dyn]^ data) safe
+{
+  io::result<file> m_f = file::create(path);
+  if (m_f.is_err()) return .err(m_f rel.unwrap_err());
+  file f = m_f rel.unwrap();
+  return io::write_all(^f, data);
+}
+
+// Copies the contents of from into to, creating or truncating it, and
+// returns the number of bytes copied. The data stays in the kernel when
+// copy_file_range, sendfile or splice handles the pair; otherwise it goes
+// through a buffer in user space.
+inline
+io::result<std::uint64_t> copy(str from, str to) safe
+{
+  io::result<file> m_src = file::open(from);
+  if (m_src.is_err()) return .err(m_src rel.unwrap_err());
+  file src = m_src rel.unwrap();
+
+  io::result<file> m_dst = file::create(to);
+  if (m_dst.is_err()) return .err(m_dst rel.unwrap_err());
+  file dst = m_dst rel.unwrap();
+
+  return io::copy(^src, ^dst);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// mmap.h
+
+enum class advice
+{
+  normal,
+  sequential,
+  random,
+  willneed,
+  dontneed,
+  hugepage,
 };
 
-template<class T>
-impl into_iterator<T>: iterator
+// A read-only, private mapping of a whole file. Views borrow from the
+// mapping, so none of them can outlive the munmap in the destructor.
+class mmap
 {
-  using item_type = T;
+  u8 const* unsafe p_;
+  std::size_t len_;
 
-  optional<item_type> next(self^) safe override {
-    return self.next();
+  mmap(u8 const* p, std::size_t len) noexcept safe
+    : p_(p)
+    , len_(len)
+  {
   }
-};
 
-template<class T>
-impl vector<T>: make_iter {
-  using iter_type = slice_iterator<T const>;
-  using iter_mut_type = slice_iterator<T>;
-  using into_iter_type  = into_iterator<T>;
+public:
+  // Not safe: the mapping reflects later changes to the file. The caller
+  // must ensure no one truncates or writes to the file while the mapping
+  // lives. Truncation raises SIGBUS on access, and writes can change bytes
+  // that as_str() has already validated.
+  static io::result<mmap> map(file const^ f) {
+    io::result<std::uint64_t> m_size = f.size();
+    if (m_size.is_err()) return .err(m_size rel.unwrap_err());
 
-  iter_type iter(self const^) noexcept safe override {
-    return slice_iterator<const T>(self.slice());
+    std::size_t const len = static_cast<std::size_t>(m_size rel.unwrap());
+
+    // mmap() rejects empty mappings, but an empty file is a valid view.
+    if (len == 0) return .ok(mmap(nullptr, 0));
+
+    unsafe { void* p = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, f.as_raw_fd(), 0); }
+    if (p == MAP_FAILED) return .err(io::error::last_os_error());
+
+    unsafe { return .ok(mmap(static_cast<u8 const*>(p), len)); }
   }
 
-  iter_mut_type iter(self^) noexcept safe override {
-    return slice_iterator<T>(self.slice());
+  mmap(mmap const^) = delete;
+
+  ~mmap() safe {
+    if (p_)
+      unsafe { ::munmap(const_cast<u8*>(p_), len_); }
   }
 
-  into_iter_type iter(self) noexcept safe override {
-    auto p = self^.data();
-    auto len = self.size();
-    forget(rel self);
-    unsafe { return into_iter_type(p, p + len); }
+  const [u8; dyn]^ bytes(self const^) noexcept safe {
+    unsafe { return slice_from_raw_parts(self->p_, self->len_); }
+  }
+
+  // Validates the whole mapping as UTF-8 once.
+  optional<str> as_str(self const^) noexcept safe {
+    unsafe {
+      auto chars = slice_from_raw_parts(reinterpret_cast<char const*>(self->p_), self->len_);
+    }
+    if (!str::is_valid_utf(chars)) return .none;
+    unsafe { return .some(str(chars, str::no_utf_check{})); }
+  }
+
+  std::size_t size(self const^) noexcept safe {
+    return self->len_;
+  }
+
+  bool empty(self const^) noexcept safe {
+    return self->len_ == 0;
+  }
+
+  io::result<unit> advise(self const^, advice a) safe {
+    if (self->len_ == 0) return .ok(unit{});
+
+    int flag = MADV_NORMAL;
+    switch (a) {
+      case advice::normal: flag = MADV_NORMAL; break;
+      case advice::sequential: flag = MADV_SEQUENTIAL; break;
+      case advice::random: flag = MADV_RANDOM; break;
+      case advice::willneed: flag = MADV_WILLNEED; break;
+      case advice::dontneed: flag = MADV_DONTNEED; break;
+      case advice::hugepage: flag = MADV_HUGEPAGE; break;
+    }
+
+    unsafe { int r = ::madvise(const_cast<u8*>(self->p_), self->len_, flag); }
+    if (r < 0) return .err(io::error::last_os_error());
+    return .ok(unit{});
   }
 };
 
+} // namespace fs
+
+#endif // defined(__linux__)
+
 } // namespace std
@@ -0,0 +1,215 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+static_assert(std2::latch~is_send);
+static_assert(std2::latch~is_sync);
+static_assert(std2::semaphore~is_send);
+static_assert(std2::semaphore~is_sync);
+static_assert(std2::barrier<>~is_send);
+static_assert(std2::barrier<>~is_sync);
+
+static int const num_threads = 8;
+
+struct latch_state
+{
+  std2::latch start;
+  std2::latch done;
+  std2::mutex<int> count;
+};
+
+void latch_worker(std2::arc<latch_state> sp) safe
+{
+  sp->start.wait();
+  {
+    auto guard = sp->count.lock();
+    mut *guard.borrow() += 1;
+  }
+  sp->done.count_down();
+  drp sp;
+}
+
+void latch_test() safe
+{
+  {
+    std2::latch l{2};
+    assert_true(!l.try_wait());
+    l.count_down();
+    assert_true(!l.try_wait());
+    l.count_down();
+    assert_true(l.try_wait());
+    l.wait();
+  }
+
+  {
+    std2::arc<latch_state> sp{latch_state{
+      std2::latch(1),
+      std2::latch(static_cast<std::uint32_t>(num_threads)),
+      std2::mutex(0)}};
+
+    std2::vector<std2::thread> threads = {};
+    for (int i = 0; i < num_threads; ++i) {
+      mut threads.push_back(std2::thread(latch_worker, cpy sp));
+    }
+
+    assert_eq(*sp->count.lock(), 0);
+    sp->start.count_down();
+    sp->done.wait();
+    assert_eq(*sp->count.lock(), num_threads);
+
+    for (std2::thread t : rel threads) {
+      t rel.join();
+    }
+  }
+}
+
+struct semaphore_state
+{
+  std2::semaphore sem;
+  std2::mutex<int> active;
+  std2::mutex<int> peak;
+};
+
+void semaphore_worker(std2::arc<semaphore_state> sp) safe
+{
+  for (int i = 0; i < 100; ++i) {
+    auto permit = sp->sem.acquire();
+
+    int n;
+    {
+      auto guard = sp->active.lock();
+      n = (mut *guard.borrow() += 1);
+    }
+    {
+      auto guard = sp->peak.lock();
+      int^ peak = mut guard.borrow();
+      if (n > *peak) *peak = n;
+    }
+
+    unsafe { std::this_thread::yield(); }
+
+    {
+      auto guard = sp->active.lock();
+      mut *guard.borrow() -= 1;
+    }
+  }
+  drp sp;
+}
+
+void semaphore_test() safe
+{
+  {
+    std2::semaphore sem{1};
+    {
+      auto p = sem.acquire();
+      assert_eq(sem.available(), 0u);
+
+      auto mp = sem.try_acquire();
+      assert_true(mp.is_none());
+    }
+    assert_eq(sem.available(), 1u);
+
+    auto mp = sem.try_acquire();
+    assert_true(mp.is_some());
+  }
+
+  {
+    static std::uint32_t const permits = 3;
+
+    std2::arc<semaphore_state> sp{semaphore_state{
+      std2::semaphore(permits), std2::mutex(0), std2::mutex(0)}};
+
+    std2::vector<std2::thread> threads = {};
+    for (int i = 0; i < num_threads; ++i) {
+      mut threads.push_back(std2::thread(semaphore_worker, cpy sp));
+    }
+
+    for (std2::thread t : rel threads) {
+      t rel.join();
+    }
+
+    assert_true(*sp->peak.lock() <= static_cast<int>(permits));
+    assert_eq(sp->sem.available(), permits);
+  }
+}
+
+struct phase_counter
+{
+  std2::arc<std2::mutex<int>> phases;
+
+  void operator()(self const^) safe {
+    auto guard = self->phases->lock();
+    mut *guard.borrow() += 1;
+  }
+};
+
+using barrier_type = std2::barrier<phase_counter>;
+
+struct barrier_state
+{
+  barrier_type b;
+  std2::mutex<int> arrived;
+  std2::arc<std2::mutex<int>> phases;
+};
+
+void barrier_worker(std2::arc<barrier_state> sp) safe
+{
+  for (int phase = 0; phase < 10; ++phase) {
+    {
+      auto guard = sp->arrived.lock();
+      mut *guard.borrow() += 1;
+    }
+
+    sp->b.arrive_and_wait();
+
+    // Nobody passes the barrier until everyone has arrived for this phase
+    // and the completion function has run exactly once.
+    assert_true(*sp->arrived.lock() >= (phase + 1) * num_threads);
+    assert_true(*sp->phases->lock() >= phase + 1);
+
+    sp->b.arrive_and_wait();
+  }
+  drp sp;
+}
+
+void barrier_test() safe
+{
+  {
+    std2::barrier<> b{1};
+    b.arrive_and_wait();
+    b.arrive_and_wait();
+  }
+
+  {
+    std2::arc<std2::mutex<int>> phases{std2::mutex(0)};
+    std2::arc<barrier_state> sp{barrier_state{
+      barrier_type(static_cast<std::uint32_t>(num_threads), phase_counter{cpy phases}),
+      std2::mutex(0),
+      cpy phases}};
+
+    std2::vector<std2::thread> threads = {};
+    for (int i = 0; i < num_threads; ++i) {
+      mut threads.push_back(std2::thread(barrier_worker, cpy sp));
+    }
+
+    for (std2::thread t : rel threads) {
+      t rel.join();
+    }
+
+    assert_eq(*phases->lock(), 20);
+    assert_eq(*sp->arrived.lock(), 10 * num_threads);
+  }
+}
+
+int main() safe
+{
+  latch_test();
+  semaphore_test();
+  barrier_test();
+}
@@ -0,0 +1,179 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+void bitvec_basics() safe
+{
+  std2::bitvec b = {};
+  assert_true(b.empty());
+
+  for (std::size_t i = 0; i < 130; ++i) {
+    mut b.push_back(i % 3 == 0);
+  }
+  assert_eq(b.size(), 130u);
+  assert_eq((*b.words())~length, 3u);
+  assert_true(b.test(0));
+  assert_true(!b.test(1));
+  assert_true(b.test(129));
+  assert_eq(b.count_ones(), 44u);
+
+  mut b.set(1);
+  mut b.reset(0);
+  mut b.flip(2);
+  assert_true(b.test(1));
+  assert_true(!b.test(0));
+  assert_true(b.test(2));
+  assert_eq(b.count_ones(), 45u);
+
+  assert_true(mut b.pop_back().unwrap());
+  assert_eq(b.size(), 129u);
+
+  // Shrinking clears the bits past the new end, so growing with zeros
+  // doesn't bring them back.
+  mut b.resize(64);
+  assert_eq((*b.words())~length, 1u);
+  mut b.resize(200);
+  assert_eq(b.count_ones(), 23u);
+  mut b.resize(210, true);
+  assert_eq(b.count_ones(), 33u);
+  assert_true(b.test(209));
+
+  mut b.flip_all();
+  assert_eq(b.count_ones(), 210u - 33u);
+  assert_eq(b.count_zeros(), 33u);
+
+  std2::bitvec full(70, true);
+  assert_true(full.all());
+  assert_eq((*full.words())[1], 0x3fu);
+  mut full.fill(false);
+  assert_true(full.none());
+}
+
+void bitvec_ops() safe
+{
+  std2::bitvec a(100, false);
+  std2::bitvec b(100, false);
+  for (std::size_t i = 0; i < 100; i += 2) mut a.set(i);
+  for (std::size_t i = 0; i < 100; i += 3) mut b.set(i);
+
+  std2::bitvec c(100, false);
+  mut c |= a;
+  mut c &= b;
+  assert_eq(c.count_ones(), 17u);
+
+  mut c |= a;
+  mut c ^= b;
+  assert_eq(c.count_ones(), 50u + 34u - 2u * 17u);
+
+  std2::bitvec d(100, false);
+  mut d |= c;
+  assert_true(d == c);
+  mut d.flip(99);
+  assert_true(!(d == c));
+}
+
+void iter_ones() safe
+{
+  std2::bitvec b(300, false);
+  mut b.set(0);
+  mut b.set(63);
+  mut b.set(64);
+  mut b.set(299);
+
+  std2::vector<std::size_t> ones = std2::iter::collect(b.iter_ones());
+  assert_eq(ones.size(), 4u);
+  assert_eq(ones[0], 0u);
+  assert_eq(ones[1], 63u);
+  assert_eq(ones[2], 64u);
+  assert_eq(ones[3], 299u);
+
+  std2::bitvec empty = {};
+  assert_eq(std2::iter::count(empty.iter_ones()), 0u);
+
+  auto it = b.iter_ones();
+  for (int i = 0; i < 4; ++i) mut it.next();
+  assert_true((mut it.next()).is_none());
+  assert_true((mut it.next()).is_none());
+}
+
+void bitset() safe
+{
+  std2::bitset<100> a = {};
+  std2::bitset<100> b = {};
+  assert_true(a.none());
+  assert_eq(std2::bitset<100>::size(), 100u);
+
+  for (std::size_t i = 0; i < 100; i += 2) mut a.set(i);
+  for (std::size_t i = 0; i < 100; i += 5) mut b.set(i);
+
+  assert_eq((a & b).count_ones(), 10u);
+  assert_eq((a | b).count_ones(), 60u);
+  assert_eq((a ^ b).count_ones(), 50u);
+  assert_eq((~a).count_ones(), 50u);
+  assert_true((~a).test(1));
+  assert_true(!(~a).test(0));
+
+  std2::bitset<100> c = ~std2::bitset<100>{};
+  assert_true(c.all());
+  assert_eq((*c.words())[1], 0xfffffffffu);
+
+  mut c.flip(99);
+  mut c.reset(0);
+  assert_eq(c.count_zeros(), 2u);
+  assert_eq(std2::iter::count(c.iter_ones()), 98u);
+  assert_true(!(c == ~std2::bitset<100>{}));
+
+  std2::bitset<64> w = {};
+  mut w.fill(true);
+  assert_eq((*w.words())[0], ~std::uint64_t(0));
+}
+
+void rank_select() safe
+{
+  // Every fifth bit, plus an empty stretch spanning whole superblocks.
+  std2::bitvec b(5000, false);
+  for (std::size_t i = 0; i < 1000; i += 5) mut b.set(i);
+  for (std::size_t i = 3000; i < 5000; i += 5) mut b.set(i);
+
+  std2::rank_select rs(rel b);
+  assert_eq(rs.size(), 5000u);
+  assert_eq(rs.count_ones(), 600u);
+
+  assert_eq(rs.rank1(0), 0u);
+  assert_eq(rs.rank1(1), 1u);
+  assert_eq(rs.rank1(5), 1u);
+  assert_eq(rs.rank1(6), 2u);
+  assert_eq(rs.rank1(512), 103u);
+  assert_eq(rs.rank1(2000), 200u);
+  assert_eq(rs.rank1(3001), 201u);
+  assert_eq(rs.rank1(5000), 600u);
+  assert_eq(rs.rank0(10), 8u);
+
+  assert_eq(rs.select1(0).unwrap(), 0u);
+  assert_eq(rs.select1(1).unwrap(), 5u);
+  assert_eq(rs.select1(199).unwrap(), 995u);
+  assert_eq(rs.select1(200).unwrap(), 3000u);
+  assert_eq(rs.select1(599).unwrap(), 4995u);
+  assert_true(rs.select1(600).is_none());
+
+  for (std::size_t k = 0; k < 600; ++k) {
+    std::size_t const i = rs.select1(k).unwrap();
+    assert_true(rs.test(i));
+    assert_eq(rs.rank1(i), k);
+  }
+}
+
+int main() safe
+{
+  bitvec_basics();
+  bitvec_ops();
+  iter_ones();
+  bitset();
+  rank_select();
+}
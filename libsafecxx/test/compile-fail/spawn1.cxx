@@ -0,0 +1,39 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+// Reads a local through a borrow when it's polled.
+class read_local/(a)
+{
+  int^/a x_;
+
+public:
+  explicit read_local(int^/a x) safe
+    : x_(x)
+  {
+  }
+
+  std2::poll_result<int> poll(self^, std2::context^ cx) safe {
+    return .ready(*self->x_);
+  }
+};
+
+impl read_local: std2::future
+{
+  using output_type = int;
+
+  std2::poll_result<output_type> poll(self^, std2::context^ cx) safe override {
+    return self.poll(cx);
+  }
+};
+
+int main() safe
+{
+  std2::local_executor ex{};
+  int x = 1337;
+  ex.spawn(read_local(^x));
+}
@@ -0,0 +1,171 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+std2::vector<(int, int)> entries(int n, int mul) safe
+{
+  // Keys in a scrambled order, each with value key * mul.
+  std2::vector<(int, int)> v = {};
+  for (int i = 0; i < n; ++i) {
+    int const k = (i * 7) % n;
+    mut v.push_back((k, k * mul));
+  }
+  return v;
+}
+
+void map_construction() safe
+{
+  std2::flat_map<int, int> m(entries(10, 10));
+  assert_eq(m.size(), 10u);
+  for (std::size_t i = 0; i < 10; ++i) {
+    assert_eq((*m.keys())[i], static_cast<int>(i));
+    assert_eq((*m.values())[i], static_cast<int>(i) * 10);
+  }
+
+  // The last of several equal keys wins.
+  std2::vector<(int, int)> dups = {};
+  mut dups.push_back((3, 1));
+  mut dups.push_back((1, 1));
+  mut dups.push_back((3, 2));
+  mut dups.push_back((3, 3));
+  std2::flat_map<int, int> d(rel dups);
+  int const three = 3;
+  assert_eq(d.size(), 2u);
+  assert_eq(*d.get(three).unwrap(), 3);
+
+  std2::flat_map<int, int> e = {};
+  assert_true(e.empty());
+  assert_true(e.get(three).is_none());
+}
+
+void map_lookup() safe
+{
+  std2::flat_map<int, int> m(entries(100, 2));
+  int const first = 0;
+  int const last = 99;
+  int const past = 100;
+  int const before = -1;
+  int const k = 42;
+
+  assert_true(m.contains(first));
+  assert_true(m.contains(last));
+  assert_true(!m.contains(past));
+  assert_true(!m.contains(before));
+  assert_eq(*m.get(k).unwrap(), 84);
+
+  *(mut m.get(k)).unwrap() = 7;
+  assert_eq(*m.get(k).unwrap(), 7);
+
+  int sum = 0;
+  for ((int const^, int const^) kv : m.iter()) sum += *kv.1;
+  assert_eq(sum, 2 * 4950 - 84 + 7);
+}
+
+void map_modify() safe
+{
+  std2::flat_map<int, int> m = {};
+  assert_true((mut m.insert(5, 50)).is_none());
+  assert_true((mut m.insert(1, 10)).is_none());
+  assert_true((mut m.insert(9, 90)).is_none());
+  assert_true((mut m.insert(3, 30)).is_none());
+  assert_eq(mut m.insert(5, 55).unwrap(), 50);
+
+  assert_eq(m.size(), 4u);
+  assert_eq((*m.keys())[0], 1);
+  assert_eq((*m.keys())[1], 3);
+  assert_eq((*m.keys())[2], 5);
+  assert_eq((*m.values())[2], 55);
+  assert_eq((*m.keys())[3], 9);
+
+  int const three = 3;
+  assert_eq(mut m.remove(three).unwrap(), 30);
+  assert_true((mut m.remove(three)).is_none());
+  assert_eq(m.size(), 3u);
+  assert_eq((*m.keys())[1], 5);
+  assert_eq((*m.values())[1], 55);
+}
+
+void map_insert_range() safe
+{
+  std2::flat_map<int, int> m(entries(10, 1));
+
+  // Overlaps 5..9 and adds 10..14, replacing the overlapping values.
+  std2::vector<(int, int)> more = {};
+  for (int k = 14; k >= 5; --k) mut more.push_back((k, -k));
+  mut m.insert_range(rel more);
+
+  assert_eq(m.size(), 15u);
+  for (std::size_t i = 0; i < 15; ++i) {
+    int const k = static_cast<int>(i);
+    assert_eq((*m.keys())[i], k);
+    assert_eq((*m.values())[i], k < 5 ? k : -k);
+  }
+
+  mut m.insert_range(std2::vector<(int, int)>{});
+  assert_eq(m.size(), 15u);
+}
+
+void map_strings() safe
+{
+  std2::vector<(int, std2::string)> v = {};
+  mut v.push_back((3, std2::string("pear")));
+  mut v.push_back((1, std2::string("apple")));
+  mut v.push_back((2, std2::string("fig")));
+
+  std2::flat_map<int, std2::string> m(rel v);
+  int const two = 2;
+  assert_true((*m.get(two).unwrap()).str() == "fig");
+  assert_true((*m.values())[0].str() == "apple");
+
+  assert_true((mut m.insert(0, std2::string("banana"))).is_none());
+  assert_true((*m.values())[0].str() == "banana");
+  assert_true((mut m.insert(2, std2::string("kiwi"))).unwrap().str() == "fig");
+  assert_true((mut m.remove(two)).unwrap().str() == "kiwi");
+  assert_true((*m.values())[2].str() == "pear");
+}
+
+void set() safe
+{
+  std2::vector<int> keys = { 5, 3, 5, 1, 3, 9 };
+  std2::flat_set<int> s(rel keys);
+  assert_eq(s.size(), 4u);
+  assert_eq((*s.keys())[0], 1);
+  assert_eq((*s.keys())[3], 9);
+  int const one = 1;
+  int const three = 3;
+  int const four = 4;
+  assert_true(s.contains(three));
+  assert_true(!s.contains(four));
+
+  assert_true(mut s.insert(4));
+  assert_true(!(mut s.insert(4)));
+  assert_eq((*s.keys())[2], 4);
+
+  assert_true(mut s.remove(one));
+  assert_true(!(mut s.remove(one)));
+  assert_eq((*s.keys())[0], 3);
+
+  std2::vector<int> more = { 10, 2, 9, 4 };
+  mut s.insert_range(rel more);
+  assert_eq(s.size(), 6u);
+  int expected[] = { 2, 3, 4, 5, 9, 10 };
+  for (std::size_t i = 0; i < 6; ++i) {
+    assert_eq((*s.keys())[i], expected[i]);
+  }
+}
+
+int main() safe
+{
+  map_construction();
+  map_lookup();
+  map_modify();
+  map_insert_range();
+  map_strings();
+  set();
+}
@@ -0,0 +1,235 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+using std2::u8;
+using std2::fs::file;
+
+std2::vector<u8> bytes_of(std2::string_view sv) safe
+{
+  std2::vector<u8> v = {};
+  unsafe {
+    mut v.extend_from_slice(
+      std2::slice_from_raw_parts(reinterpret_cast<u8 const*>(sv.data()), sv.size()));
+  }
+  return v;
+}
+
+void file_roundtrip() safe
+{
+  std2::string_view path = "/tmp/std2-fs-roundtrip.txt";
+  {
+    file f = file::create(path).unwrap();
+    std2::vector<u8> data = bytes_of("hello, world!\n");
+    assert_eq(mut f.write(data.slice()).unwrap(), data.size());
+    f.sync_all().unwrap();
+    assert_eq(f.size().unwrap(), 14u);
+  }
+
+  {
+    file f = file::open(path).unwrap();
+    u8 buf[5] {};
+    assert_eq(f.pread(^buf, 7).unwrap(), 5u);
+    assert_eq(buf[0], 'w');
+    assert_eq(buf[4], 'd');
+
+    // pread doesn't move the offset.
+    assert_eq(mut f.read(^buf).unwrap(), 5u);
+    assert_eq(buf[0], 'h');
+  }
+
+  assert_true(file::open("/tmp/std2-fs-does-not-exist").is_err());
+
+  // An embedded NUL would silently cut the path short.
+  const char nul_path[] { '/', 't', 'm', 'p', '/', '\0', 'x' };
+  std2::io::result<file> bad = file::create(std2::string_view(^nul_path));
+  assert_true(bad.is_err());
+  assert_eq(bad rel.unwrap_err().raw_os_error(), EINVAL);
+  unsafe { ::unlink("/tmp/std2-fs-roundtrip.txt"); }
+}
+
+void buffered_lines() safe
+{
+  std2::string_view path = "/tmp/std2-fs-lines.txt";
+  {
+    // A tiny buffer forces every write through the flush path.
+    std2::io::buf_writer<file> w(file::create(path).unwrap(), 4);
+    for (int i = 0; i < 100; ++i) {
+      mut w.write(bytes_of("line\n").slice()).unwrap();
+    }
+    mut w.write(bytes_of("π is not ascii").slice()).unwrap();
+    mut w.flush().unwrap();
+    assert_eq(w.buffered(), 0u);
+  }
+
+  {
+    // Also small enough that the two-byte code point straddles a refill.
+    std2::io::buf_reader<file> r(file::open(path).unwrap(), 3);
+    int lines = 0;
+    while (true) {
+      std2::string line = {};
+      std::size_t n = mut r.read_line(^line).unwrap();
+      if (n == 0) break;
+
+      if (lines < 100) assert_true(line.str() == "line\n");
+      else assert_true(line.str() == "π is not ascii");
+      ++lines;
+    }
+    assert_eq(lines, 101);
+  }
+
+  std2::string s = std2::fs::read_to_string(path).unwrap();
+  assert_eq(s.size(), 100u * 5u + 15u);
+
+  {
+    // The file is read-only, so the flush fails and the bytes stay buffered.
+    std2::io::buf_writer<file> w(file::open(path).unwrap(), 4);
+    mut w.write(bytes_of("abc").slice()).unwrap();
+    assert_true(mut w.write(bytes_of("defgh").slice()).is_err());
+    assert_eq(w.buffered(), 3u);
+    assert_true(mut w.flush().is_err());
+    assert_eq(w.buffered(), 3u);
+  }
+  unsafe { ::unlink("/tmp/std2-fs-lines.txt"); }
+}
+
+void invalid_utf8() safe
+{
+  std2::string_view path = "/tmp/std2-fs-invalid.txt";
+
+  std2::vector<u8> data = bytes_of("ok\n");
+  mut data.push_back(0xff);
+  mut data.push_back('\n');
+  std2::fs::write(path, data.slice()).unwrap();
+
+  std2::io::buf_reader<file> r(file::open(path).unwrap());
+  std2::string line = {};
+  assert_eq(mut r.read_line(^line).unwrap(), 3u);
+
+  std2::io::result<std::size_t> bad = mut r.read_line(^line);
+  assert_true(bad.is_err());
+  assert_eq(bad rel.unwrap_err().raw_os_error(), EILSEQ);
+
+  assert_true(std2::fs::read_to_string(path).is_err());
+  unsafe { ::unlink("/tmp/std2-fs-invalid.txt"); }
+}
+
+void mapped() safe
+{
+  std2::string_view path = "/tmp/std2-fs-mmap.txt";
+  std2::fs::write(path, bytes_of("mapped contents").slice()).unwrap();
+
+  {
+    file f = file::open(path).unwrap();
+    // Nothing else touches the file while it's mapped.
+    unsafe { std2::fs::mmap m = std2::fs::mmap::map(f).unwrap(); }
+    m.advise(std2::fs::advice::sequential).unwrap();
+
+    const [u8; dyn]^ b = m.bytes();
+    assert_eq((*b)~length, 15u);
+    assert_eq(b[0], 'm');
+
+    std2::str s = m.as_str().unwrap();
+    assert_true(s == "mapped contents");
+  }
+
+  {
+    std2::fs::write(path, bytes_of("").slice()).unwrap();
+    file f = file::open(path).unwrap();
+    unsafe { std2::fs::mmap m = std2::fs::mmap::map(f).unwrap(); }
+    assert_true(m.empty());
+    assert_eq(m.as_str().unwrap().size(), 0u);
+  }
+
+  unsafe { ::unlink("/tmp/std2-fs-mmap.txt"); }
+}
+
+void vectored() safe
+{
+  std2::string_view path = "/tmp/std2-fs-vectored.txt";
+  std2::vector<u8> head = bytes_of("head:");
+  std2::vector<u8> body = bytes_of("body");
+  std2::vector<u8> tail = bytes_of(":tail");
+
+  {
+    file f = file::create(path).unwrap();
+    const [u8; dyn]^ parts[3] { head.slice(), body.slice(), tail.slice() };
+    assert_eq(mut f.write_vectored(^parts).unwrap(), 14u);
+  }
+
+  {
+    // Small writes stay buffered; the last one overflows the buffer and is
+    // gathered together with the buffered bytes.
+    std2::io::buf_writer<file> w(file::open_with(path, std2::fs::open_options{ .write = true, .append = true }).unwrap(), 16);
+    const [u8; dyn]^ small[2] { head.slice(), body.slice() };
+    assert_eq(mut w.write_vectored(^small).unwrap(), 9u);
+    assert_eq(w.buffered(), 9u);
+
+    const [u8; dyn]^ big[3] { tail.slice(), head.slice(), tail.slice() };
+    assert_eq(mut w.write_vectored(^big).unwrap(), 15u);
+    assert_eq(w.buffered(), 0u);
+
+    // It's a vectored_writer itself, so the generic helpers take it too.
+    std2::io::write_all_vectored(^w, ^small).unwrap();
+    assert_eq(w.buffered(), 9u);
+  }
+
+  {
+    file f = file::open(path).unwrap();
+    std2::vector<u8> a = bytes_of("xxxxx");
+    std2::vector<u8> b = bytes_of("xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx");
+    [u8; dyn]^ parts[2] { mut a.slice(), mut b.slice() };
+    assert_eq(mut f.read_vectored(^parts).unwrap(), 39u);
+    assert_eq(a[4], ':');
+    assert_eq(b[0], 'b');
+  }
+
+  std2::string s = std2::fs::read_to_string(path).unwrap();
+  assert_true(s.str() == "head:body:tailhead:body:tailhead::tailhead:body");
+  unsafe { ::unlink("/tmp/std2-fs-vectored.txt"); }
+}
+
+void copies() safe
+{
+  std2::vector<u8> data = {};
+  for (int i = 0; i < 300'000; ++i) {
+    mut data.push_back(static_cast<u8>('a' + i % 26));
+  }
+  std2::fs::write("/tmp/std2-fs-copy-src.txt", data.slice()).unwrap();
+
+  // Both ends are files, so this stays in the kernel.
+  assert_eq(std2::fs::copy("/tmp/std2-fs-copy-src.txt", "/tmp/std2-fs-copy-dst.txt").unwrap(), 300'000u);
+  std2::string s = std2::fs::read_to_string("/tmp/std2-fs-copy-dst.txt").unwrap();
+  assert_eq(s.size(), 300'000u);
+
+  // A buffered reader isn't a plain descriptor, so this takes the
+  // user-space loop.
+  {
+    std2::io::buf_reader<file> r(file::open("/tmp/std2-fs-copy-src.txt").unwrap());
+    file dst = file::create("/tmp/std2-fs-copy-dst.txt").unwrap();
+    assert_eq(std2::io::copy(^r, ^dst).unwrap(), 300'000u);
+  }
+  std2::string t = std2::fs::read_to_string("/tmp/std2-fs-copy-dst.txt").unwrap();
+  assert_true(t.str() == s.str());
+
+  unsafe {
+    ::unlink("/tmp/std2-fs-copy-src.txt");
+    ::unlink("/tmp/std2-fs-copy-dst.txt");
+  }
+}
+
+int main() safe
+{
+  file_roundtrip();
+  buffered_lines();
+  invalid_utf8();
+  mapped();
+  vectored();
+  copies();
+}
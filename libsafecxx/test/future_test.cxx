@@ -0,0 +1,139 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+// Yields back to the executor n times before completing with n.
+class countdown
+{
+  int n_;
+  int remaining_;
+
+public:
+  explicit countdown(int n) safe
+    : n_(n)
+    , remaining_(n)
+  {
+  }
+
+  std2::poll_result<int> poll(self^, std2::context^ cx) safe {
+    if (self->remaining_ == 0) return .ready(self->n_);
+
+    --self->remaining_;
+    cx.get_waker().wake();
+    return .pending;
+  }
+};
+
+impl countdown: std2::future
+{
+  using output_type = int;
+
+  std2::poll_result<output_type> poll(self^, std2::context^ cx) safe override {
+    return self.poll(cx);
+  }
+};
+
+// Awaits a join_handle and adds an offset to its output.
+class add_to
+{
+  std2::join_handle<int> h_;
+  int offset_;
+
+public:
+  add_to(std2::join_handle<int> h, int offset) safe
+    : h_(rel h)
+    , offset_(offset)
+  {
+  }
+
+  std2::poll_result<int> poll(self^, std2::context^ cx) safe {
+    std2::poll_result<int> r = mut self->h_.poll(cx);
+    if (r.is_pending()) return .pending;
+    return .ready(r rel.unwrap() + self->offset_);
+  }
+};
+
+impl add_to: std2::future
+{
+  using output_type = int;
+
+  std2::poll_result<output_type> poll(self^, std2::context^ cx) safe override {
+    return self.poll(cx);
+  }
+};
+
+// Spawns a countdown from inside a running task and awaits it.
+class spawn_inner
+{
+  std2::spawner s_;
+  std2::optional<std2::join_handle<int>> h_;
+
+public:
+  explicit spawn_inner(std2::spawner s) safe
+    : s_(rel s)
+    , h_(.none)
+  {
+  }
+
+  std2::poll_result<int> poll(self^, std2::context^ cx) safe {
+    if (self->h_.is_none()) {
+      self->h_ = .some(self->s_.spawn(countdown(3)));
+    }
+
+    std2::join_handle<int>^ h = match(self->h_) -> std2::join_handle<int>^ {
+      .some(^h) => h;
+      .none => std2::panic("unreachable");
+    };
+    return mut h.poll(cx);
+  }
+};
+
+impl spawn_inner: std2::future
+{
+  using output_type = int;
+
+  std2::poll_result<output_type> poll(self^, std2::context^ cx) safe override {
+    return self.poll(cx);
+  }
+};
+
+void block_on_test() safe
+{
+  std2::local_executor ex{};
+
+  assert_eq(mut ex.block_on(std2::ready_future<int>(1234)), 1234);
+  assert_eq(mut ex.block_on(countdown(10)), 10);
+  assert_true(ex.is_idle());
+}
+
+void spawn_test() safe
+{
+  std2::local_executor ex{};
+
+  std2::join_handle<int> h1 = ex.spawn(countdown(5));
+  std2::join_handle<int> h2 = ex.spawn(std2::ready_future<int>(7));
+
+  assert_eq(mut ex.block_on(add_to(rel h1, 100)), 105);
+  assert_eq(mut ex.block_on(add_to(rel h2, 1)), 8);
+
+  // Tasks run to completion even if nobody awaits them.
+  for (int i = 0; i < 16; ++i) {
+    ex.spawn(countdown(i));
+  }
+  mut ex.run();
+  assert_true(ex.is_idle());
+
+  assert_eq(mut ex.block_on(spawn_inner(ex.get_spawner())), 3);
+}
+
+int main() safe
+{
+  block_on_test();
+  spawn_test();
+}
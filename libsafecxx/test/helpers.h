@@ -5,6 +5,22 @@
 #pragma once
 #feature on safety
 
+#include <cstdint>
+
+// A small deterministic generator for randomized tests. The seed must be
+// non-zero.
+struct xorshift
+{
+  std::uint64_t s;
+
+  std::uint64_t operator()(self^) safe {
+    self->s ^= self->s << 13;
+    self->s ^= self->s >> 7;
+    self->s ^= self->s << 17;
+    return self->s;
+  }
+};
+
 template<class T, class U>
 void assert_eq(const T^ t, const U^ u) safe
 {
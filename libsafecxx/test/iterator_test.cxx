@@ -0,0 +1,328 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+namespace iter = std2::iter;
+
+std2::vector<int> iota(int n) safe
+{
+  std2::vector<int> v = {};
+  for (int i = 0; i < n; ++i) {
+    mut v.push_back(i);
+  }
+  return v;
+}
+
+void adaptors() safe
+{
+  std2::vector<int> v = iota(10);
+
+  {
+    auto it = iter::map(iter::copied(v.iter()), [](int x) safe { return x * x; });
+    std2::vector<int> squares = iter::collect(rel it);
+    assert_eq(squares.size(), 10u);
+    assert_eq(squares[3], 9);
+  }
+
+  {
+    auto it = iter::filter(iter::copied(v.iter()), [](int const^ x) safe { return *x % 3 == 0; });
+    std2::vector<int> xs = iter::collect(rel it);
+    assert_eq(xs.size(), 4u);
+    assert_eq(xs[3], 9);
+  }
+
+  {
+    auto it = iter::filter_map(iter::copied(v.iter()), [](int x) safe -> std2::optional<int> {
+      if (x % 2) return .some(x * 10);
+      return .none;
+    });
+    assert_eq(iter::sum(rel it), 10 + 30 + 50 + 70 + 90);
+  }
+
+  {
+    auto it = iter::enumerate(iter::skip(iter::copied(v.iter()), 4));
+    auto m_first = mut it.std2::iterator::next();
+    auto first = m_first rel.unwrap();
+    assert_eq(first.0, 0u);
+    assert_eq(first.1, 4);
+  }
+
+  {
+    std2::vector<int> w = iota(3);
+    auto it = iter::zip(iter::copied(v.iter()), iter::copied(w.iter()));
+    assert_eq(iter::count(rel it), 3u);
+  }
+
+  {
+    std2::vector<int> w = iota(3);
+    auto it = iter::chain(iter::copied(w.iter()), iter::copied(w.iter()));
+    std2::vector<int> xs = iter::collect(rel it);
+    assert_eq(xs.size(), 6u);
+    assert_eq(xs[4], 1);
+  }
+
+  {
+    auto it = iter::take(iter::step_by(iter::copied(v.iter()), 3), 3);
+    std2::vector<int> xs = iter::collect(rel it);
+    assert_eq(xs.size(), 3u);
+    assert_eq(xs[0], 0);
+    assert_eq(xs[2], 6);
+  }
+
+  {
+    auto it = iter::take_while(iter::copied(v.iter()), [](int const^ x) safe { return *x < 4; });
+    assert_eq(iter::count(rel it), 4u);
+  }
+
+  {
+    std2::vector<int> w = iota(4);
+    auto it = iter::flat_map(iter::copied(w.iter()), [](int n) safe {
+      std2::vector<int> xs = iota(n);
+      return xs rel.iter();
+    });
+    assert_eq(iter::sum(rel it), 0 + 0 + 1 + 0 + 1 + 2);
+  }
+
+  {
+    auto it = iter::peekable(iter::copied(v.iter()));
+    {
+      int const^ p = mut it.peek().unwrap();
+      assert_eq(*p, 0);
+    }
+    assert_eq(*(mut it.peek()).unwrap(), 0);
+    assert_eq(mut it.next().unwrap(), 0);
+    assert_eq(mut it.next().unwrap(), 1);
+  }
+}
+
+void consumers() safe
+{
+  std2::vector<int> v = iota(10);
+
+  assert_eq(iter::fold(iter::copied(v.iter()), 0, [](int acc, int x) safe { return acc + x; }), 45);
+  assert_eq(iter::sum(iter::copied(v.iter())), 45);
+  assert_eq(iter::count(v.iter()), 10u);
+  assert_true(iter::any(iter::copied(v.iter()), [](int x) safe { return x == 7; }));
+  assert_true(!iter::all(iter::copied(v.iter()), [](int x) safe { return x < 7; }));
+  assert_eq(iter::find(iter::copied(v.iter()), [](int const^ x) safe { return *x > 4; }).unwrap(), 5);
+  assert_eq(iter::min(iter::copied(v.iter())).unwrap(), 0);
+  assert_eq(iter::max(iter::copied(v.iter())).unwrap(), 9);
+  assert_true(iter::min(iter::copied(std2::vector<int>{}.iter())).is_none());
+
+  std2::vector<std2::string_view> words = {};
+  mut words.push_back("safe ");
+  mut words.push_back("c++");
+  std2::string s = iter::collect_string(iter::copied(words.iter()));
+  assert_true(s.str() == "safe c++");
+
+  // Consumes the vector itself.
+  std2::vector<int> evens = iter::collect(
+    iter::filter(v rel.iter(), [](int const^ x) safe { return *x % 2 == 0; }));
+  assert_eq(evens.size(), 5u);
+}
+
+// Claims fewer items than it has, as a size_hint() is allowed to.
+struct understated
+{
+  int n;
+
+  std2::optional<int> next(self^) safe {
+    if (self->n == 0) return .none;
+    return .some(--self->n);
+  }
+
+  iter::size_hint_type size_hint(self const^) safe {
+    std2::optional<std::size_t> upper = .none;
+    return (std::size_t(1), rel upper);
+  }
+};
+
+impl understated: std2::iterator
+{
+  using item_type = int;
+
+  std2::optional<item_type> next(self^) safe override {
+    return self.next();
+  }
+};
+
+void size_hints() safe
+{
+  std2::vector<int> v = iota(10);
+
+  {
+    auto it = v.iter();
+    assert_eq(it.len(), 10u);
+    mut it.std2::iterator::next();
+    assert_eq(iter::size_hint(it).0, 9u);
+    assert_eq(iter::size_hint(it).1.unwrap(), 9u);
+  }
+
+  {
+    auto it = iter::skip(iter::take(iter::copied(v.iter()), 7), 2);
+    assert_eq(iter::size_hint(it).0, 5u);
+    assert_eq(iter::size_hint(it).1.unwrap(), 5u);
+  }
+
+  {
+    auto it = iter::filter(iter::copied(v.iter()), [](int const^ x) safe { return *x > 2; });
+    assert_eq(iter::size_hint(it).0, 0u);
+    assert_eq(iter::size_hint(it).1.unwrap(), 10u);
+  }
+
+  {
+    auto it = iter::step_by(iter::copied(v.iter()), 3);
+    assert_eq(iter::size_hint(it).0, 4u);
+  }
+
+  {
+    // Exact sources reserve once, so nothing is over-allocated.
+    std2::vector<int> squares = iter::collect(
+      iter::map(iter::copied(v.iter()), [](int x) safe { return x * x; }));
+    assert_eq(squares.size(), 10u);
+    assert_eq(squares.capacity(), 10u);
+
+    std2::vector<int> src = { 1, 2, 3 };
+    std2::vector<int> w = {};
+    mut w.extend(src rel.iter());
+    assert_eq(w.capacity(), 3u);
+  }
+
+  {
+    // Items past the hint still land.
+    std2::vector<int> w = {};
+    mut w.extend(understated{ 5 });
+    assert_eq(w.size(), 5u);
+    assert_eq(w[0], 4);
+    assert_eq(w[4], 0);
+  }
+}
+
+struct add_checked
+{
+  std2::expected<int, int> operator()(self^, int acc, int const^ x) safe {
+    if (*x == 5) return .err(acc);
+    return .ok(acc + *x);
+  }
+};
+
+struct sum_until
+{
+  int stop;
+
+  std2::expected<int, int> operator()(self^, int acc, (std::size_t, int) p) safe {
+    if (p.1 == self->stop) return .err(acc);
+    return .ok(acc + p.1);
+  }
+};
+
+struct push_into/(a)
+{
+  std2::vector<int>^/a out;
+
+  void operator()(self^, int x) safe {
+    mut self->out.push_back(x);
+  }
+};
+
+void internal_iteration() safe
+{
+  std2::vector<int> v = iota(10);
+
+  {
+    // Stops at 5 and leaves the iterator just past it.
+    auto it = v.iter();
+    std2::expected<int, int> r = iter::try_fold(^it, 0, add_checked{});
+    assert_eq(r rel.unwrap_err(), 0 + 1 + 2 + 3 + 4);
+    assert_eq(it.len(), 4u);
+  }
+
+  {
+    // try_fold runs through the adaptors and leaves them where it stopped.
+    auto it = iter::enumerate(
+      iter::filter(iter::copied(v.iter()), [](int const^ x) safe { return *x % 2 == 1; }));
+    std2::expected<int, int> r = iter::try_fold(^it, 0, sum_until{ 5 });
+    assert_eq(r rel.unwrap_err(), 1 + 3);
+
+    (std::size_t, int) p = (mut it.next()).unwrap();
+    assert_eq(p.0, 3u);
+    assert_eq(p.1, 7);
+  }
+
+  {
+    std2::vector<int> out = {};
+    iter::for_each(
+      iter::filter(iter::map(iter::copied(v.iter()), [](int x) safe { return x + 1; }),
+        [](int const^ x) safe { return *x % 2 == 0; }),
+      push_into{ ^out });
+    assert_eq(out.size(), 5u);
+    assert_eq(out[0], 2);
+    assert_eq(out[4], 10);
+  }
+
+  {
+    auto it = iter::enumerate(v rel.iter());
+    std::size_t s = iter::fold(rel it, std::size_t(0), [](std::size_t acc, (std::size_t, int) p) safe {
+      return acc + p.0 * static_cast<std::size_t>(p.1);
+    });
+    assert_eq(s, 285u);
+  }
+}
+
+void double_ended() safe
+{
+  std2::vector<int> v = iota(10);
+
+  {
+    auto it = v.iter();
+    assert_eq(*(mut it.next_back()).unwrap(), 9);
+    assert_eq(*(mut it.next()).unwrap(), 0);
+    assert_eq(*(mut it.nth(2)).unwrap(), 3);
+    assert_eq(mut it.advance_by(100), 5u);
+    assert_true((mut it.next()).is_none());
+    assert_true((mut it.next_back()).is_none());
+  }
+
+  {
+    // Last match: search from the back.
+    auto m_x = iter::find(iter::copied(iter::rev(v.iter())), [](int const^ x) safe { return *x % 4 == 0; });
+    assert_eq(m_x.unwrap(), 8);
+  }
+
+  {
+    std2::vector<int> r = iter::collect(iter::rev(iota(4) rel.iter()));
+    assert_eq(r[0], 3);
+    assert_eq(r[3], 0);
+  }
+
+  {
+    std2::vector<std2::string> strs = {};
+    mut strs.push_back(std2::string("a"));
+    mut strs.push_back(std2::string("b"));
+    mut strs.push_back(std2::string("c"));
+
+    auto it = strs rel.iter();
+    assert_eq(mut it.advance_by(1), 1u);
+    assert_true((mut it.next_back()).unwrap().str() == "c");
+    assert_eq(it.len(), 1u);
+
+    std2::vector<int> w = iota(5);
+    auto it2 = iter::copied(w.iter());
+    assert_eq(iter::nth(^it2, 3).unwrap(), 3);
+  }
+}
+
+int main() safe
+{
+  adaptors();
+  consumers();
+  size_hints();
+  internal_iteration();
+  double_ended();
+}
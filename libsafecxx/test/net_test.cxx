@@ -0,0 +1,148 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+using namespace std2::net;
+
+void tcp_blocking() safe
+{
+  tcp_listener listener = tcp_listener::bind(socket_address::loopback_v4(0)).unwrap();
+  std::uint16_t port = listener.local_addr().unwrap().port();
+  assert_true(port != 0);
+
+  tcp_stream client = tcp_stream::connect(socket_address::loopback_v4(port)).unwrap();
+  tcp_stream server = listener.accept().unwrap();
+  client.set_nodelay(true).unwrap();
+
+  std2::u8 const msg[] = { 'h', 'e', 'l', 'l', 'o' };
+  mut client.write_all(msg).unwrap();
+
+  std2::u8 buf[16] = {};
+  std::size_t n = mut server.read(^buf).unwrap();
+  assert_eq(n, 5u);
+  assert_eq(buf[0], msg[0]);
+  assert_eq(buf[4], msg[4]);
+
+  // Orderly shutdown is observed as a zero-length read.
+  client.shutdown_write().unwrap();
+  n = mut server.read(^buf).unwrap();
+  assert_eq(n, 0u);
+
+  assert_eq(client.peer_addr().unwrap().port(), port);
+}
+
+void tcp_would_block() safe
+{
+  tcp_listener listener = tcp_listener::bind(socket_address::loopback_v4(0)).unwrap();
+  listener.set_nonblocking(true).unwrap();
+
+  std2::io::result<tcp_stream> r = listener.accept();
+  assert_true(r.is_err());
+  assert_true(r rel.unwrap_err().is_would_block());
+}
+
+void udp_loopback() safe
+{
+  udp_socket a = udp_socket::bind(socket_address::loopback_v4(0)).unwrap();
+  udp_socket b = udp_socket::bind(socket_address::loopback_v4(0)).unwrap();
+
+  std2::u8 const msg[] = { 1, 2, 3 };
+  std::size_t n = a.send_to(msg, b.local_addr().unwrap()).unwrap();
+  assert_eq(n, 3u);
+
+  std2::u8 buf[16] = {};
+  auto r = b.recv_from(^buf).unwrap();
+  assert_eq(r.0, 3u);
+  assert_eq(buf[2], msg[2]);
+  assert_eq(r.1.port(), a.local_addr().unwrap().port());
+}
+
+void delayed_client(std::uint16_t port) safe
+{
+  unsafe { std::this_thread::sleep_for(std::chrono::milliseconds(100)); }
+
+  tcp_stream client = tcp_stream::connect(socket_address::loopback_v4(port)).unwrap();
+
+  unsafe { std::this_thread::sleep_for(std::chrono::milliseconds(100)); }
+
+  std2::u8 const msg[] = { 'p', 'i', 'n', 'g' };
+  mut client.write_all(msg).unwrap();
+}
+
+// Accepts one connection and reads from it, parking in the reactor for both.
+class accept_and_read
+{
+  tcp_listener listener_;
+  reactor r_;
+  std2::optional<tcp_stream> stream_;
+  std2::u8 buf_[16];
+
+public:
+  accept_and_read(tcp_listener listener, reactor r) safe
+    : listener_(rel listener)
+    , r_(rel r)
+    , stream_(.none)
+    , buf_{}
+  {
+  }
+
+  std2::poll_result<std::size_t> poll(self^, std2::context^ cx) safe {
+    if (self->stream_.is_none()) {
+      auto a = self->listener_.poll_accept(cx, self->r_);
+      if (a.is_pending()) return .pending;
+
+      tcp_stream s = a rel.unwrap().unwrap();
+      s.set_nonblocking(true).unwrap();
+      self->stream_ = .some(rel s);
+    }
+
+    tcp_stream^ s = match(self->stream_) -> tcp_stream^ {
+      .some(^s) => s;
+      .none => std2::panic("unreachable");
+    };
+
+    auto r = mut s.poll_read(cx, self->r_, ^self->buf_);
+    if (r.is_pending()) return .pending;
+    return .ready(r rel.unwrap().unwrap());
+  }
+};
+
+impl accept_and_read: std2::future
+{
+  using output_type = std::size_t;
+
+  std2::poll_result<output_type> poll(self^, std2::context^ cx) safe override {
+    return self.poll(cx);
+  }
+};
+
+void tcp_reactor() safe
+{
+  reactor r = reactor::create().unwrap();
+  std2::local_executor ex{};
+
+  tcp_listener listener = tcp_listener::bind(socket_address::loopback_v4(0)).unwrap();
+  listener.set_nonblocking(true).unwrap();
+  std::uint16_t port = listener.local_addr().unwrap().port();
+
+  std2::thread t(delayed_client, port);
+
+  std::size_t n = mut ex.block_on(accept_and_read(rel listener, cpy r), r);
+  assert_eq(n, 4u);
+
+  t rel.join();
+}
+
+int main() safe
+{
+  tcp_blocking();
+  tcp_would_block();
+  udp_loopback();
+  tcp_reactor();
+}
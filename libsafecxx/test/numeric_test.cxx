@@ -0,0 +1,121 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include <limits>
+
+#include "helpers.h"
+
+void sums() safe
+{
+  std2::vector<int> v = {};
+  for (int i = 1; i <= 1001; ++i) mut v.push_back(i);
+  assert_eq(std2::sum(v.slice()), 1001 * 1002 / 2);
+  assert_eq(std2::sum(std2::vector<int>{}.slice()), 0);
+
+  // 0.1 isn't representable, so a naive running sum drifts.
+  std2::vector<double> d = {};
+  for (int i = 0; i < 100000; ++i) mut d.push_back(0.1);
+  double const exact = 10000.0;
+  double const k = std2::kahan_sum(d.slice());
+  double const p = std2::pairwise_sum(d.slice());
+  assert_true(k - exact < 1e-9 && exact - k < 1e-9);
+  assert_true(p - exact < 1e-7 && exact - p < 1e-7);
+
+  std2::vector<float> a = {};
+  std2::vector<float> b = {};
+  for (int i = 0; i < 37; ++i) {
+    mut a.push_back(static_cast<float>(i));
+    mut b.push_back(2.0f);
+  }
+  assert_eq(std2::dot(a.slice(), b.slice()), 36.0f * 37.0f);
+}
+
+void extrema() safe
+{
+  std2::vector<int> v = {};
+  for (int i = 0; i < 100; ++i) mut v.push_back((i * 37) % 101 - 50);
+  mut v.push_back(-77);
+  mut v.push_back(-77);
+
+  assert_eq(std2::min(v.slice()).unwrap(), -77);
+  assert_eq(std2::argmin(v.slice()).unwrap(), 100u);
+  assert_eq(std2::max(v.slice()).unwrap(), 50);
+  assert_eq(v[std2::argmax(v.slice()).unwrap()], 50);
+  assert_true(std2::min(std2::vector<int>{}.slice()).is_none());
+
+  std2::vector<float> f = {};
+  mut f.push_back(std::numeric_limits<float>::quiet_NaN());
+  mut f.push_back(3.0f);
+  mut f.push_back(-1.0f);
+  mut f.push_back(std::numeric_limits<float>::quiet_NaN());
+  assert_eq(std2::min(f.slice()).unwrap(), -1.0f);
+  assert_eq(std2::argmax(f.slice()).unwrap(), 1u);
+}
+
+void scans() safe
+{
+  std2::vector<int> v = {};
+  for (int i = 0; i < 10; ++i) mut v.push_back(1);
+  std2::prefix_sum(mut v.slice());
+  assert_eq(v[0], 1);
+  assert_eq(v[9], 10);
+
+  std2::vector<std2::u8> bytes = {};
+  for (int i = 0; i < 1000; ++i) mut bytes.push_back(static_cast<std2::u8>(i % 10));
+  std2::vector<std::uint64_t> counts = {};
+  for (int i = 0; i < 256; ++i) mut counts.push_back(0);
+  std2::histogram(bytes.slice(), mut counts.slice());
+  assert_eq(counts[3], 100u);
+  assert_eq(counts[10], 0u);
+
+  std2::vector<unsigned> small = {};
+  for (unsigned i = 0; i < 30; ++i) mut small.push_back(i % 3);
+  std2::vector<std::uint64_t> bins = {};
+  for (int i = 0; i < 3; ++i) mut bins.push_back(0);
+  std2::histogram(small.slice(), mut bins.slice());
+  assert_eq(bins[2], 10u);
+}
+
+// Lengths up to a few AVX-512 registers, so whichever kernel the CPU
+// selects runs both its main loop and its tail.
+void dispatched() safe
+{
+  xorshift rng{ 0x9e3779b97f4a7c15 };
+  for (std::size_t n = 1; n < 300; ++n) {
+    std2::vector<int> v = {};
+    std2::vector<std::int8_t> bytes = {};
+    for (std::size_t i = 0; i < n; ++i) {
+      mut v.push_back(static_cast<int>(mut rng() % 2001) - 1000);
+      mut bytes.push_back(static_cast<std::int8_t>(mut rng()));
+    }
+
+    int total = 0;
+    int products = 0;
+    std::int8_t lo = bytes[0];
+    std::int8_t hi = bytes[0];
+    for (std::size_t i = 0; i < n; ++i) {
+      total += v[i];
+      products += v[i] * v[i];
+      if (bytes[i] < lo) lo = bytes[i];
+      if (hi < bytes[i]) hi = bytes[i];
+    }
+
+    assert_eq(std2::sum(v.slice()), total);
+    assert_eq(std2::dot(v.slice(), v.slice()), products);
+    assert_eq(std2::min(bytes.slice()).unwrap(), lo);
+    assert_eq(std2::max(bytes.slice()).unwrap(), hi);
+  }
+}
+
+int main() safe
+{
+  sums();
+  extrema();
+  scans();
+  dispatched();
+}
@@ -0,0 +1,103 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+struct point
+{
+  int x;
+  int y;
+};
+
+void seqlock_constructor() safe
+{
+  using seqlock_type = std2::seqlock<point>;
+
+  static_assert(seqlock_type~is_send);
+  static_assert(seqlock_type~is_sync);
+
+  seqlock_type sl{point{1, 2}};
+
+  point p = sl.read();
+  assert_eq(p.x, 1);
+  assert_eq(p.y, 2);
+
+  {
+    auto guard = sl.lock();
+    point^ q = mut guard.borrow();
+    q->x = 3;
+    q->y = 4;
+  }
+
+  p = sl.read();
+  assert_eq(p.x, 3);
+  assert_eq(p.y, 4);
+}
+
+void seqlock_concurrent() safe
+{
+  using seqlock_type = std2::seqlock<point>;
+
+  static int const num_iters = 10'000;
+  static int const num_writer_threads = 2;
+  static int const num_reader_threads = 8;
+  static int const value = num_writer_threads * num_iters;
+
+  std2::vector<std2::thread> threads = {};
+  std2::arc<seqlock_type> sp{seqlock_type(point{0, 0})};
+
+  using fn_type = void(*)(std2::arc<seqlock_type>) safe;
+
+  auto writer = [](std2::arc<seqlock_type> sp) safe {
+    for (int i = 0; i < num_iters; ++i) {
+      auto guard = sp->lock();
+      point^ p = mut guard.borrow();
+      p->x += 1;
+      p->y = -p->x;
+    }
+
+    drp sp;
+  };
+
+  auto reader = [](std2::arc<seqlock_type> sp) safe {
+    int v = 0;
+    do {
+      unsafe { std::this_thread::yield(); }
+
+      // A torn read would break the invariant maintained by the writers.
+      point p = sp->read();
+      assert_eq(p.x, -p.y);
+      v = p.x;
+    } while (v < value);
+
+    drp sp;
+  };
+
+  unsafe { fn_type fp1 = +writer; }
+  unsafe { fn_type fp2 = +reader; }
+
+  for (int i = 0; i < num_writer_threads; ++i) {
+    mut threads.push_back(std2::thread(fp1, cpy sp));
+  }
+
+  for (int i = 0; i < num_reader_threads; ++i) {
+    mut threads.push_back(std2::thread(fp2, cpy sp));
+  }
+
+  for (std2::thread t : rel threads) {
+    t rel.join();
+  }
+
+  assert_eq(sp->read().x, value);
+}
+
+int main() safe
+{
+  seqlock_constructor();
+  seqlock_concurrent();
+}
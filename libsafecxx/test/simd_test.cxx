@@ -0,0 +1,96 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+using f4 = std2::simd<float, 4>;
+using i8 = std2::simd<int, 8>;
+
+void arithmetic() safe
+{
+  float xs[4] { 1.f, 2.f, 3.f, 4.f };
+  f4 a = f4::load(xs);
+  f4 b(10.f);
+
+  f4 c = a * b + a;
+  assert_eq(c[0], 11.f);
+  assert_eq(c[3], 44.f);
+  assert_eq(c.reduce_add(), 110.f);
+  assert_eq(c.reduce_min(), 11.f);
+  assert_eq((c - b).reduce_max(), 34.f);
+
+  float out[4] {};
+  (c / b).store(^out);
+  assert_eq(out[2], 3.3f);
+
+  i8 x(6);
+  i8 y(3);
+  assert_eq((x & y)[5], 2);
+  assert_eq((x << 2)[0], 24);
+  assert_eq((x / y).reduce_add(), 16);
+}
+
+void masks() safe
+{
+  std2::vector<int> v = {};
+  for (int i = 0; i < 8; ++i) mut v.push_back(i * 3);
+
+  i8 a = i8::load(v.slice(), 0);
+  auto m = a > i8(10);
+  assert_eq(m.count(), 4u);
+  assert_true(m.any());
+  assert_true(!m.all());
+  assert_eq(m.first_set().unwrap(), 4u);
+  assert_eq(m.to_bitmask(), 0xf0u);
+  assert_true((!m)[0]);
+
+  i8 clamped = i8::min(a, i8(10));
+  assert_eq(clamped[7], 10);
+  assert_eq(i8::select(m, i8(1), i8(0)).reduce_add(), 4);
+
+  // Wider than a 64-bit bitmask.
+  auto wide = std2::simd<std::int8_t, 128>::mask_type::first_n(100);
+  assert_eq(wide.count(), 100u);
+  assert_true(wide.any());
+  assert_true(!wide.all());
+  assert_eq((!wide).first_set().unwrap(), 100u);
+}
+
+void tails() safe
+{
+  std2::vector<int> v = {};
+  for (int i = 1; i <= 11; ++i) mut v.push_back(i);
+
+  // Eleven elements: one full vector and a three-lane tail.
+  i8 acc{};
+  std::size_t i = 0;
+  for (; i + 8 <= v.size(); i += 8) mut acc += i8::load(v.slice(), i);
+  mut acc += i8::load_partial(v.slice(), i);
+  assert_eq(acc.reduce_add(), 66);
+
+  auto tail = i8::mask_type::first_n(v.size() - i);
+  assert_eq(tail.count(), 3u);
+
+  assert_eq(i8::load_partial(v.slice(), 8, 100).reduce_max(), 100);
+
+  std2::vector<int> out = {};
+  for (int j = 0; j < 5; ++j) mut out.push_back(0);
+  i8(7).store_partial(mut out.slice(), 2);
+  assert_eq(out[1], 0);
+  assert_eq(out[4], 7);
+}
+
+int main() safe
+{
+  arithmetic();
+  masks();
+  tails();
+
+  std2::simd_isa isa = std2::detect_simd_isa();
+  assert_true(isa != std2::simd_isa::scalar || std2::native_simd_size<int> == 4);
+}
@@ -0,0 +1,283 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+std2::vector<int> iota(int n) safe
+{
+  std2::vector<int> v = {};
+  for (int i = 0; i < n; ++i) {
+    mut v.push_back(i);
+  }
+  return v;
+}
+
+void chunking() safe
+{
+  std2::vector<int> v = iota(10);
+
+  {
+    auto it = std2::chunks(v.slice(), 4);
+    assert_eq(it.len(), 3u);
+
+    const [int; dyn]^ a = (mut it.next()).unwrap();
+    assert_eq((*a)~length, 4u);
+    (mut it.next()).unwrap();
+    const [int; dyn]^ c = (mut it.next()).unwrap();
+    assert_eq((*c)~length, 2u);
+    assert_eq((*c)[1], 9);
+    assert_true((mut it.next()).is_none());
+  }
+
+  {
+    // A chunk size this large must not wrap the length.
+    auto it = std2::chunks(v.slice(), std::size_t(-1));
+    assert_eq(it.len(), 1u);
+    assert_eq((*(mut it.next()).unwrap())~length, 10u);
+  }
+
+  {
+    auto it = std2::chunks_exact(v.slice(), 3);
+    assert_eq(it.len(), 3u);
+    assert_eq((*it.remainder())~length, 1u);
+    assert_eq((*it.remainder())[0], 9);
+
+    int sum = 0;
+    for (const [int; dyn]^ c : rel it) {
+      sum += (*c)[2];
+    }
+    assert_eq(sum, 2 + 5 + 8);
+  }
+
+  {
+    int sum = 0;
+    auto it = std2::array_chunks<4>(v.slice());
+    assert_eq((*it.remainder())~length, 2u);
+    for (const [int; 4]^ c : rel it) {
+      sum += (*c)[0] + (*c)[3];
+    }
+    assert_eq(sum, 0 + 3 + 4 + 7);
+  }
+
+  {
+    for ([int; dyn]^ c : std2::chunks_mut(mut v.slice(), 5)) {
+      (*c)[0] = -1;
+    }
+    assert_eq(v[0], -1);
+    assert_eq(v[5], -1);
+  }
+
+  {
+    // The tail can be written once the iterator is given up.
+    auto it = std2::chunks_exact_mut(mut v.slice(), 4);
+    [int; dyn]^ rest = it rel.into_remainder();
+    (*rest)[1] = 90;
+  }
+  assert_eq(v[9], 90);
+
+  {
+    std2::vector<int> w = iota(5);
+    auto it = std2::windows(w.slice(), 3);
+    assert_eq(it.len(), 3u);
+
+    int sums[3] {};
+    std::size_t i = 0;
+    for (const [int; dyn]^ win : rel it) {
+      sums[i++] = (*win)[0] + (*win)[1] + (*win)[2];
+    }
+    assert_eq(sums[0], 3);
+    assert_eq(sums[2], 9);
+    assert_eq(std2::windows(w.slice(), 6).len(), 0u);
+  }
+}
+
+void splitting() safe
+{
+  std2::vector<int> v = iota(6);
+
+  {
+    auto halves = std2::split_at(v.slice(), 2);
+    assert_eq((*halves.0)~length, 2u);
+    assert_eq((*halves.1)[0], 2);
+  }
+
+  {
+    auto halves = std2::split_at_mut(mut v.slice(), 3);
+    (*halves.0)[0] = (*halves.1)[2];
+    (*halves.1)[0] = 100;
+  }
+  assert_eq(v[0], 5);
+  assert_eq(v[3], 100);
+
+  {
+    auto head = std2::split_first(v.slice()).unwrap();
+    assert_eq(*head.0, 5);
+    assert_eq((*head.1)~length, 5u);
+
+    auto tail = std2::split_last(v.slice()).unwrap();
+    assert_eq(*tail.0, 5);
+    assert_eq((*tail.1)~length, 5u);
+  }
+
+  {
+    std2::vector<int> empty = {};
+    assert_true(std2::split_first(empty.slice()).is_none());
+    assert_true(std2::split_last_mut(mut empty.slice()).is_none());
+  }
+}
+
+struct compare_to
+{
+  int target;
+
+  int operator()(self^, int const^ x) safe {
+    return *x < self->target ? -1 : (*x > self->target ? 1 : 0);
+  }
+};
+
+void searching() safe
+{
+  // 0, 2, 2, 2, 4, 6, ..., 18
+  std2::vector<int> v = {};
+  for (int i = 0; i < 10; ++i) {
+    mut v.push_back(2 * i);
+    if (i == 1) {
+      mut v.push_back(2);
+      mut v.push_back(2);
+    }
+  }
+
+  {
+    int const two = 2;
+    int const seven = 7;
+    assert_eq(std2::lower_bound(v.slice(), two), 1u);
+    assert_eq(std2::upper_bound(v.slice(), two), 4u);
+    assert_eq(std2::partition_point(v.slice(), [](int const^ x) safe { return *x < 10; }), 7u);
+
+    assert_true(std2::binary_search(v.slice(), two).is_ok());
+    assert_eq(std2::binary_search(v.slice(), seven).unwrap_err(), 6u);
+    assert_eq(std2::binary_search_by(v.slice(), compare_to{ 18 }).unwrap(), 11u);
+    assert_eq(std2::binary_search_by(v.slice(), compare_to{ 99 }).unwrap_err(), 12u);
+
+    std2::vector<int> empty = {};
+    assert_eq(std2::binary_search(empty.slice(), two).unwrap_err(), 0u);
+  }
+
+  assert_true(std2::is_sorted(v.slice()));
+  mut v.push_back(1);
+  assert_true(!std2::is_sorted(v.slice()));
+
+  {
+    std2::vector<int> w = {};
+    for (int i = 0; i < 1000; ++i) mut w.push_back((i * 7919) % 1000);
+
+    auto parts = std2::select_nth_unstable(mut w.slice(), 500);
+    assert_eq(*parts.1, 500);
+    assert_eq((*parts.0)~length, 500u);
+    for (int x : std2::slice_iterator<const int>(parts.0)) assert_true(x < 500);
+    for (int x : std2::slice_iterator<const int>(parts.2)) assert_true(x > 500);
+  }
+
+  {
+    std2::vector<int> same = {};
+    for (int i = 0; i < 300; ++i) mut same.push_back(4);
+    assert_eq(*std2::select_nth_unstable(mut same.slice(), 299).1, 4);
+  }
+
+  {
+    std2::vector<int> keys = {};
+    for (int i = 0; i < 1000; ++i) mut keys.push_back(3 * i);
+    std2::eytzinger<int> tree(keys.slice());
+    assert_eq(tree.size(), 1000u);
+
+    int const x = 301;
+    int const y = 300;
+    int const z = 3000;
+    assert_eq(tree.lower_bound(x).unwrap(), 303);
+    assert_true(tree.contains(y));
+    assert_true(!tree.contains(x));
+    assert_true(tree.lower_bound(z).is_none());
+  }
+}
+
+struct counter
+{
+  int n;
+
+  int operator()(self^) safe {
+    return self->n++;
+  }
+};
+
+void bulk() safe
+{
+  {
+    std2::vector<int> a = iota(8);
+    std2::vector<int> b = iota(8);
+    std2::reverse(mut b.slice());
+    std2::copy_from_slice(mut a.slice(), b.slice());
+    assert_eq(a[0], 7);
+    assert_eq(a[7], 0);
+
+    std2::fill(mut a.slice(), 0);
+    assert_eq(a[3], 0);
+    std2::fill(mut a.slice(), 0x01020304);
+    assert_eq(a[5], 0x01020304);
+
+    std2::fill_with(mut a.slice(), counter{ 10 });
+    assert_eq(a[0], 10);
+    assert_eq(a[7], 17);
+
+    std2::swap_with_slice(mut a.slice(), mut b.slice());
+    assert_eq(a[0], 7);
+    assert_eq(b[0], 10);
+  }
+
+  {
+    std2::vector<int> v = iota(10);
+    std2::rotate_left(mut v.slice(), 3);
+    assert_eq(v[0], 3);
+    assert_eq(v[9], 2);
+    std2::rotate_right(mut v.slice(), 3);
+    assert_eq(v[0], 0);
+    assert_eq(v[9], 9);
+
+    // Both sides too long for the stack buffer.
+    std2::vector<int> w = iota(2000);
+    std2::rotate_left(mut w.slice(), 700);
+    assert_eq(w[0], 700);
+    assert_eq(w[1299], 1999);
+    assert_eq(w[1300], 0);
+
+    std2::copy_within(mut v.slice(), 0, 5, 2);
+    assert_eq(v[2], 0);
+    assert_eq(v[6], 4);
+    assert_eq(v[7], 7);
+  }
+
+  {
+    std2::vector<std2::string> a = {};
+    std2::vector<std2::string> b = {};
+    mut a.push_back(std2::string("a"));
+    mut b.push_back(std2::string("b"));
+    std2::clone_from_slice(mut a.slice(), b.slice());
+    assert_true(a[0].str() == "b");
+    assert_true(b[0].str() == "b");
+
+    std2::fill(mut a.slice(), std2::string("zz"));
+    assert_true(a[0].str() == "zz");
+  }
+}
+
+int main() safe
+{
+  chunking();
+  splitting();
+  searching();
+  bulk();
+}
@@ -0,0 +1,102 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+struct point
+{
+  float x;
+  float y;
+  int id;
+};
+
+struct named
+{
+  std2::string name;
+  int rank;
+};
+
+void columns() safe
+{
+  std2::soa_vector<point> v = {};
+  assert_true(v.empty());
+  assert_eq(std2::soa_vector<point>::num_columns, 3u);
+
+  for (int i = 0; i < 10; ++i) {
+    mut v.push_back(point{ static_cast<float>(i), static_cast<float>(2 * i), i });
+  }
+  assert_eq(v.size(), 10u);
+
+  {
+    const [float; dyn]^ ys = v.column<&point::y>();
+    assert_eq((*ys)~length, 10u);
+    assert_eq((*ys)[3], 6.0f);
+  }
+
+  {
+    [int; dyn]^ ids = mut v.column<&point::id>();
+    (*ids)[4] = 40;
+  }
+  assert_eq(v.get(4).id, 40);
+  assert_eq(v.get(4).x, 4.0f);
+
+  {
+    auto cols = mut v.columns<&point::x, &point::y>();
+    [float; dyn]^ xs = rel cols.0;
+    [float; dyn]^ ys = rel cols.1;
+    for (std::size_t i = 0; i < (*xs)~length; ++i) {
+      (*xs)[i] += (*ys)[i];
+    }
+  }
+  assert_eq(v.get(5).x, 15.0f);
+
+  point p = mut v.pop_back().unwrap();
+  assert_eq(p.id, 9);
+  assert_eq(p.x, 27.0f);
+  assert_eq(v.size(), 9u);
+  assert_eq((*v.column<&point::id>())~length, 9u);
+}
+
+void rows() safe
+{
+  std2::soa_vector<point> v = {};
+  mut v.push_back(point{ 1.0f, 2.0f, 7 });
+  mut v.push_back(point{ 3.0f, 4.0f, 8 });
+
+  {
+    std2::soa_row<point> r = mut v.row(1);
+    *r.get<&point::y>() = 5.0f;
+    assert_eq(r.index(), 1u);
+  }
+
+  std2::soa_row<const point> r = v.row(1);
+  assert_eq(*r.get<&point::y>(), 5.0f);
+  assert_eq(*r.get<&point::id>(), 8);
+  assert_eq(r.load().x, 3.0f);
+}
+
+void non_trivial() safe
+{
+  std2::soa_vector<named> v = {};
+  mut v.push_back(named{ std2::string("alpha"), 1 });
+  mut v.push_back(named{ std2::string("beta"), 2 });
+
+  assert_true((*v.column<&named::name>())[1].str() == "beta");
+  assert_true(v.get(0).name.str() == "alpha");
+
+  named n = mut v.pop_back().unwrap();
+  assert_true(n.name.str() == "beta");
+  assert_eq(n.rank, 2);
+}
+
+int main() safe
+{
+  columns();
+  rows();
+  non_trivial();
+}
@@ -0,0 +1,249 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include "helpers.h"
+
+std2::vector<int> random_ints(std::size_t n, int range) safe
+{
+  xorshift rng{ 0x9e3779b97f4a7c15 };
+  std2::vector<int> v = {};
+  for (std::size_t i = 0; i < n; ++i) {
+    mut v.push_back(static_cast<int>(mut rng() % static_cast<std::uint64_t>(range)));
+  }
+  return v;
+}
+
+bool is_sorted(const [int; dyn]^ s) safe
+{
+  for (std::size_t i = 1; i < (*s)~length; ++i) {
+    if ((*s)[i] < (*s)[i - 1]) return false;
+  }
+  return true;
+}
+
+long long total(const [int; dyn]^ s) safe
+{
+  long long t = 0;
+  for (std::size_t i = 0; i < (*s)~length; ++i) t += (*s)[i];
+  return t;
+}
+
+void unstable() safe
+{
+  std::size_t const sizes[] { 0, 1, 2, 19, 20, 21, 100, 1000, 100000 };
+  for (std::size_t n : sizes) {
+    std2::vector<int> v = random_ints(n, 1 << 30);
+    long long const t = total(v.slice());
+    mut v.sort_unstable();
+    assert_true(is_sorted(v.slice()));
+    assert_eq(total(v.slice()), t);
+
+    // Many duplicates go through the equal-partition path.
+    std2::vector<int> d = random_ints(n, 4);
+    std2::sort_unstable(mut d.slice());
+    assert_true(is_sorted(d.slice()));
+  }
+
+  {
+    // Descending input is reversed during pivot selection.
+    std2::vector<int> v = {};
+    for (int i = 5000; i > 0; --i) mut v.push_back(i);
+    mut v.sort_unstable();
+    assert_eq(v[0], 1);
+    assert_eq(v[4999], 5000);
+  }
+
+  {
+    std2::vector<int> v = random_ints(1000, 1000);
+    mut v.sort_unstable_by([](int const^ a, int const^ b) safe { return *a > *b; });
+    for (std::size_t i = 1; i < v.size(); ++i) {
+      assert_true(v[i - 1] >= v[i]);
+    }
+  }
+}
+
+bool str_less(std2::str a, std2::str b) safe
+{
+  std::size_t const n = a.size() < b.size() ? a.size() : b.size();
+  unsafe { int c = std::memcmp(a.data(), b.data(), n); }
+  return c < 0 || (c == 0 && a.size() < b.size());
+}
+
+struct entry
+{
+  int key;
+  int index;
+};
+
+void stable() safe
+{
+  std::size_t const sizes[] { 0, 1, 20, 21, 64, 1000, 100000 };
+  for (std::size_t n : sizes) {
+    std2::vector<int> keys = random_ints(n, 16);
+    std2::vector<entry> v = {};
+    for (std::size_t i = 0; i < n; ++i) {
+      mut v.push_back(entry{ keys[i], static_cast<int>(i) });
+    }
+
+    mut v.sort_by_key([](entry const^ e) safe { return e->key; });
+    for (std::size_t i = 1; i < n; ++i) {
+      assert_true(v[i - 1].key <= v[i].key);
+      if (v[i - 1].key == v[i].key) assert_true(v[i - 1].index < v[i].index);
+    }
+  }
+
+  {
+    std2::vector<int> v = random_ints(5000, 1 << 20);
+    mut v.sort();
+    assert_true(is_sorted(v.slice()));
+  }
+
+  {
+    // Elements that own memory are moved, never copied or dropped twice.
+    std2::vector<std2::string> v = {};
+    mut v.push_back(std2::string("pear"));
+    mut v.push_back(std2::string("apple"));
+    mut v.push_back(std2::string("fig"));
+    std2::sort_by(mut v.slice(), [](std2::string const^ a, std2::string const^ b) safe {
+      return str_less(a->str(), b->str());
+    });
+    assert_true(v[0].str() == "apple");
+    assert_true(v[2].str() == "pear");
+  }
+}
+
+struct coin_flip
+{
+  xorshift rng;
+
+  bool operator()(self^, int const^, int const^) safe {
+    return (mut self->rng() & 1) != 0;
+  }
+};
+
+void inconsistent_comparator() safe
+{
+  // The order is unspecified, but every element must still be there.
+  std2::vector<int> v = random_ints(100000, 1 << 20);
+  long long const t = total(v.slice());
+
+  mut v.sort_unstable_by(coin_flip{ xorshift{ 42 } });
+  assert_eq(v.size(), 100000u);
+  assert_eq(total(v.slice()), t);
+
+  mut v.sort_by(coin_flip{ xorshift{ 7 } });
+  assert_eq(total(v.slice()), t);
+
+  mut v.sort_unstable_by([](int const^, int const^) safe { return true; });
+  assert_eq(total(v.slice()), t);
+}
+
+void radix() safe
+{
+  {
+    std2::vector<int> src = random_ints(100000, 1 << 30);
+    std2::vector<int> v = {};
+    for (std::size_t i = 0; i < src.size(); ++i) {
+      mut v.push_back(i % 3 ? src[i] : -src[i]);
+    }
+    std2::radix_sort(mut v.slice());
+    assert_true(is_sorted(v.slice()));
+
+    // Small inputs take the comparison sort.
+    std2::vector<int> w = random_ints(100, 50);
+    std2::radix_sort(mut w.slice());
+    assert_true(is_sorted(w.slice()));
+  }
+
+  {
+    std2::vector<std::uint64_t> v = {};
+    xorshift rng{ 3 };
+    for (int i = 0; i < 300000; ++i) mut v.push_back(mut rng());
+    std2::par_radix_sort(mut v.slice(), 4);
+    for (std::size_t i = 1; i < v.size(); ++i) assert_true(v[i - 1] <= v[i]);
+  }
+
+  {
+    std2::vector<double> v = {};
+    for (int i = 0; i < 1000; ++i) {
+      mut v.push_back(static_cast<double>(i % 37) * (i % 2 ? -1.5 : 2.25));
+    }
+    mut v.push_back(-0.0);
+    mut v.push_back(0.0);
+    std2::radix_sort(mut v.slice());
+    for (std::size_t i = 1; i < v.size(); ++i) assert_true(v[i - 1] <= v[i]);
+    assert_eq(v[0], -36.0 * 1.5);
+  }
+
+  {
+    std2::vector<std2::string> v = {};
+    for (int i = 0; i < 500; ++i) {
+      std2::string s = {};
+      mut s.append(i % 2 ? "beta" : "alpha");
+      for (int j = 0; j < i % 7; ++j) mut s.append("x");
+      mut v.push_back(rel s);
+    }
+    mut v.push_back(std2::string(""));
+    std2::radix_sort(mut v.slice());
+    assert_true(v[0].str() == "");
+    assert_true(v[1].str() == "alpha");
+    for (std::size_t i = 1; i < v.size(); ++i) assert_true(!str_less(v[i].str(), v[i - 1].str()));
+  }
+}
+
+struct entry_key
+{
+  int operator()(self^, entry const^ e) safe {
+    return e->key;
+  }
+};
+
+void parallel() safe
+{
+  std::size_t const n = 200000;
+
+  {
+    std2::vector<int> keys = random_ints(n, 100);
+    std2::vector<entry> v = {};
+    for (std::size_t i = 0; i < n; ++i) {
+      mut v.push_back(entry{ keys[i], static_cast<int>(i) });
+    }
+
+    std2::par_sort_by(mut v.slice(), std2::key_less<entry_key>{ entry_key{} }, 8);
+    for (std::size_t i = 1; i < n; ++i) {
+      assert_true(v[i - 1].key <= v[i].key);
+      if (v[i - 1].key == v[i].key) assert_true(v[i - 1].index < v[i].index);
+    }
+  }
+
+  {
+    std2::vector<int> v = random_ints(n, 1 << 30);
+    long long const t = total(v.slice());
+    mut v.par_sort_unstable();
+    assert_true(is_sorted(v.slice()));
+    assert_eq(total(v.slice()), t);
+
+    // Few distinct keys: minimal pivots peel off their runs.
+    std2::vector<int> d = random_ints(n, 3);
+    std2::par_sort_unstable_by(mut d.slice(), std2::default_less{}, 8);
+    assert_true(is_sorted(d.slice()));
+
+    std2::vector<int> w = random_ints(n, 1000);
+    mut w.par_sort();
+    assert_true(is_sorted(w.slice()));
+  }
+}
+
+int main() safe
+{
+  unstable();
+  stable();
+  inconsistent_comparator();
+  radix();
+  parallel();
+}
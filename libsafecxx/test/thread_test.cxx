@@ -192,9 +192,33 @@ void shared_mutex_test() safe
   assert_eq(**sp->lock_shared(), value);
 }
 
+void shared_mutex_readers_coexist() safe
+{
+  using mutex_type = std2::shared_mutex<int>;
+
+  mutex_type m{1234};
+
+  {
+    // Shared guards taken on the same thread land on the same reader shard
+    // and must not block each other.
+    auto g1 = m.lock_shared();
+    auto g2 = m.lock_shared();
+    assert_eq(*g1, 1234);
+    assert_eq(*g2, 1234);
+  }
+
+  {
+    auto guard = m.lock();
+    mut *guard.borrow() = 4321;
+  }
+
+  assert_eq(*m.lock_shared(), 4321);
+}
+
 int main() safe
 {
   thread_constructor();
   mutex_test();
   shared_mutex_test();
+  shared_mutex_readers_coexist();
 }
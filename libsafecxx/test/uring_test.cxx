@@ -0,0 +1,116 @@
+// Copyright 2024 Christian Mazakas
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#feature on safety
+
+#include <std2.h>
+
+#include <cstdlib>
+
+#include "helpers.h"
+
+using std2::io::uring;
+
+int temp_fd() safe
+{
+  unsafe { char path[] = "/tmp/std2-uring-XXXXXX"; }
+  unsafe { int fd = ::mkstemp(path); }
+  assert_true(fd >= 0);
+  unsafe { ::unlink(path); }
+  return fd;
+}
+
+std2::vector<std2::u8> make_buffer(std::size_t n, std2::u8 fill) safe
+{
+  std2::vector<std2::u8> v = {};
+  for (std::size_t i = 0; i < n; ++i) {
+    mut v.push_back(static_cast<std2::u8>(fill + i));
+  }
+  return v;
+}
+
+void write_then_read(uring^ ring, int fd) safe
+{
+  mut ring.write(fd, make_buffer(512, 0), 0, 1).unwrap();
+  mut ring.write(fd, make_buffer(512, 7), 512, 2).unwrap();
+  mut ring.submit().unwrap();
+
+  for (int i = 0; i < 2; ++i) {
+    std2::io::completion c = mut ring.wait_completion().unwrap();
+    assert_true(c.user_data == 1 || c.user_data == 2);
+    assert_eq(c.res rel.unwrap(), 512u);
+
+    // The buffer comes back once the kernel is done with it.
+    std2::vector<std2::u8> buf = c.buffer rel.unwrap();
+    assert_eq(buf.size(), 512u);
+  }
+
+  mut ring.read(fd, make_buffer(1024, 0xff), 0, 3).unwrap();
+  mut ring.submit().unwrap();
+
+  std2::io::completion c = mut ring.wait_completion().unwrap();
+  assert_eq(c.user_data, 3u);
+  assert_eq(c.res rel.unwrap(), 1024u);
+
+  std2::vector<std2::u8> buf = c.buffer rel.unwrap();
+  assert_eq(buf[0], 0);
+  assert_eq(buf[511], static_cast<std2::u8>(511));
+  assert_eq(buf[512], 7);
+  assert_eq(ring.inflight(), 0u);
+}
+
+void registered(uring^ ring, int fd) safe
+{
+  int const fds[] = { fd };
+  mut ring.register_files(fds).unwrap();
+
+  std2::vector<std2::vector<std2::u8>> bufs = {};
+  mut bufs.push_back(make_buffer(256, 0));
+  mut ring.register_buffers(rel bufs).unwrap();
+
+  std2::io::fixed_file f{0};
+  mut ring.read_fixed(f, 0, 256, 0, 9).unwrap();
+
+  // The buffer can't be borrowed while the kernel may be writing to it.
+  if (!ring.is_fallback()) {
+    assert_true((mut ring.registered_buffer(0)).is_none());
+  }
+
+  mut ring.submit().unwrap();
+  std2::io::completion c = mut ring.wait_completion().unwrap();
+  assert_eq(c.user_data, 9u);
+  assert_eq(c.res rel.unwrap(), 256u);
+  assert_true(c.buffer.is_none());
+
+  [std2::u8; dyn]^ b = (mut ring.registered_buffer(0)).unwrap();
+  assert_eq(b[255], static_cast<std2::u8>(255));
+
+  std2::vector<std2::vector<std2::u8>> back = mut ring.unregister_buffers();
+  assert_eq(back.size(), 1u);
+}
+
+void uring_test() safe
+{
+  {
+    uring ring = uring::create(64);
+    int fd = temp_fd();
+    write_then_read(^ring, fd);
+    registered(^ring, fd);
+    unsafe { ::close(fd); }
+  }
+
+  {
+    uring ring = uring::create_fallback();
+    assert_true(ring.is_fallback());
+    int fd = temp_fd();
+    write_then_read(^ring, fd);
+    registered(^ring, fd);
+    unsafe { ::close(fd); }
+  }
+}
+
+int main() safe
+{
+  uring_test();
+}